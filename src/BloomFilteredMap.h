@@ -0,0 +1,286 @@
+#ifndef AISDI_MAPS_BLOOMFILTEREDMAP_H
+#define AISDI_MAPS_BLOOMFILTEREDMAP_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+#include "BloomFilter.h"
+#include "KeyedHash.h"
+
+namespace aisdi {
+
+// The hash function of `Map` if it has one, KeyedHash otherwise.
+template <typename Map, typename = void>
+struct FilterHashOf {
+  using type = KeyedHash<typename Map::key_type>;
+
+  static type of(const Map&) { return type(); }
+};
+
+template <typename Map>
+struct FilterHashOf<Map,
+                    typename std::conditional<true,
+                                              void,
+                                              typename Map::hasher>::type> {
+  using type = typename Map::hasher;
+
+  static type of(const Map& map) { return map.getHashFunction(); }
+};
+
+// Front end to a HashMap, TreeMap or any map with the same interface, which
+// answers lookups of absent keys from a BlockedBloomFilter of its keys, at the
+// cost of a single cache line, instead of walking a chain or descending the
+// tree. Pays off when most lookups miss; a lookup that passes the filter
+// hashes the key once more than the map alone would.
+//
+// The filter follows every insertion, and doubles in size once it holds more
+// keys than it was sized for. Removed keys stay in it until rebuildFilter()
+// is called, which is worth doing once getStaleKeyCount() grows large
+// compared to the size of the map. Lookup counters tell how well the filter
+// does; they are relaxed atomics, so const maps may still be read from
+// several threads at once.
+//
+// Keys that the map considers equal must hash alike, or the filter rejects
+// keys the map holds. Hash therefore defaults to the map's own hash function,
+// the very instance the map uses, and to KeyedHash for a TreeMap, which is
+// right as long as keys that are neither less nor greater than each other
+// are also equal. Hashes are mixed before they reach the filter, which
+// picks blocks by their high bits, as std::hash of an integer is the
+// integer itself.
+template <typename Map, typename Hash = typename FilterHashOf<Map>::type>
+class BloomFilteredMap {
+ public:
+  using key_type = typename Map::key_type;
+  using mapped_type = typename Map::mapped_type;
+  using value_type = typename Map::value_type;
+  using size_type = typename Map::size_type;
+  using iterator = typename Map::iterator;
+  using const_iterator = typename Map::const_iterator;
+  using hasher = Hash;
+
+  // Outcomes of lookups since the map was created, copied, or its counters
+  // were last reset.
+  struct FilterStats {
+    // Answered by the filter alone: the key is absent.
+    std::uint64_t m_rejected;
+    // Passed the filter and found in the map.
+    std::uint64_t m_found;
+    // Passed the filter, but absent: false positives.
+    std::uint64_t m_missed;
+  };
+
+ private:
+  struct Counters {
+    Counters() {}
+
+    // Copies count their own lookups.
+    Counters(const Counters&) {}
+
+    Counters& operator=(const Counters&) { return *this; }
+
+    void reset() {
+      m_rejected.store(0, std::memory_order_relaxed);
+      m_found.store(0, std::memory_order_relaxed);
+      m_missed.store(0, std::memory_order_relaxed);
+    }
+
+    static void count(std::atomic<std::uint64_t>& counter) {
+      counter.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    std::atomic<std::uint64_t> m_rejected{0};
+    std::atomic<std::uint64_t> m_found{0};
+    std::atomic<std::uint64_t> m_missed{0};
+  };
+
+  Map m_map;
+  Hash hash_fn;
+  BlockedBloomFilter m_filter;
+  // Keys added to the filter since it was last built, removed ones included.
+  size_type m_filtered = 0;
+  mutable Counters m_counters;
+
+  // Murmur3's 64-bit finalizer.
+  static std::uint64_t mix(std::uint64_t h) {
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return h;
+  }
+
+  std::uint64_t filterHash(const key_type& key) const {
+    return mix(hash_fn(key));
+  }
+
+  // A Hash other than the map's own is default constructed.
+  template <typename H = Hash>
+  static typename std::enable_if<
+      std::is_same<H, typename FilterHashOf<Map>::type>::value,
+      H>::type
+  initialHash(const Map& map) {
+    return FilterHashOf<Map>::of(map);
+  }
+
+  template <typename H = Hash>
+  static typename std::enable_if<
+      !std::is_same<H, typename FilterHashOf<Map>::type>::value,
+      H>::type
+  initialHash(const Map&) {
+    return H();
+  }
+
+  bool mayContain(const key_type& key) const {
+    if (m_filter.mayContain(filterHash(key)))
+      return true;
+    Counters::count(m_counters.m_rejected);
+    return false;
+  }
+
+  template <typename Iterator>
+  Iterator counted(Iterator it, Iterator end) const {
+    Counters::count(it == end ? m_counters.m_missed : m_counters.m_found);
+    return it;
+  }
+
+  void addKey(const key_type& key) {
+    if (m_filtered >= m_filter.getCapacity()) {
+      rebuildFilter(2 * m_filtered);
+      return;
+    }
+    m_filter.add(filterHash(key));
+    ++m_filtered;
+  }
+
+  // Makes room for the keys of the map and fills the filter with them.
+  void rebuildFilter(size_type capacity) {
+    BlockedBloomFilter filter(std::max(capacity, m_map.getSize()),
+                              m_filter.getBitsPerKey());
+    for (const value_type& item : m_map)
+      filter.add(filterHash(item.first));
+    m_filter = std::move(filter);
+    m_filtered = m_map.getSize();
+  }
+
+ public:
+  // The filter is first sized for `capacity` keys, at `bitsPerKey` bits each.
+  explicit BloomFilteredMap(
+      size_type capacity = 0,
+      size_type bitsPerKey = BLOOMFILTER_DEFAULT_BITS_PER_KEY)
+      : hash_fn(initialHash(m_map)), m_filter(capacity, bitsPerKey) {}
+
+  BloomFilteredMap(size_type capacity,
+                   size_type bitsPerKey,
+                   const Hash& hash)
+      : hash_fn(hash), m_filter(capacity, bitsPerKey) {}
+
+  BloomFilteredMap(std::initializer_list<value_type> list)
+      : BloomFilteredMap(list.size()) {
+    for (const value_type& item : list)
+      (*this)[item.first] = item.second;
+  }
+
+  bool isEmpty() const { return m_map.isEmpty(); }
+
+  size_type getSize() const { return m_map.getSize(); }
+
+  mapped_type& operator[](const key_type& key) {
+    const size_type size = m_map.getSize();
+    mapped_type& value = m_map[key];
+    if (m_map.getSize() != size)
+      addKey(key);
+    return value;
+  }
+
+  const mapped_type& valueOf(const key_type& key) const {
+    const const_iterator it = find(key);
+    if (it == m_map.end())
+      throw std::out_of_range("Element with given key does not exist");
+    return it->second;
+  }
+
+  mapped_type& valueOf(const key_type& key) {
+    const iterator it = find(key);
+    if (it == m_map.end())
+      throw std::out_of_range("Element with given key does not exist");
+    return it->second;
+  }
+
+  const_iterator find(const key_type& key) const {
+    if (!mayContain(key))
+      return m_map.end();
+    return counted(m_map.find(key), m_map.end());
+  }
+
+  iterator find(const key_type& key) {
+    if (!mayContain(key))
+      return m_map.end();
+    return counted(m_map.find(key), m_map.end());
+  }
+
+  bool contains(const key_type& key) const {
+    return find(key) != m_map.end();
+  }
+
+  void remove(const key_type& key) {
+    if (!mayContain(key))
+      throw std::out_of_range("Element with given key does not exist");
+    m_map.remove(key);
+  }
+
+  void remove(const const_iterator& it) { m_map.remove(it); }
+
+  // Rebuilds the filter from the keys in the map, dropping removed ones and
+  // resizing it to the current size of the map.
+  void rebuildFilter() { rebuildFilter(m_map.getSize()); }
+
+  // Number of removed keys still set in the filter, each of them making
+  // false positives a little more likely.
+  size_type getStaleKeyCount() const { return m_filtered - m_map.getSize(); }
+
+  const BlockedBloomFilter& getFilter() const { return m_filter; }
+
+  hasher getHashFunction() const { return hash_fn; }
+
+  FilterStats getFilterStats() const {
+    return FilterStats{m_counters.m_rejected.load(std::memory_order_relaxed),
+                       m_counters.m_found.load(std::memory_order_relaxed),
+                       m_counters.m_missed.load(std::memory_order_relaxed)};
+  }
+
+  void resetFilterStats() { m_counters.reset(); }
+
+  // The map behind the filter, read-only, since changes made to it directly
+  // would bypass the filter.
+  const Map& getMap() const { return m_map; }
+
+  bool operator==(const BloomFilteredMap& other) const {
+    return m_map == other.m_map;
+  }
+
+  bool operator!=(const BloomFilteredMap& other) const {
+    return !(*this == other);
+  }
+
+  iterator begin() { return m_map.begin(); }
+
+  iterator end() { return m_map.end(); }
+
+  const_iterator cbegin() const { return m_map.cbegin(); }
+
+  const_iterator cend() const { return m_map.cend(); }
+
+  const_iterator begin() const { return cbegin(); }
+
+  const_iterator end() const { return cend(); }
+};
+}  // namespace aisdi
+
+#endif /* AISDI_MAPS_BLOOMFILTEREDMAP_H */
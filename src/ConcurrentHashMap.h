@@ -0,0 +1,211 @@
+#ifndef AISDI_MAPS_CONCURRENTHASHMAP_H
+#define AISDI_MAPS_CONCURRENTHASHMAP_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <initializer_list>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "HashMap.h"
+
+#define CONCURRENTHASHMAP_SHARDS_PER_THREAD 4
+#define CONCURRENTHASHMAP_CACHE_LINE_SIZE 64
+
+namespace aisdi {
+
+// Thread-safe map split into independently locked shards, each of them an
+// ordinary HashMap guarded by its own reader/writer lock. Lookups of keys in
+// different shards never contend, and lookups of keys in the same shard only
+// wait for writers.
+//
+// Values are returned by copy, since a reference would outlive the lock.
+// Every compound operation (insertOrAssign, computeIfAbsent, eraseIf) runs
+// entirely under the shard's write lock, so it is atomic.
+template <typename KeyType,
+          typename ValueType,
+          typename Hash = std::hash<KeyType>,
+          typename KeyEqual = std::equal_to<KeyType>>
+class ConcurrentHashMap {
+ public:
+  using key_type = KeyType;
+  using mapped_type = ValueType;
+  using value_type = std::pair<const key_type, mapped_type>;
+  using size_type = std::size_t;
+  using hasher = Hash;
+  using key_equal = KeyEqual;
+  using shard_type = HashMap<KeyType, ValueType, Hash, KeyEqual>;
+
+ private:
+  using mutex_type = std::shared_timed_mutex;
+  using read_lock = std::shared_lock<mutex_type>;
+  using write_lock = std::lock_guard<mutex_type>;
+
+  struct Shard {
+    Shard(const Hash& hash, const KeyEqual& equal)
+        : m_map(HASHMAP_MIN_BUCKET_COUNT, hash, equal) {}
+
+    mutable mutex_type m_mutex;
+    shard_type m_map;
+    // Keeps the locks of shards allocated next to each other on separate
+    // cache lines.
+    char m_padding[CONCURRENTHASHMAP_CACHE_LINE_SIZE];
+  };
+
+  Hash hash_fn;
+  std::vector<std::unique_ptr<Shard>> m_shards;
+
+  static size_type defaultShardCount() {
+    const size_type threads = std::thread::hardware_concurrency();
+    return (threads ? threads : 1) * CONCURRENTHASHMAP_SHARDS_PER_THREAD;
+  }
+
+  static size_type roundUpToPowerOfTwo(size_type count) {
+    size_type result = 1;
+    while (result < count)
+      result <<= 1;
+    return result;
+  }
+
+  // Shards pick the high bits of a mixed hash, while buckets inside a shard
+  // use the low bits of the plain one. Otherwise all keys of one shard would
+  // share their low bits and crowd a fraction of its buckets.
+  Shard& shardFor(const key_type& key) const {
+    std::uint64_t h = hash_fn(key);
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return *m_shards[(h >> 32) & (m_shards.size() - 1)];
+  }
+
+ public:
+  ConcurrentHashMap() : ConcurrentHashMap(defaultShardCount()) {}
+
+  // `shardCount` is rounded up to a power of two.
+  explicit ConcurrentHashMap(size_type shardCount,
+                             const Hash& hash = Hash(),
+                             const KeyEqual& equal = KeyEqual())
+      : hash_fn(hash) {
+    const size_type count = roundUpToPowerOfTwo(shardCount);
+    m_shards.reserve(count);
+    for (size_type i = 0; i < count; ++i)
+      m_shards.emplace_back(new Shard(hash, equal));
+  }
+
+  ConcurrentHashMap(std::initializer_list<value_type> list)
+      : ConcurrentHashMap() {
+    for (const value_type& val : list)
+      insertOrAssign(val.first, val.second);
+  }
+
+  ConcurrentHashMap(const ConcurrentHashMap&) = delete;
+  ConcurrentHashMap& operator=(const ConcurrentHashMap&) = delete;
+
+  // Returns true if the key was inserted, false if its value was replaced.
+  bool insertOrAssign(const key_type& key, const mapped_type& value) {
+    Shard& shard = shardFor(key);
+    write_lock lock(shard.m_mutex);
+    return shard.m_map.insertOrAssign(key, value).second;
+  }
+
+  // Returns the value of `key`, inserting `make(key)` first if the key is
+  // missing. `make` is called at most once, under the shard's write lock, so
+  // it must not access this map.
+  template <typename Factory>
+  mapped_type computeIfAbsent(const key_type& key, Factory make) {
+    Shard& shard = shardFor(key);
+    {
+      read_lock lock(shard.m_mutex);
+      auto it = shard.m_map.find(key);
+      if (it != shard.m_map.end())
+        return it->second;
+    }
+
+    write_lock lock(shard.m_mutex);
+    auto it = shard.m_map.find(key);
+    if (it != shard.m_map.end())
+      return it->second;
+    return shard.m_map.tryEmplace(key, make(key)).first->second;
+  }
+
+  // Removes `key` if its value satisfies `predicate`. Returns true if the
+  // element was removed.
+  template <typename Predicate>
+  bool eraseIf(const key_type& key, Predicate predicate) {
+    Shard& shard = shardFor(key);
+    write_lock lock(shard.m_mutex);
+    auto it = shard.m_map.find(key);
+    if (it == shard.m_map.end() || !predicate(it->second))
+      return false;
+    shard.m_map.remove(it);
+    return true;
+  }
+
+  void remove(const key_type& key) {
+    Shard& shard = shardFor(key);
+    write_lock lock(shard.m_mutex);
+    shard.m_map.remove(key);
+  }
+
+  mapped_type valueOf(const key_type& key) const {
+    Shard& shard = shardFor(key);
+    read_lock lock(shard.m_mutex);
+    return shard.m_map.valueOf(key);
+  }
+
+  // Copies the value of `key` to `value`. Returns false if the key is
+  // missing.
+  bool tryGet(const key_type& key, mapped_type& value) const {
+    Shard& shard = shardFor(key);
+    read_lock lock(shard.m_mutex);
+    auto it = shard.m_map.find(key);
+    if (it == shard.m_map.end())
+      return false;
+    value = it->second;
+    return true;
+  }
+
+  bool contains(const key_type& key) const {
+    Shard& shard = shardFor(key);
+    read_lock lock(shard.m_mutex);
+    return shard.m_map.find(key) != shard.m_map.end();
+  }
+
+  // Visits every element, one shard at a time. Elements changed concurrently
+  // in shards not yet visited may or may not be seen.
+  template <typename Function>
+  void forEach(Function function) const {
+    for (const auto& shard : m_shards) {
+      read_lock lock(shard->m_mutex);
+      for (const auto& item : shard->m_map)
+        function(item);
+    }
+  }
+
+  // Sum of shard sizes. Not a snapshot while other threads write.
+  size_type getSize() const {
+    size_type size = 0;
+    for (const auto& shard : m_shards) {
+      read_lock lock(shard->m_mutex);
+      size += shard->m_map.getSize();
+    }
+    return size;
+  }
+
+  hasher getHashFunction() const { return hash_fn; }
+
+  bool isEmpty() const { return !getSize(); }
+
+  size_type getShardCount() const { return m_shards.size(); }
+};
+}  // namespace aisdi
+
+#endif /* AISDI_MAPS_CONCURRENTHASHMAP_H */
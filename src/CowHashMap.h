@@ -0,0 +1,602 @@
+#ifndef AISDI_MAPS_COWHASHMAP_H
+#define AISDI_MAPS_COWHASHMAP_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <forward_list>
+#include <functional>
+#include <initializer_list>
+#include <iterator>
+#include <memory>
+#include <stdexcept>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#define COWHASHMAP_SEGMENT_BITS 6
+#define COWHASHMAP_SEGMENT_SIZE (1 << COWHASHMAP_SEGMENT_BITS)
+
+namespace aisdi {
+
+// Hash map whose copies share structure. Buckets are grouped into segments of
+// COWHASHMAP_SEGMENT_SIZE chains, and a directory points to the segments.
+// Copying a map, or taking a snapshot(), only shares its directory, which
+// takes constant time. A map that is about to change a shared directory or
+// segment copies it first, so a map stays the same however its copies change,
+// and memory grows only by the directory and the segments written to
+// afterwards.
+//
+// operator[] and valueOf() hand out references to values, which may be kept
+// and written through later, so the segment they point into is never shared
+// again: copies get a copy of it, which costs time and memory on every
+// snapshot. insertOrAssign() hands out nothing and leaves segments shareable.
+//
+// The map grows by extendible hashing: the directory has 2^depth entries,
+// picked by the hash bits above those of the bucket, and a segment of local
+// depth d is shared by all entries with the same low d of these bits. A
+// segment that holds more elements than buckets is split in two on its own,
+// after the directory doubles if the segment already uses all its bits, so
+// growing never touches the other segments.
+//
+// A single map is not thread-safe, but maps sharing structure may be used
+// from different threads, e.g. readers working on snapshots while a writer
+// keeps updating the live map.
+template <typename KeyType,
+          typename ValueType,
+          typename Hash = std::hash<KeyType>,
+          typename KeyEqual = std::equal_to<KeyType>>
+class CowHashMap {
+ public:
+  using key_type = KeyType;
+  using mapped_type = ValueType;
+  using value_type = std::pair<const key_type, mapped_type>;
+  using size_type = std::size_t;
+  using reference = value_type&;
+  using const_reference = const value_type&;
+  using hasher = Hash;
+  using key_equal = KeyEqual;
+
+  class ConstIterator;
+  using const_iterator = ConstIterator;
+
+ private:
+  using bucket_type = std::forward_list<value_type>;
+
+  // Objects shared between maps carry their own reference count. One held by
+  // a single map may be written to; a shared one is never changed.
+  struct Segment {
+    explicit Segment(size_type depth) : m_depth(depth) {}
+
+    // Nothing refers into a copy yet, so it may be shared.
+    Segment(const Segment& other)
+        : m_depth(other.m_depth), m_count(other.m_count) {
+      for (size_type i = 0; i < COWHASHMAP_SEGMENT_SIZE; ++i)
+        m_buckets[i] = other.m_buckets[i];
+    }
+
+    mutable std::atomic<size_type> m_refs{1};
+    size_type m_depth;
+    size_type m_count = 0;
+    // Set once a reference to a value has been handed out.
+    bool m_leaked = false;
+    bucket_type m_buckets[COWHASHMAP_SEGMENT_SIZE];
+  };
+
+  // A segment counts one reference per directory, however many entries of
+  // the directory point to it.
+  struct Directory {
+    Directory() : m_segments(1) { m_segments[0] = new Segment(0); }
+
+    Directory(const Directory& other)
+        : m_depth(other.m_depth), m_segments(other.m_segments) {
+      for (size_type entry = 0; entry < m_segments.size(); ++entry)
+        if (isFirstEntry(entry))
+          acquire(m_segments[entry]);
+    }
+
+    // Going backwards, a segment is released only after its other entries
+    // have been passed.
+    ~Directory() {
+      for (size_type entry = m_segments.size(); entry-- > 0;)
+        if (isFirstEntry(entry))
+          release(m_segments[entry]);
+    }
+
+    // The entries of a segment of depth d are those equal to its lowest one
+    // modulo 2^d, which is therefore below 2^d.
+    bool isFirstEntry(size_type entry) const {
+      return entry < (size_type(1) << m_segments[entry]->m_depth);
+    }
+
+    mutable std::atomic<size_type> m_refs{1};
+    size_type m_depth = 0;
+    // Leaked segments, which only a directory owned by a single map holds.
+    size_type m_leakedCount = 0;
+    std::vector<Segment*> m_segments;
+  };
+
+  template <typename T>
+  static void acquire(const T* shared) {
+    shared->m_refs.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  template <typename T>
+  static void release(T* shared) {
+    if (shared && shared->m_refs.fetch_sub(1, std::memory_order_acq_rel) == 1)
+      delete shared;
+  }
+
+  // The acquire load orders the writes that follow after the reads other
+  // maps made before dropping their references.
+  template <typename T>
+  static bool isShared(const T* shared) {
+    return shared->m_refs.load(std::memory_order_acquire) != 1;
+  }
+
+  Hash hash_fn;
+  KeyEqual equal_fn;
+  // Null until the first insertion, and after the map was moved from.
+  Directory* m_directory = nullptr;
+  size_type m_size = 0;
+
+  size_type bucketCount() const {
+    return m_directory
+               ? m_directory->m_segments.size() * COWHASHMAP_SEGMENT_SIZE
+               : 0;
+  }
+
+  static bucket_type& bucketIn(const Directory& directory, size_type index) {
+    return directory.m_segments[index >> COWHASHMAP_SEGMENT_BITS]
+        ->m_buckets[index & (COWHASHMAP_SEGMENT_SIZE - 1)];
+  }
+
+  const bucket_type& bucketAt(size_type index) const {
+    return bucketIn(*m_directory, index);
+  }
+
+  size_type bucketIndex(const key_type& key) const {
+    return hash_fn(key) & (bucketCount() - 1);
+  }
+
+  // Points all entries of the segment at `entry` to `segment`.
+  void setSegment(size_type entry, Segment* segment) {
+    std::vector<Segment*>& segments = m_directory->m_segments;
+    const size_type step = size_type(1) << segment->m_depth;
+    for (entry &= step - 1; entry < segments.size(); entry += step)
+      segments[entry] = segment;
+  }
+
+  // Returns the segment of directory entry `entry`, after copying whatever
+  // of the path to it is shared with other maps.
+  Segment& writableSegment(size_type entry) {
+    if (!m_directory) {
+      m_directory = new Directory();
+    } else if (isShared(m_directory)) {
+      Directory* copy = new Directory(*m_directory);
+      release(m_directory);
+      m_directory = copy;
+    }
+
+    Segment* segment = m_directory->m_segments[entry];
+    if (isShared(segment)) {
+      Segment* copy = new Segment(*segment);
+      setSegment(entry, copy);
+      release(segment);
+      segment = copy;
+    }
+    return *segment;
+  }
+
+  Segment& writableSegmentOf(const key_type& key) {
+    const size_type entry =
+        m_directory ? bucketIndex(key) >> COWHASHMAP_SEGMENT_BITS : 0;
+    return writableSegment(entry);
+  }
+
+  bucket_type& bucketOf(Segment& segment, const key_type& key) const {
+    return segment.m_buckets[hash_fn(key) & (COWHASHMAP_SEGMENT_SIZE - 1)];
+  }
+
+  void leak(Segment& segment) {
+    if (!segment.m_leaked) {
+      segment.m_leaked = true;
+      ++m_directory->m_leakedCount;
+    }
+  }
+
+  // Returns the value of `key` in a segment this map owns, inserting one
+  // made from `args` if the key is missing. `holder` is set to the segment
+  // that holds the value.
+  template <typename... Args>
+  mapped_type& findOrInsert(const key_type& key,
+                            Segment*& holder,
+                            bool& inserted,
+                            Args&&... args) {
+    Segment& segment = writableSegmentOf(key);
+    holder = &segment;
+    bucket_type& bucket = bucketOf(segment, key);
+    bool found;
+    auto before = findBefore(bucket, key, found);
+    inserted = !found;
+    if (found)
+      return std::next(before)->second;
+
+    bucket.emplace_front(std::piecewise_construct, std::forward_as_tuple(key),
+                         std::forward_as_tuple(std::forward<Args>(args)...));
+    ++m_size;
+    mapped_type& value = bucket.front().second;
+    if (++segment.m_count > COWHASHMAP_SEGMENT_SIZE) {
+      const size_type entry = bucketIndex(key) >> COWHASHMAP_SEGMENT_BITS;
+      split(entry);
+      holder = m_directory->m_segments[bucketIndex(key) >>
+                                       COWHASHMAP_SEGMENT_BITS];
+    }
+    return value;
+  }
+
+  // Looks for `key` in `bucket` and returns the position before it, or the
+  // position of the last element if the key is missing.
+  typename bucket_type::iterator findBefore(bucket_type& bucket,
+                                            const key_type& key,
+                                            bool& found) const {
+    auto before = bucket.before_begin();
+    for (auto it = bucket.begin(); it != bucket.end(); before = it++) {
+      if (equal_fn(it->first, key)) {
+        found = true;
+        return before;
+      }
+    }
+    found = false;
+    return before;
+  }
+
+  const value_type* findValue(const key_type& key) const {
+    if (!m_directory)
+      return nullptr;
+
+    for (const value_type& item : bucketAt(bucketIndex(key)))
+      if (equal_fn(item.first, key))
+        return &item;
+    return nullptr;
+  }
+
+  // Splits the segment at directory entry `entry`, which this map must own
+  // along with the directory, moving the elements whose next hash bit is set
+  // to a new sibling. Elements keep their addresses. When the segment already
+  // uses all the bits of the directory, the directory doubles first, unless
+  // the map is still at most half full: then the segment merely holds keys
+  // with too many hash bits in common, and splitting would not help.
+  void split(size_type entry) {
+    Segment* segment = m_directory->m_segments[entry];
+    if (segment->m_depth == m_directory->m_depth) {
+      if (m_size * 2 <= bucketCount())
+        return;
+      std::vector<Segment*>& segments = m_directory->m_segments;
+      const size_type count = segments.size();
+      segments.resize(2 * count);
+      std::copy(segments.begin(), segments.begin() + count,
+                segments.begin() + count);
+      ++m_directory->m_depth;
+    }
+
+    const size_type bit = size_type(1) << segment->m_depth;
+    std::unique_ptr<Segment> sibling(new Segment(segment->m_depth + 1));
+    for (size_type i = 0; i < COWHASHMAP_SEGMENT_SIZE; ++i) {
+      bucket_type& bucket = segment->m_buckets[i];
+      bucket_type& target = sibling->m_buckets[i];
+      auto before = bucket.before_begin();
+      while (std::next(before) != bucket.end()) {
+        const size_type hash = hash_fn(std::next(before)->first);
+        if ((hash >> COWHASHMAP_SEGMENT_BITS) & bit) {
+          target.splice_after(target.before_begin(), bucket, before);
+          ++sibling->m_count;
+        } else {
+          ++before;
+        }
+      }
+    }
+    segment->m_count -= sibling->m_count;
+    ++segment->m_depth;
+    if (segment->m_leaked)
+      leak(*sibling);
+    setSegment((entry & (bit - 1)) | bit, sibling.release());
+  }
+
+  // Skips buckets of directory entries other than the first of their
+  // segment, which would visit the segment again.
+  size_type nextOccupied(size_type index) const {
+    const size_type count = bucketCount();
+    while (index < count) {
+      const size_type entry = index >> COWHASHMAP_SEGMENT_BITS;
+      if (!m_directory->isFirstEntry(entry))
+        index = (entry + 1) << COWHASHMAP_SEGMENT_BITS;
+      else if (bucketAt(index).empty())
+        ++index;
+      else
+        return index;
+    }
+    return count;
+  }
+
+ public:
+  CowHashMap() {}
+
+  explicit CowHashMap(const Hash& hash, const KeyEqual& equal = KeyEqual())
+      : hash_fn(hash), equal_fn(equal) {}
+
+  CowHashMap(std::initializer_list<value_type> list) {
+    for (const value_type& val : list)
+      insertOrAssign(val.first, val.second);
+  }
+
+  // Copies the pairs of [first, last), e.g. of a HashMap, later pairs
+  // overwriting values of earlier ones with the same key.
+  template <typename InputIt,
+            typename =
+                typename std::iterator_traits<InputIt>::iterator_category>
+  CowHashMap(InputIt first, InputIt last) {
+    for (; first != last; ++first)
+      insertOrAssign(first->first, first->second);
+  }
+
+  // Shares the structure of `other`, which takes constant time, except for
+  // its leaked segments, which are copied.
+  CowHashMap(const CowHashMap& other)
+      : hash_fn(other.hash_fn),
+        equal_fn(other.equal_fn),
+        m_directory(other.m_directory),
+        m_size(other.m_size) {
+    if (!m_directory)
+      return;
+    if (!m_directory->m_leakedCount) {
+      acquire(m_directory);
+      return;
+    }
+
+    m_directory = new Directory(*other.m_directory);
+    try {
+      std::vector<Segment*>& segments = m_directory->m_segments;
+      for (size_type entry = 0; entry < segments.size(); ++entry) {
+        Segment* segment = segments[entry];
+        if (m_directory->isFirstEntry(entry) && segment->m_leaked) {
+          setSegment(entry, new Segment(*segment));
+          release(segment);
+        }
+      }
+    } catch (...) {
+      release(m_directory);
+      throw;
+    }
+  }
+
+  CowHashMap(CowHashMap&& other)
+      : hash_fn(other.hash_fn),
+        equal_fn(other.equal_fn),
+        m_directory(other.m_directory),
+        m_size(other.m_size) {
+    other.m_directory = nullptr;
+    other.m_size = 0;
+  }
+
+  ~CowHashMap() { release(m_directory); }
+
+  CowHashMap& operator=(const CowHashMap& other) {
+    if (this != &other) {
+      CowHashMap copy(other);
+      *this = std::move(copy);
+    }
+    return *this;
+  }
+
+  CowHashMap& operator=(CowHashMap&& other) {
+    if (this != &other) {
+      release(m_directory);
+      hash_fn = other.hash_fn;
+      equal_fn = other.equal_fn;
+      m_directory = other.m_directory;
+      m_size = other.m_size;
+      other.m_directory = nullptr;
+      other.m_size = 0;
+    }
+    return *this;
+  }
+
+  // Returns a map with the current contents that later changes of either
+  // map do not affect. Takes constant time, plus a copy of every leaked
+  // segment.
+  CowHashMap snapshot() const { return *this; }
+
+  bool isEmpty() const { return !m_size; }
+
+  // Leaks the segment of `key`.
+  mapped_type& operator[](const key_type& key) {
+    Segment* holder;
+    bool inserted;
+    mapped_type& value = findOrInsert(key, holder, inserted);
+    leak(*holder);
+    return value;
+  }
+
+  // Returns true if `key` was not in the map. Leaks no segment.
+  bool insertOrAssign(const key_type& key, const mapped_type& value) {
+    Segment* holder;
+    bool inserted;
+    mapped_type& current = findOrInsert(key, holder, inserted, value);
+    if (!inserted)
+      current = value;
+    return inserted;
+  }
+
+  const mapped_type& valueOf(const key_type& key) const {
+    const value_type* item = findValue(key);
+    if (!item)
+      throw std::out_of_range("Element with given key does not exist");
+    return item->second;
+  }
+
+  // Copies the segment of `key` first if it is shared, and leaks it.
+  mapped_type& valueOf(const key_type& key) {
+    if (!findValue(key))
+      throw std::out_of_range("Element with given key does not exist");
+
+    Segment& segment = writableSegmentOf(key);
+    leak(segment);
+    bucket_type& bucket = bucketOf(segment, key);
+    bool found;
+    return std::next(findBefore(bucket, key, found))->second;
+  }
+
+  const_iterator find(const key_type& key) const {
+    if (!m_directory)
+      return cend();
+
+    const size_type index = bucketIndex(key);
+    const bucket_type& bucket = bucketAt(index);
+    for (auto it = bucket.begin(); it != bucket.end(); ++it)
+      if (equal_fn(it->first, key))
+        return const_iterator(*this, index, it);
+    return cend();
+  }
+
+  bool contains(const key_type& key) const { return findValue(key); }
+
+  void remove(const key_type& key) {
+    if (!findValue(key))
+      throw std::out_of_range("Element with given key does not exist");
+
+    Segment& segment = writableSegmentOf(key);
+    bucket_type& bucket = bucketOf(segment, key);
+    bool found;
+    bucket.erase_after(findBefore(bucket, key, found));
+    --segment.m_count;
+    --m_size;
+  }
+
+  size_type getSize() const { return m_size; }
+
+  hasher getHashFunction() const { return hash_fn; }
+
+  size_type getBucketCount() const { return bucketCount(); }
+
+  // Number of segments this map shares with no other map, i.e. the memory a
+  // snapshot has cost so far.
+  size_type getOwnedSegmentCount() const {
+    if (!m_directory)
+      return 0;
+    if (isShared(m_directory))
+      return 0;
+
+    size_type count = 0;
+    for (size_type entry = 0; entry < m_directory->m_segments.size(); ++entry)
+      count += m_directory->isFirstEntry(entry) &&
+               !isShared(m_directory->m_segments[entry]);
+    return count;
+  }
+
+  // Maps that still share their directory are equal without comparing any
+  // element.
+  bool operator==(const CowHashMap& other) const {
+    if (m_size != other.m_size)
+      return false;
+    if (m_directory == other.m_directory)
+      return true;
+
+    for (const value_type& item : *this) {
+      const value_type* found = other.findValue(item.first);
+      if (!found || !(found->second == item.second))
+        return false;
+    }
+    return true;
+  }
+
+  bool operator!=(const CowHashMap& other) const { return !(*this == other); }
+
+  const_iterator cbegin() const {
+    const size_type index = nextOccupied(0);
+    if (index == bucketCount())
+      return cend();
+    return const_iterator(*this, index, bucketAt(index).begin());
+  }
+
+  const_iterator cend() const {
+    return const_iterator(*this, bucketCount(),
+                          typename bucket_type::const_iterator());
+  }
+
+  const_iterator begin() const { return cbegin(); }
+
+  const_iterator end() const { return cend(); }
+};
+
+// Elements are read-only through iterators, since writing to a shared
+// segment would change the snapshots sharing it. Use insertOrAssign(),
+// operator[] or valueOf() to change a value.
+template <typename KeyType,
+          typename ValueType,
+          typename Hash,
+          typename KeyEqual>
+class CowHashMap<KeyType, ValueType, Hash, KeyEqual>::ConstIterator {
+ public:
+  using reference = typename CowHashMap::const_reference;
+  using iterator_category = std::forward_iterator_tag;
+  using value_type = typename CowHashMap::value_type;
+  using difference_type = std::ptrdiff_t;
+  using pointer = const typename CowHashMap::value_type*;
+  using size_type = typename CowHashMap::size_type;
+  using bucket_iterator = typename CowHashMap::bucket_type::const_iterator;
+
+  friend class CowHashMap;
+
+ private:
+  const CowHashMap* m_source;
+  size_type m_index;
+  bucket_iterator m_item;
+
+ public:
+  explicit ConstIterator(const CowHashMap& source,
+                         size_type index,
+                         bucket_iterator item)
+      : m_source(&source), m_index(index), m_item(item) {}
+
+  ConstIterator& operator++() {
+    if (m_index >= m_source->bucketCount())
+      throw std::out_of_range("Next iterator does not exist");
+
+    if (++m_item != m_source->bucketAt(m_index).end())
+      return *this;
+
+    m_index = m_source->nextOccupied(m_index + 1);
+    m_item = m_index < m_source->bucketCount()
+                 ? m_source->bucketAt(m_index).begin()
+                 : bucket_iterator();
+    return *this;
+  }
+
+  ConstIterator operator++(int) {
+    ConstIterator tmp(*this);
+    ++(*this);
+    return tmp;
+  }
+
+  reference operator*() const {
+    if (m_index >= m_source->bucketCount())
+      throw std::out_of_range("Iterator does not have a value");
+    return *m_item;
+  }
+
+  pointer operator->() const { return &this->operator*(); }
+
+  bool operator==(const ConstIterator& other) const {
+    return m_source == other.m_source && m_index == other.m_index &&
+           m_item == other.m_item;
+  }
+
+  bool operator!=(const ConstIterator& other) const {
+    return !(*this == other);
+  }
+};
+
+}  // namespace aisdi
+
+#endif /* AISDI_MAPS_COWHASHMAP_H */
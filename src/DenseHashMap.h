@@ -0,0 +1,476 @@
+#ifndef AISDI_MAPS_DENSEHASHMAP_H
+#define AISDI_MAPS_DENSEHASHMAP_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <initializer_list>
+#include <iterator>
+#include <new>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#define DENSEHASHMAP_MIN_INDEX_SIZE 8
+
+namespace aisdi {
+
+// Hash map that keeps its elements packed in one vector, in insertion order,
+// and finds them through a separate open addressing index of 32-bit entry
+// positions. Iteration streams the entry vector front to back.
+//
+// Removal leaves a hole in the entry vector instead of moving the last entry
+// in, so insertion order survives. Holes are skipped by iterators and
+// squeezed out by remove(key) once they outnumber the elements, or when
+// reserve() grows the index.
+template <typename KeyType,
+          typename ValueType,
+          typename Hash = std::hash<KeyType>,
+          typename KeyEqual = std::equal_to<KeyType>>
+class DenseHashMap {
+ public:
+  using key_type = KeyType;
+  using mapped_type = ValueType;
+  using value_type = std::pair<const key_type, mapped_type>;
+  using size_type = std::size_t;
+  using reference = value_type&;
+  using const_reference = const value_type&;
+  using hasher = Hash;
+  using key_equal = KeyEqual;
+
+  class ConstIterator;
+  class Iterator;
+  using iterator = Iterator;
+  using const_iterator = ConstIterator;
+
+ private:
+  using slot_type = std::uint32_t;
+
+  static const slot_type kEmpty = 0xFFFFFFFF;
+  static const slot_type kDeleted = 0xFFFFFFFE;
+
+  // Element storage that may be a hole left by a removed element.
+  struct Entry {
+    template <typename... Args>
+    explicit Entry(size_type hash, Args&&... args)
+        : m_hash(hash), m_live(true) {
+      ::new (static_cast<void*>(&m_storage))
+          value_type(std::forward<Args>(args)...);
+    }
+
+    Entry(const Entry& other) : m_hash(other.m_hash), m_live(other.m_live) {
+      if (m_live)
+        ::new (static_cast<void*>(&m_storage)) value_type(other.value());
+    }
+
+    Entry(Entry&& other) noexcept(
+        std::is_nothrow_move_constructible<value_type>::value)
+        : m_hash(other.m_hash), m_live(other.m_live) {
+      if (m_live)
+        ::new (static_cast<void*>(&m_storage))
+            value_type(std::move(other.value()));
+    }
+
+    Entry& operator=(const Entry&) = delete;
+
+    ~Entry() {
+      if (m_live)
+        value().~value_type();
+    }
+
+    value_type& value() { return *reinterpret_cast<value_type*>(&m_storage); }
+
+    const value_type& value() const {
+      return *reinterpret_cast<const value_type*>(&m_storage);
+    }
+
+    void kill() {
+      value().~value_type();
+      m_live = false;
+    }
+
+    size_type m_hash;
+    bool m_live;
+    typename std::aligned_storage<sizeof(value_type),
+                                  alignof(value_type)>::type m_storage;
+  };
+
+  Hash hash_fn;
+  KeyEqual equal_fn;
+  std::vector<Entry> m_entries;
+  // Positions in m_entries. Its size is a power of two, and at most half of
+  // it is in use, counting the slots of removed elements.
+  std::vector<slot_type> m_index;
+  size_type m_size = 0;
+
+  size_type getHoleCount() const { return m_entries.size() - m_size; }
+
+  static size_type indexSizeFor(size_type count) {
+    size_type size = DENSEHASHMAP_MIN_INDEX_SIZE;
+    while (size < count * 2)
+      size <<= 1;
+    return size;
+  }
+
+  // Returns the index slot holding `key`, or the empty slot ending its probe
+  // sequence. The index must not be empty.
+  size_type findSlot(size_type hash, const key_type& key) const {
+    const size_type mask = m_index.size() - 1;
+    for (size_type slot = hash & mask;; slot = (slot + 1) & mask) {
+      const slot_type position = m_index[slot];
+      if (position == kEmpty)
+        return slot;
+      if (position != kDeleted) {
+        const Entry& entry = m_entries[position];
+        if (entry.m_hash == hash && equal_fn(entry.value().first, key))
+          return slot;
+      }
+    }
+  }
+
+  size_type findEntry(const key_type& key) const {
+    if (m_index.empty())
+      return m_entries.size();
+    const slot_type position = m_index[findSlot(hash_fn(key), key)];
+    return position == kEmpty ? m_entries.size() : position;
+  }
+
+  // Fills a fresh index of `indexSize` slots with the live entries. Holes
+  // stay where they are, so iterators remain valid.
+  void reindex(size_type indexSize) {
+    std::vector<slot_type> index(indexSize, slot_type(kEmpty));
+    const size_type mask = indexSize - 1;
+    for (size_type i = 0; i < m_entries.size(); ++i) {
+      if (!m_entries[i].m_live)
+        continue;
+      size_type slot = m_entries[i].m_hash & mask;
+      while (index[slot] != kEmpty)
+        slot = (slot + 1) & mask;
+      index[slot] = static_cast<slot_type>(i);
+    }
+    m_index.swap(index);
+  }
+
+  // Squeezes the holes out of the entry vector and fills a fresh index of
+  // `indexSize` slots. Invalidates iterators.
+  void rebuild(size_type indexSize) {
+    if (getHoleCount()) {
+      std::vector<Entry> entries;
+      entries.reserve(m_entries.capacity());
+      for (Entry& entry : m_entries)
+        if (entry.m_live)
+          entries.push_back(std::move(entry));
+      m_entries.swap(entries);
+    }
+    reindex(indexSize);
+  }
+
+  void eraseAt(size_type position) {
+    Entry& entry = m_entries[position];
+    m_index[findSlot(entry.m_hash, entry.value().first)] = kDeleted;
+    entry.kill();
+    --m_size;
+  }
+
+  // Squeezes out the holes once they outnumber the elements, shrinking the
+  // index along with them. Invalidates iterators.
+  void compactIfSparse() {
+    if (getHoleCount() > m_size &&
+        getHoleCount() > DENSEHASHMAP_MIN_INDEX_SIZE)
+      rebuild(indexSizeFor(2 * m_size));
+  }
+
+  size_type nextLive(size_type position) const {
+    while (position < m_entries.size() && !m_entries[position].m_live)
+      ++position;
+    return position;
+  }
+
+ public:
+  DenseHashMap() {}
+
+  explicit DenseHashMap(size_type count,
+                        const Hash& hash = Hash(),
+                        const KeyEqual& equal = KeyEqual())
+      : hash_fn(hash), equal_fn(equal) {
+    reserve(count);
+  }
+
+  DenseHashMap(std::initializer_list<value_type> list) {
+    reserve(list.size());
+    for (const value_type& val : list)
+      (*this)[val.first] = val.second;
+  }
+
+  DenseHashMap(const DenseHashMap& other)
+      : hash_fn(other.hash_fn), equal_fn(other.equal_fn) {
+    m_entries.reserve(other.m_size);
+    for (const Entry& entry : other.m_entries)
+      if (entry.m_live)
+        m_entries.push_back(entry);
+    m_size = other.m_size;
+    if (m_size)
+      rebuild(indexSizeFor(m_size));
+  }
+
+  DenseHashMap(DenseHashMap&& other)
+      : hash_fn(other.hash_fn),
+        equal_fn(other.equal_fn),
+        m_entries(std::move(other.m_entries)),
+        m_index(std::move(other.m_index)),
+        m_size(other.m_size) {
+    other.m_entries.clear();
+    other.m_index.clear();
+    other.m_size = 0;
+  }
+
+  DenseHashMap& operator=(const DenseHashMap& other) {
+    if (this != &other) {
+      DenseHashMap copy(other);
+      *this = std::move(copy);
+    }
+    return *this;
+  }
+
+  DenseHashMap& operator=(DenseHashMap&& other) {
+    if (this != &other) {
+      std::swap(hash_fn, other.hash_fn);
+      std::swap(equal_fn, other.equal_fn);
+      m_entries.swap(other.m_entries);
+      m_index.swap(other.m_index);
+      std::swap(m_size, other.m_size);
+      other.m_entries.clear();
+      other.m_index.clear();
+      other.m_size = 0;
+    }
+    return *this;
+  }
+
+  bool isEmpty() const { return !m_size; }
+
+  // Grows the index without compacting the entries, so iterators stay
+  // valid.
+  mapped_type& operator[](const key_type& key) {
+    const size_type hash = hash_fn(key);
+    size_type slot = 0;
+    if (!m_index.empty()) {
+      slot = findSlot(hash, key);
+      if (m_index[slot] != kEmpty)
+        return m_entries[m_index[slot]].value().second;
+    }
+
+    if ((m_entries.size() + 1) * 2 > m_index.size()) {
+      reindex(indexSizeFor(2 * (m_entries.size() + 1)));
+      slot = findSlot(hash, key);
+    }
+    m_entries.emplace_back(hash, key, mapped_type{});
+    m_index[slot] = static_cast<slot_type>(m_entries.size() - 1);
+    ++m_size;
+    return m_entries.back().value().second;
+  }
+
+  const mapped_type& valueOf(const key_type& key) const {
+    const size_type position = findEntry(key);
+    if (position == m_entries.size())
+      throw std::out_of_range("Element with given key does not exist");
+    return m_entries[position].value().second;
+  }
+
+  mapped_type& valueOf(const key_type& key) {
+    const size_type position = findEntry(key);
+    if (position == m_entries.size())
+      throw std::out_of_range("Element with given key does not exist");
+    return m_entries[position].value().second;
+  }
+
+  const_iterator find(const key_type& key) const {
+    return const_iterator(*this, findEntry(key));
+  }
+
+  iterator find(const key_type& key) { return iterator(*this, findEntry(key)); }
+
+  // May compact the entries, which invalidates all iterators.
+  void remove(const key_type& key) {
+    const size_type position = findEntry(key);
+    if (position == m_entries.size())
+      throw std::out_of_range("Element with given key does not exist");
+    eraseAt(position);
+    compactIfSparse();
+  }
+
+  // Removes the element the iterator points to and returns an iterator to
+  // the following one. Never compacts, so other iterators stay valid.
+  iterator remove(const const_iterator& it) {
+    if (it.m_source != this || it.m_index >= m_entries.size())
+      throw std::out_of_range("Element with given key does not exist");
+    eraseAt(it.m_index);
+    return iterator(*this, nextLive(it.m_index + 1));
+  }
+
+  size_type getSize() const { return m_size; }
+
+  hasher getHashFunction() const { return hash_fn; }
+
+  size_type getIndexSize() const { return m_index.size(); }
+
+  // Makes room for `count` elements, so that inserting them neither moves
+  // the entries nor rebuilds the index.
+  void reserve(size_type count) {
+    if (count < m_size)
+      count = m_size;
+    if (indexSizeFor(getHoleCount() + count) > m_index.size())
+      rebuild(indexSizeFor(count));
+    m_entries.reserve(getHoleCount() + count);
+  }
+
+  bool operator==(const DenseHashMap& other) const {
+    if (this->getSize() != other.getSize())
+      return false;
+
+    for (const auto& elem : *this) {
+      const size_type position = other.findEntry(elem.first);
+      if (position == other.m_entries.size() ||
+          !(other.m_entries[position].value().second == elem.second))
+        return false;
+    }
+
+    return true;
+  }
+
+  bool operator!=(const DenseHashMap& other) const { return !(*this == other); }
+
+  iterator begin() { return iterator(*this, nextLive(0)); }
+
+  iterator end() { return iterator(*this, m_entries.size()); }
+
+  const_iterator cbegin() const { return const_iterator(*this, nextLive(0)); }
+
+  const_iterator cend() const {
+    return const_iterator(*this, m_entries.size());
+  }
+
+  const_iterator begin() const { return cbegin(); }
+
+  const_iterator end() const { return cend(); }
+};
+
+template <typename KeyType,
+          typename ValueType,
+          typename Hash,
+          typename KeyEqual>
+class DenseHashMap<KeyType, ValueType, Hash, KeyEqual>::ConstIterator {
+ public:
+  using reference = typename DenseHashMap::const_reference;
+  using iterator_category = std::bidirectional_iterator_tag;
+  using value_type = typename DenseHashMap::value_type;
+  using difference_type = std::ptrdiff_t;
+  using pointer = const typename DenseHashMap::value_type*;
+  using size_type = typename DenseHashMap::size_type;
+
+  friend class DenseHashMap;
+
+ protected:
+  const DenseHashMap* m_source;
+  size_type m_index;
+
+ public:
+  explicit ConstIterator(const DenseHashMap& source, size_type index)
+      : m_source(&source), m_index(index) {}
+
+  ConstIterator& operator++() {
+    if (m_index >= m_source->m_entries.size())
+      throw std::out_of_range("Next iterator does not exist");
+
+    m_index = m_source->nextLive(m_index + 1);
+    return *this;
+  }
+
+  ConstIterator operator++(int) {
+    ConstIterator tmp(*this);
+    ++(*this);
+    return tmp;
+  }
+
+  ConstIterator& operator--() {
+    for (size_type i = m_index; i; --i) {
+      if (m_source->m_entries[i - 1].m_live) {
+        m_index = i - 1;
+        return *this;
+      }
+    }
+
+    throw std::out_of_range("Previous iterator does not exist");
+  }
+
+  ConstIterator operator--(int) {
+    ConstIterator tmp(*this);
+    --(*this);
+    return tmp;
+  }
+
+  reference operator*() const {
+    if (m_index >= m_source->m_entries.size())
+      throw std::out_of_range("Iterator does not have a value");
+    return m_source->m_entries[m_index].value();
+  }
+
+  pointer operator->() const { return &this->operator*(); }
+
+  bool operator==(const ConstIterator& other) const {
+    return m_source == other.m_source && m_index == other.m_index;
+  }
+
+  bool operator!=(const ConstIterator& other) const {
+    return !(*this == other);
+  }
+};
+
+template <typename KeyType,
+          typename ValueType,
+          typename Hash,
+          typename KeyEqual>
+class DenseHashMap<KeyType, ValueType, Hash, KeyEqual>::Iterator
+    : public DenseHashMap<KeyType, ValueType, Hash, KeyEqual>::ConstIterator {
+ public:
+  using reference = typename DenseHashMap::reference;
+  using pointer = typename DenseHashMap::value_type*;
+
+  explicit Iterator(const DenseHashMap& source, size_type index)
+      : ConstIterator(source, index) {}
+
+  Iterator(const ConstIterator& other) : ConstIterator(other) {}
+
+  Iterator& operator++() {
+    ConstIterator::operator++();
+    return *this;
+  }
+
+  Iterator operator++(int) {
+    auto result = *this;
+    ConstIterator::operator++();
+    return result;
+  }
+
+  Iterator& operator--() {
+    ConstIterator::operator--();
+    return *this;
+  }
+
+  Iterator operator--(int) {
+    auto result = *this;
+    ConstIterator::operator--();
+    return result;
+  }
+
+  pointer operator->() const { return &this->operator*(); }
+
+  reference operator*() const {
+    // ugly cast, yet reduces code duplication.
+    return const_cast<reference>(ConstIterator::operator*());
+  }
+};
+
+}  // namespace aisdi
+
+#endif /* AISDI_MAPS_DENSEHASHMAP_H */
@@ -0,0 +1,136 @@
+#ifndef AISDI_MAPS_EPOCHDOMAIN_H
+#define AISDI_MAPS_EPOCHDOMAIN_H
+
+#include <atomic>
+#include <cstdint>
+
+namespace aisdi {
+
+// Epoch-based reclamation for data read without locks.
+//
+// A reader pins the current global epoch for the duration of a Guard. A
+// writer that unlinks an object records the epoch it did so in and may free
+// the object once the global epoch is two steps further: the epoch only
+// advances when every pinned thread has seen the current one, so by then no
+// reader can still hold a pointer to it.
+//
+// Pinning is a single atomic exchange on a per-thread record, so readers
+// never wait. Records are registered once per thread and reused after the
+// thread exits.
+class EpochDomain {
+ private:
+  struct Record {
+    // Pinned epoch, or 0 when the thread is not reading.
+    std::atomic<std::uint64_t> m_epoch{0};
+    std::atomic<bool> m_inUse{true};
+    Record* m_next = nullptr;
+    unsigned m_depth = 0;
+  };
+
+  // Releases the record of a thread when the thread exits.
+  struct ThreadHandle {
+    Record* m_record = nullptr;
+
+    ~ThreadHandle() {
+      if (m_record)
+        m_record->m_inUse.store(false);
+    }
+  };
+
+  std::atomic<std::uint64_t> m_epoch{1};
+  std::atomic<Record*> m_records{nullptr};
+
+  EpochDomain() = default;
+
+  Record* acquireRecord() {
+    for (Record* record = m_records.load(); record; record = record->m_next) {
+      bool inUse = false;
+      if (!record->m_inUse.load() &&
+          record->m_inUse.compare_exchange_strong(inUse, true))
+        return record;
+    }
+
+    Record* record = new Record();
+    record->m_next = m_records.load();
+    while (!m_records.compare_exchange_weak(record->m_next, record)) {
+    }
+    return record;
+  }
+
+  Record& threadRecord() {
+    static thread_local ThreadHandle handle;
+    if (!handle.m_record)
+      handle.m_record = acquireRecord();
+    return *handle.m_record;
+  }
+
+ public:
+  // Keeps every object reachable when the guard was created alive until the
+  // guard is destroyed. Guards may nest.
+  class Guard {
+   public:
+    Guard() : m_record(global().threadRecord()) {
+      // The fence pairs with the one in tryAdvance(): either the writer's
+      // scan sees the pin, or every pointer the reader loads afterwards
+      // sees what the writer unlinked before scanning.
+      if (!m_record.m_depth++) {
+        m_record.m_epoch.exchange(global().m_epoch.load());
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+      }
+    }
+
+    ~Guard() {
+      if (!--m_record.m_depth)
+        m_record.m_epoch.store(0, std::memory_order_release);
+    }
+
+    Guard(const Guard&) = delete;
+    Guard& operator=(const Guard&) = delete;
+
+   private:
+    Record& m_record;
+  };
+
+  EpochDomain(const EpochDomain&) = delete;
+  EpochDomain& operator=(const EpochDomain&) = delete;
+
+  ~EpochDomain() {
+    Record* record = m_records.load();
+    while (record) {
+      Record* next = record->m_next;
+      delete record;
+      record = next;
+    }
+  }
+
+  static EpochDomain& global() {
+    static EpochDomain domain;
+    return domain;
+  }
+
+  std::uint64_t getEpoch() const { return m_epoch.load(); }
+
+  // Advances the global epoch if every pinned thread has seen the current
+  // one. Returns false if some reader still lags behind.
+  bool tryAdvance() {
+    // Orders the unlinking stores of the caller before the scan; see Guard.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    std::uint64_t epoch = m_epoch.load();
+    for (Record* record = m_records.load(); record; record = record->m_next) {
+      const std::uint64_t pinned = record->m_epoch.load();
+      if (pinned && pinned != epoch)
+        return false;
+    }
+    m_epoch.compare_exchange_strong(epoch, epoch + 1);
+    return true;
+  }
+
+  // Whether an object unlinked during `epoch` can no longer be reached by
+  // any reader.
+  bool isSafeToFree(std::uint64_t epoch) const {
+    return m_epoch.load() >= epoch + 2;
+  }
+};
+}  // namespace aisdi
+
+#endif /* AISDI_MAPS_EPOCHDOMAIN_H */
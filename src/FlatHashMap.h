@@ -0,0 +1,627 @@
+#ifndef AISDI_MAPS_FLATHASHMAP_H
+#define AISDI_MAPS_FLATHASHMAP_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <initializer_list>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <utility>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#define FLATHASHMAP_GROUP_WIDTH 16
+#define FLATHASHMAP_MIN_CAPACITY 16
+
+namespace aisdi {
+
+// Open addressing hash map in the style of a "Swiss table". Entries live in a
+// flat slot array, and every slot has one control byte: either a marker for an
+// empty or deleted slot, or 7 bits of the key hash for a full one. Lookups
+// compare a whole group of 16 control bytes against those 7 bits at once, so
+// only the slots whose control byte matches have their keys compared.
+template <typename KeyType, typename ValueType>
+class FlatHashMap {
+ public:
+  using key_type = KeyType;
+  using mapped_type = ValueType;
+  using value_type = std::pair<const key_type, mapped_type>;
+  using size_type = std::size_t;
+  using reference = value_type&;
+  using const_reference = const value_type&;
+
+  class ConstIterator;
+  class Iterator;
+  using iterator = Iterator;
+  using const_iterator = ConstIterator;
+
+ private:
+  using ctrl_type = std::int8_t;
+  using bitmask_type = std::uint32_t;
+
+  // Full slots hold the low 7 bits of the hash, so they are never negative.
+  static const ctrl_type kEmpty = -128;
+  static const ctrl_type kDeleted = -2;
+
+  // A view of FLATHASHMAP_GROUP_WIDTH consecutive control bytes. Every match
+  // returns a bitmask with bit i set when byte i satisfies the predicate.
+  class Group {
+   public:
+    explicit Group(const ctrl_type* ctrl) {
+#ifdef __SSE2__
+      m_ctrl = _mm_loadu_si128(reinterpret_cast<const __m128i*>(ctrl));
+#else
+      std::memcpy(m_ctrl, ctrl, FLATHASHMAP_GROUP_WIDTH);
+#endif
+    }
+
+    bitmask_type match(ctrl_type h2) const {
+#ifdef __SSE2__
+      return _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_set1_epi8(h2), m_ctrl));
+#else
+      return matchIf([h2](ctrl_type c) { return c == h2; });
+#endif
+    }
+
+    bitmask_type matchEmpty() const {
+#ifdef __SSE2__
+      return _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_set1_epi8(kEmpty), m_ctrl));
+#else
+      return matchIf([](ctrl_type c) { return c == kEmpty; });
+#endif
+    }
+
+    // Empty and deleted slots are the only ones with the sign bit set.
+    bitmask_type matchEmptyOrDeleted() const {
+#ifdef __SSE2__
+      return _mm_movemask_epi8(m_ctrl);
+#else
+      return matchIf([](ctrl_type c) { return c < 0; });
+#endif
+    }
+
+    bitmask_type matchFull() const {
+      return ~matchEmptyOrDeleted() & ((1u << FLATHASHMAP_GROUP_WIDTH) - 1);
+    }
+
+   private:
+#ifdef __SSE2__
+    __m128i m_ctrl;
+#else
+    ctrl_type m_ctrl[FLATHASHMAP_GROUP_WIDTH];
+
+    template <typename Predicate>
+    bitmask_type matchIf(Predicate predicate) const {
+      bitmask_type result = 0;
+      for (int i = 0; i < FLATHASHMAP_GROUP_WIDTH; ++i)
+        if (predicate(m_ctrl[i]))
+          result |= 1u << i;
+      return result;
+    }
+#endif
+  };
+
+  static int trailingZeros(bitmask_type mask) { return __builtin_ctz(mask); }
+
+  static int leadingZeros(bitmask_type mask) {
+    return __builtin_clz(mask) - (32 - FLATHASHMAP_GROUP_WIDTH);
+  }
+
+  // The control array has FLATHASHMAP_GROUP_WIDTH extra bytes at the end
+  // mirroring the first group, so that a group can be loaded starting at any
+  // slot without wrapping around.
+  ctrl_type* m_ctrl = nullptr;
+  value_type* m_slots = nullptr;
+  size_type m_capacity = 0;
+  size_type m_size = 0;
+  size_type m_growthLeft = 0;
+  std::hash<key_type> hash_fn;
+  std::allocator<value_type> m_allocator;
+
+  // std::hash is the identity for integers, which would put consecutive keys
+  // into the same group, so the hash is mixed before it is split.
+  size_type hashOf(const key_type& key) const {
+    std::uint64_t h = hash_fn(key);
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return static_cast<size_type>(h);
+  }
+
+  static size_type h1(size_type hash) { return hash >> 7; }
+
+  static ctrl_type h2(size_type hash) {
+    return static_cast<ctrl_type>(hash & 0x7f);
+  }
+
+  static size_type maxSizeFor(size_type capacity) {
+    return capacity - capacity / 8;
+  }
+
+  bool isFull(size_type index) const { return m_ctrl[index] >= 0; }
+
+  void setCtrl(size_type index, ctrl_type value) {
+    m_ctrl[index] = value;
+    if (index < FLATHASHMAP_GROUP_WIDTH)
+      m_ctrl[m_capacity + index] = value;
+  }
+
+  // Visits groups at triangular offsets, which reaches every group of a
+  // power-of-two sized table before repeating.
+  class ProbeSequence {
+   public:
+    ProbeSequence(size_type hash, size_type mask)
+        : m_mask(mask), m_offset(hash & mask), m_index(0) {}
+
+    size_type offset() const { return m_offset; }
+
+    size_type offset(int i) const { return (m_offset + i) & m_mask; }
+
+    void next() {
+      m_index += FLATHASHMAP_GROUP_WIDTH;
+      m_offset = (m_offset + m_index) & m_mask;
+    }
+
+   private:
+    size_type m_mask;
+    size_type m_offset;
+    size_type m_index;
+  };
+
+  size_type findIndex(const key_type& key, size_type hash) const {
+    if (!m_capacity)
+      return m_capacity;
+
+    ProbeSequence seq(h1(hash), m_capacity - 1);
+    while (true) {
+      Group group(m_ctrl + seq.offset());
+      for (bitmask_type match = group.match(h2(hash)); match;
+           match &= match - 1) {
+        const size_type index = seq.offset(trailingZeros(match));
+        if (m_slots[index].first == key)
+          return index;
+      }
+      if (group.matchEmpty())
+        return m_capacity;
+      seq.next();
+    }
+  }
+
+  size_type findIndex(const key_type& key) const {
+    return findIndex(key, hashOf(key));
+  }
+
+  size_type findFirstNonFull(size_type hash) const {
+    ProbeSequence seq(h1(hash), m_capacity - 1);
+    while (true) {
+      const bitmask_type mask =
+          Group(m_ctrl + seq.offset()).matchEmptyOrDeleted();
+      if (mask)
+        return seq.offset(trailingZeros(mask));
+      seq.next();
+    }
+  }
+
+  // Replaces the arrays only once both are allocated, so the map is left
+  // untouched if either allocation throws.
+  void allocate(size_type capacity) {
+    ctrl_type* ctrl = new ctrl_type[capacity + FLATHASHMAP_GROUP_WIDTH];
+    value_type* slots;
+    try {
+      slots = m_allocator.allocate(capacity);
+    } catch (...) {
+      delete[] ctrl;
+      throw;
+    }
+    std::memset(ctrl, kEmpty, capacity + FLATHASHMAP_GROUP_WIDTH);
+    m_ctrl = ctrl;
+    m_slots = slots;
+    m_capacity = capacity;
+    m_growthLeft = maxSizeFor(capacity) - m_size;
+  }
+
+  void destroyAll() {
+    for (size_type i = 0; i < m_capacity; ++i)
+      if (isFull(i))
+        m_slots[i].~value_type();
+  }
+
+  void deallocate() {
+    if (m_capacity) {
+      delete[] m_ctrl;
+      m_allocator.deallocate(m_slots, m_capacity);
+    }
+    m_ctrl = nullptr;
+    m_slots = nullptr;
+    m_capacity = 0;
+    m_growthLeft = 0;
+  }
+
+  // Rebuilds the table with the given capacity, which also drops all
+  // tombstones left behind by removals. Elements are moved only if that
+  // cannot throw, and copied otherwise, so that the old table is left intact
+  // if an element fails to transfer.
+  void resize(size_type capacity) {
+    ctrl_type* oldCtrl = m_ctrl;
+    value_type* oldSlots = m_slots;
+    const size_type oldCapacity = m_capacity;
+    const size_type oldGrowthLeft = m_growthLeft;
+
+    allocate(capacity);
+    try {
+      for (size_type i = 0; i < oldCapacity; ++i) {
+        if (oldCtrl[i] >= 0) {
+          const size_type hash = hashOf(oldSlots[i].first);
+          const size_type index = findFirstNonFull(hash);
+          ::new (static_cast<void*>(m_slots + index))
+              value_type(std::move_if_noexcept(oldSlots[i]));
+          setCtrl(index, h2(hash));
+        }
+      }
+    } catch (...) {
+      destroyAll();
+      deallocate();
+      m_ctrl = oldCtrl;
+      m_slots = oldSlots;
+      m_capacity = oldCapacity;
+      m_growthLeft = oldGrowthLeft;
+      throw;
+    }
+
+    if (oldCapacity) {
+      for (size_type i = 0; i < oldCapacity; ++i)
+        if (oldCtrl[i] >= 0)
+          oldSlots[i].~value_type();
+      delete[] oldCtrl;
+      m_allocator.deallocate(oldSlots, oldCapacity);
+    }
+  }
+
+  // Tombstones are reclaimed in place when they take up most of the table,
+  // otherwise the table doubles.
+  void rehashAndGrowIfNecessary() {
+    if (!m_capacity)
+      resize(FLATHASHMAP_MIN_CAPACITY);
+    else if (m_size <= maxSizeFor(m_capacity) / 2)
+      resize(m_capacity);
+    else
+      resize(m_capacity * 2);
+  }
+
+  // Finds the slot for a new element with the given hash, growing the table
+  // if needed. The slot stays free until commitInsert() is called for it,
+  // once the element has been constructed there.
+  size_type prepareInsert(size_type hash) {
+    size_type index = m_capacity ? findFirstNonFull(hash) : 0;
+    if (!m_growthLeft && (!m_capacity || m_ctrl[index] != kDeleted)) {
+      rehashAndGrowIfNecessary();
+      index = findFirstNonFull(hash);
+    }
+    return index;
+  }
+
+  void commitInsert(size_type index, size_type hash) {
+    if (m_ctrl[index] == kEmpty)
+      --m_growthLeft;
+    setCtrl(index, h2(hash));
+    ++m_size;
+  }
+
+  // A slot may become empty again, instead of a tombstone, only if no probe
+  // could ever have seen a full group around it.
+  void eraseAt(size_type index) {
+    m_slots[index].~value_type();
+    --m_size;
+
+    const size_type indexBefore =
+        (index - FLATHASHMAP_GROUP_WIDTH) & (m_capacity - 1);
+    const bitmask_type emptyAfter = Group(m_ctrl + index).matchEmpty();
+    const bitmask_type emptyBefore = Group(m_ctrl + indexBefore).matchEmpty();
+    const bool wasNeverFull =
+        emptyBefore && emptyAfter &&
+        trailingZeros(emptyAfter) + leadingZeros(emptyBefore) <
+            FLATHASHMAP_GROUP_WIDTH;
+
+    if (wasNeverFull) {
+      setCtrl(index, kEmpty);
+      ++m_growthLeft;
+    } else {
+      setCtrl(index, kDeleted);
+    }
+  }
+
+  void copyFrom(const FlatHashMap& other) {
+    if (!other.m_capacity)
+      return;
+
+    // A slot is marked full only once its copy exists, so a copy that
+    // throws leaves behind a table that can be torn down.
+    allocate(other.m_capacity);
+    try {
+      for (size_type i = 0; i < m_capacity; ++i) {
+        if (other.isFull(i))
+          ::new (static_cast<void*>(m_slots + i)) value_type(other.m_slots[i]);
+        setCtrl(i, other.m_ctrl[i]);
+      }
+    } catch (...) {
+      destroyAll();
+      deallocate();
+      throw;
+    }
+    m_size = other.m_size;
+    m_growthLeft = other.m_growthLeft;
+  }
+
+  void swapContents(FlatHashMap& other) {
+    std::swap(m_ctrl, other.m_ctrl);
+    std::swap(m_slots, other.m_slots);
+    std::swap(m_capacity, other.m_capacity);
+    std::swap(m_size, other.m_size);
+    std::swap(m_growthLeft, other.m_growthLeft);
+  }
+
+  size_type nextFull(size_type index) const {
+    while (index < m_capacity) {
+      const bitmask_type mask = Group(m_ctrl + index).matchFull();
+      if (mask) {
+        index += trailingZeros(mask);
+        return index < m_capacity ? index : m_capacity;
+      }
+      index += FLATHASHMAP_GROUP_WIDTH;
+    }
+    return m_capacity;
+  }
+
+ public:
+  FlatHashMap() {}
+
+  FlatHashMap(std::initializer_list<value_type> list) {
+    reserve(list.size());
+    for (const value_type& val : list)
+      (*this)[val.first] = val.second;
+  }
+
+  FlatHashMap(const FlatHashMap& other) { copyFrom(other); }
+
+  FlatHashMap(FlatHashMap&& other) { swapContents(other); }
+
+  ~FlatHashMap() {
+    destroyAll();
+    deallocate();
+  }
+
+  FlatHashMap& operator=(const FlatHashMap& other) {
+    if (this != &other) {
+      FlatHashMap copy(other);
+      swapContents(copy);
+    }
+    return *this;
+  }
+
+  FlatHashMap& operator=(FlatHashMap&& other) {
+    if (this != &other) {
+      destroyAll();
+      deallocate();
+      m_size = 0;
+      swapContents(other);
+    }
+    return *this;
+  }
+
+  bool isEmpty() const { return !m_size; }
+
+  mapped_type& operator[](const key_type& key) {
+    const size_type hash = hashOf(key);
+    size_type index = findIndex(key, hash);
+    if (index == m_capacity) {
+      index = prepareInsert(hash);
+      ::new (static_cast<void*>(m_slots + index))
+          value_type(key, mapped_type{});
+      commitInsert(index, hash);
+    }
+    return m_slots[index].second;
+  }
+
+  const mapped_type& valueOf(const key_type& key) const {
+    const size_type index = findIndex(key);
+    if (index == m_capacity)
+      throw std::out_of_range("Element with given key does not exist");
+    return m_slots[index].second;
+  }
+
+  mapped_type& valueOf(const key_type& key) {
+    const size_type index = findIndex(key);
+    if (index == m_capacity)
+      throw std::out_of_range("Element with given key does not exist");
+    return m_slots[index].second;
+  }
+
+  const_iterator find(const key_type& key) const {
+    return const_iterator(*this, findIndex(key));
+  }
+
+  iterator find(const key_type& key) {
+    return iterator(*this, findIndex(key));
+  }
+
+  void remove(const key_type& key) {
+    const size_type index = findIndex(key);
+    if (index == m_capacity)
+      throw std::out_of_range("Element with given key does not exist");
+    eraseAt(index);
+  }
+
+  // Removes the element the iterator points to and returns an iterator to
+  // the following one. Other elements never move on removal.
+  iterator remove(const const_iterator& it) {
+    if (it.m_source != this || it.m_index >= m_capacity)
+      throw std::out_of_range("Element with given key does not exist");
+    eraseAt(it.m_index);
+    return iterator(*this, nextFull(it.m_index + 1));
+  }
+
+  size_type getSize() const { return m_size; }
+
+  size_type getCapacity() const { return m_capacity; }
+
+  // Makes room for `count` elements, so that inserting them does not trigger
+  // any further rehash.
+  void reserve(size_type count) {
+    if (count <= m_size + m_growthLeft)
+      return;
+
+    size_type capacity = FLATHASHMAP_MIN_CAPACITY;
+    while (maxSizeFor(capacity) < count)
+      capacity <<= 1;
+    resize(capacity);
+  }
+
+  bool operator==(const FlatHashMap& other) const {
+    if (this->getSize() != other.getSize())
+      return false;
+
+    for (const auto& elem : *this) {
+      const size_type index = other.findIndex(elem.first);
+      if (index == other.m_capacity ||
+          !(other.m_slots[index].second == elem.second))
+        return false;
+    }
+
+    return true;
+  }
+
+  bool operator!=(const FlatHashMap& other) const { return !(*this == other); }
+
+  iterator begin() { return iterator(*this, nextFull(0)); }
+
+  iterator end() { return iterator(*this, m_capacity); }
+
+  const_iterator cbegin() const { return const_iterator(*this, nextFull(0)); }
+
+  const_iterator cend() const { return const_iterator(*this, m_capacity); }
+
+  const_iterator begin() const { return cbegin(); }
+
+  const_iterator end() const { return cend(); }
+};
+
+template <typename KeyType, typename ValueType>
+class FlatHashMap<KeyType, ValueType>::ConstIterator {
+ public:
+  using reference = typename FlatHashMap::const_reference;
+  using iterator_category = std::bidirectional_iterator_tag;
+  using value_type = typename FlatHashMap::value_type;
+  using difference_type = std::ptrdiff_t;
+  using pointer = const typename FlatHashMap::value_type*;
+  using size_type = typename FlatHashMap::size_type;
+
+  friend class FlatHashMap;
+
+ protected:
+  const FlatHashMap* m_source;
+  size_type m_index;
+
+ public:
+  explicit ConstIterator(const FlatHashMap& source, size_type index)
+      : m_source(&source), m_index(index) {}
+
+  ConstIterator& operator++() {
+    if (m_index >= m_source->m_capacity)
+      throw std::out_of_range("Next iterator does not exist");
+
+    m_index = m_source->nextFull(m_index + 1);
+    return *this;
+  }
+
+  ConstIterator operator++(int) {
+    ConstIterator tmp(*this);
+    ++(*this);
+    return tmp;
+  }
+
+  ConstIterator& operator--() {
+    for (size_type i = m_index; i; --i) {
+      if (m_source->isFull(i - 1)) {
+        m_index = i - 1;
+        return *this;
+      }
+    }
+
+    throw std::out_of_range("Previous iterator does not exist");
+  }
+
+  ConstIterator operator--(int) {
+    ConstIterator tmp(*this);
+    --(*this);
+    return tmp;
+  }
+
+  reference operator*() const {
+    if (m_index >= m_source->m_capacity)
+      throw std::out_of_range("Iterator does not have a value");
+    return m_source->m_slots[m_index];
+  }
+
+  pointer operator->() const { return &this->operator*(); }
+
+  bool operator==(const ConstIterator& other) const {
+    return m_source == other.m_source && m_index == other.m_index;
+  }
+
+  bool operator!=(const ConstIterator& other) const {
+    return !(*this == other);
+  }
+};
+
+template <typename KeyType, typename ValueType>
+class FlatHashMap<KeyType, ValueType>::Iterator
+    : public FlatHashMap<KeyType, ValueType>::ConstIterator {
+ public:
+  using reference = typename FlatHashMap::reference;
+  using pointer = typename FlatHashMap::value_type*;
+
+  explicit Iterator(const FlatHashMap& source, size_type index)
+      : ConstIterator(source, index) {}
+
+  Iterator(const ConstIterator& other) : ConstIterator(other) {}
+
+  Iterator& operator++() {
+    ConstIterator::operator++();
+    return *this;
+  }
+
+  Iterator operator++(int) {
+    auto result = *this;
+    ConstIterator::operator++();
+    return result;
+  }
+
+  Iterator& operator--() {
+    ConstIterator::operator--();
+    return *this;
+  }
+
+  Iterator operator--(int) {
+    auto result = *this;
+    ConstIterator::operator--();
+    return result;
+  }
+
+  pointer operator->() const { return &this->operator*(); }
+
+  reference operator*() const {
+    // ugly cast, yet reduces code duplication.
+    return const_cast<reference>(ConstIterator::operator*());
+  }
+};
+
+}  // namespace aisdi
+
+#endif /* AISDI_MAPS_FLATHASHMAP_H */
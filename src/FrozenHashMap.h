@@ -0,0 +1,392 @@
+#ifndef AISDI_MAPS_FROZENHASHMAP_H
+#define AISDI_MAPS_FROZENHASHMAP_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "KeyedHash.h"
+
+#define FROZENHASHMAP_KEYS_PER_BUCKET 4
+#define FROZENHASHMAP_LOAD_FACTOR 0.97
+#define FROZENHASHMAP_MAX_PILOT 0xffff
+#define FROZENHASHMAP_MAX_ATTEMPTS 16
+
+namespace aisdi {
+
+// Immutable hash map built on a minimal perfect hash function, which sends
+// each of its n keys to a distinct slot in [0, n) of a flat array of
+// elements, so there are no chains, no empty slots and no per-element
+// pointers.
+//
+// The function is built by hash and displace, as in CHD and PTHash. Keys are
+// split into buckets of FROZENHASHMAP_KEYS_PER_BUCKET keys on average, and
+// buckets, largest first, are given the first 16-bit pilot value that sends
+// all their keys to free positions of a table slightly larger than n. The
+// few keys sent past n are remapped to the slots left free below it. A
+// lookup thus reads a pilot, rarely a remapped position, and the element,
+// whose key it compares; about 5 bits per key are spent on pilots and
+// remapping.
+//
+// No pilot can tell apart keys with equal hashes, so of every set of such
+// keys only one goes through the perfect hash function. The others are kept
+// after the slots, in a stash ordered by hash, which a lookup searches when
+// the key in its slot is a different one. Lookups of these keys take a
+// binary search, and a linear scan of the keys sharing their hash.
+template <typename KeyType,
+          typename ValueType,
+          typename Hash = KeyedHash<KeyType>,
+          typename KeyEqual = std::equal_to<KeyType>>
+class FrozenHashMap {
+ public:
+  using key_type = KeyType;
+  using mapped_type = ValueType;
+  using value_type = std::pair<const key_type, mapped_type>;
+  using size_type = std::size_t;
+  using const_reference = const value_type&;
+  using hasher = Hash;
+  using key_equal = KeyEqual;
+  using const_iterator = typename std::vector<value_type>::const_iterator;
+
+ private:
+  Hash hash_fn;
+  KeyEqual equal_fn;
+  std::uint64_t m_seed = 0;
+  std::uint32_t m_bucketCount = 0;
+  std::uint32_t m_denseBucketCount = 0;
+  std::uint32_t m_tableSize = 0;
+  // Keys placed by the perfect hash function, which come first among the
+  // elements.
+  std::uint32_t m_mainSize = 0;
+  std::vector<std::uint16_t> m_pilots;
+  // Slot below the element count for every table position past it.
+  std::vector<std::uint32_t> m_remap;
+  // Elements ordered by slot, then the stash.
+  std::vector<value_type> m_elements;
+  // Hashes of the stashed elements, in ascending order.
+  std::vector<std::uint64_t> m_stashHashes;
+
+  static std::uint64_t mix(std::uint64_t h) {
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return h;
+  }
+
+  // Maps the high 32 bits of `value` onto [0, range) without a division.
+  static std::uint32_t reduce(std::uint64_t value, std::uint32_t range) {
+    return static_cast<std::uint32_t>(((value >> 32) * range) >> 32);
+  }
+
+  std::uint64_t seeded(std::uint64_t hash) const {
+    return mix(hash ^ m_seed);
+  }
+
+  // As in PTHash, 60% of the keys go to the first 30% of the buckets. Large
+  // buckets are placed early, while the table is still mostly free, which
+  // leaves fewer keys to place once it fills up.
+  std::uint32_t bucketOf(std::uint64_t seededHash) const {
+    if (static_cast<std::uint32_t>(seededHash) < 0x9999999aU)
+      return reduce(seededHash, m_denseBucketCount);
+    return m_denseBucketCount +
+           reduce(seededHash, m_bucketCount - m_denseBucketCount);
+  }
+
+  static std::uint64_t keyPart(std::uint64_t seededHash) {
+    return mix(seededHash + 0x9e3779b97f4a7c15ULL);
+  }
+
+  static std::uint64_t pilotPart(std::uint16_t pilot) {
+    return (pilot + 1) * 0x9e3779b97f4a7c15ULL;
+  }
+
+  std::uint32_t positionOf(std::uint64_t keyBits,
+                           std::uint64_t pilotBits) const {
+    // The product spreads keys whose bits differ only slightly, which would
+    // otherwise collide whatever the pilot.
+    return reduce((keyBits ^ pilotBits) * 0xbf58476d1ce4e5b9ULL, m_tableSize);
+  }
+
+  std::uint32_t slotOf(std::uint64_t hash) const {
+    const std::uint64_t h = seeded(hash);
+    const std::uint32_t position =
+        positionOf(keyPart(h), pilotPart(m_pilots[bucketOf(h)]));
+    return position < m_mainSize ? position : m_remap[position - m_mainSize];
+  }
+
+  const_iterator findInStash(std::uint64_t hash, const key_type& key) const {
+    const auto range =
+        std::equal_range(m_stashHashes.begin(), m_stashHashes.end(), hash);
+    for (auto h = range.first; h != range.second; ++h) {
+      const const_iterator it =
+          m_elements.begin() + m_mainSize + (h - m_stashHashes.begin());
+      if (equal_fn(it->first, key))
+        return it;
+    }
+    return end();
+  }
+
+  // Marks all but one of every set of equal hashes. Hashes are first grouped
+  // by a mix of them, so that only small groups get sorted, unless many keys
+  // share a hash.
+  static std::vector<bool> findCollisions(
+      const std::vector<std::uint64_t>& hashes) {
+    const size_type count = hashes.size();
+    const std::uint32_t groupCount = static_cast<std::uint32_t>(count);
+    std::vector<std::uint32_t> groupStart(count + 1, 0);
+    for (std::uint64_t hash : hashes)
+      ++groupStart[reduce(mix(hash), groupCount) + 1];
+    for (size_type g = 0; g < count; ++g)
+      groupStart[g + 1] += groupStart[g];
+
+    std::vector<std::uint32_t> members(count);
+    std::vector<std::uint32_t> next(groupStart.begin(), groupStart.end() - 1);
+    for (size_type i = 0; i < count; ++i)
+      members[next[reduce(mix(hashes[i]), groupCount)]++] =
+          static_cast<std::uint32_t>(i);
+
+    std::vector<bool> collides(count, false);
+    for (size_type g = 0; g < count; ++g) {
+      const auto first = members.begin() + groupStart[g];
+      const auto last = members.begin() + groupStart[g + 1];
+      if (last - first < 2)
+        continue;
+      std::sort(first, last, [&](std::uint32_t a, std::uint32_t b) {
+        return hashes[a] < hashes[b];
+      });
+      for (auto it = first + 1; it != last; ++it)
+        collides[*it] = hashes[*it] == hashes[*(it - 1)];
+    }
+    return collides;
+  }
+
+  // Tries to find pilots for all buckets with the current seed, filling
+  // `positions` with the table position of every key. Returns false if some
+  // bucket gets no pilot.
+  bool placeKeys(const std::vector<std::uint64_t>& hashes,
+                 std::vector<std::uint32_t>& positions) {
+    const size_type count = hashes.size();
+    std::vector<std::uint64_t> seededHashes(count);
+    std::vector<std::uint64_t> keyParts(count);
+    std::vector<std::uint32_t> bucketStart(m_bucketCount + 1, 0);
+    for (size_type i = 0; i < count; ++i) {
+      seededHashes[i] = seeded(hashes[i]);
+      keyParts[i] = keyPart(seededHashes[i]);
+      ++bucketStart[bucketOf(seededHashes[i]) + 1];
+    }
+    for (std::uint32_t b = 0; b < m_bucketCount; ++b)
+      bucketStart[b + 1] += bucketStart[b];
+
+    // Keys grouped by bucket, and buckets ordered from the largest down.
+    std::vector<std::uint32_t> keys(count);
+    std::vector<std::uint32_t> next(bucketStart.begin(),
+                                    bucketStart.end() - 1);
+    for (size_type i = 0; i < count; ++i)
+      keys[next[bucketOf(seededHashes[i])]++] = static_cast<std::uint32_t>(i);
+    std::vector<std::uint32_t> buckets(m_bucketCount);
+    for (std::uint32_t b = 0; b < m_bucketCount; ++b)
+      buckets[b] = b;
+    std::stable_sort(buckets.begin(), buckets.end(),
+                     [&](std::uint32_t a, std::uint32_t b) {
+                       return bucketStart[a + 1] - bucketStart[a] >
+                              bucketStart[b + 1] - bucketStart[b];
+                     });
+
+    std::vector<bool> taken(m_tableSize, false);
+    std::vector<std::uint32_t> trial;
+    for (std::uint32_t b : buckets) {
+      const std::uint32_t first = bucketStart[b];
+      const std::uint32_t last = bucketStart[b + 1];
+      if (first == last)
+        break;
+
+      std::uint32_t pilot = 0;
+      for (; pilot <= FROZENHASHMAP_MAX_PILOT; ++pilot) {
+        const std::uint64_t part =
+            pilotPart(static_cast<std::uint16_t>(pilot));
+        trial.clear();
+        for (std::uint32_t k = first; k < last; ++k) {
+          const std::uint32_t position = positionOf(keyParts[keys[k]], part);
+          if (taken[position] ||
+              std::find(trial.begin(), trial.end(), position) != trial.end())
+            break;
+          trial.push_back(position);
+        }
+        if (trial.size() == last - first)
+          break;
+      }
+      if (pilot > FROZENHASHMAP_MAX_PILOT)
+        return false;
+
+      m_pilots[b] = static_cast<std::uint16_t>(pilot);
+      for (std::uint32_t k = first; k < last; ++k) {
+        positions[keys[k]] = trial[k - first];
+        taken[trial[k - first]] = true;
+      }
+    }
+
+    // Positions past the element count go to the free slots below it.
+    const size_type extra = m_tableSize - count;
+    m_remap.assign(extra, 0);
+    std::uint32_t freeSlot = 0;
+    for (size_type p = count; p < m_tableSize; ++p) {
+      if (!taken[p])
+        continue;
+      while (taken[freeSlot])
+        ++freeSlot;
+      m_remap[p - count] = freeSlot++;
+    }
+    return true;
+  }
+
+ public:
+  explicit FrozenHashMap(const Hash& hash = Hash(),
+                         const KeyEqual& equal = KeyEqual())
+      : hash_fn(hash), equal_fn(equal) {}
+
+  // Freezes the pairs of [first, last), whose keys must be distinct.
+  template <typename InputIt>
+  FrozenHashMap(InputIt first,
+                InputIt last,
+                const Hash& hash = Hash(),
+                const KeyEqual& equal = KeyEqual())
+      : hash_fn(hash), equal_fn(equal) {
+    std::vector<std::pair<key_type, mapped_type>> items;
+    for (; first != last; ++first)
+      items.emplace_back(first->first, first->second);
+    const size_type count = items.size();
+    if (!count)
+      return;
+    if (count >= 0xffffffffU / 2)
+      throw std::length_error("Too many keys to freeze");
+
+    std::vector<std::uint64_t> hashes(count);
+    for (size_type i = 0; i < count; ++i)
+      hashes[i] = hash_fn(items[i].first);
+    const std::vector<bool> stashed = findCollisions(hashes);
+    std::vector<std::uint32_t> mainItems;
+    std::vector<std::uint32_t> stashItems;
+    std::vector<std::uint64_t> mainHashes;
+    for (size_type i = 0; i < count; ++i) {
+      if (stashed[i]) {
+        stashItems.push_back(static_cast<std::uint32_t>(i));
+      } else {
+        mainItems.push_back(static_cast<std::uint32_t>(i));
+        mainHashes.push_back(hashes[i]);
+      }
+    }
+    const size_type mainCount = mainItems.size();
+    m_mainSize = static_cast<std::uint32_t>(mainCount);
+
+    m_bucketCount = static_cast<std::uint32_t>(
+        (mainCount + FROZENHASHMAP_KEYS_PER_BUCKET - 1) /
+        FROZENHASHMAP_KEYS_PER_BUCKET);
+    // With fewer than 4 buckets the dense part is empty, and its keys go to
+    // bucket 0.
+    m_denseBucketCount = m_bucketCount * 3 / 10;
+    m_tableSize = std::max(static_cast<std::uint32_t>(mainCount),
+                           static_cast<std::uint32_t>(
+                               mainCount / FROZENHASHMAP_LOAD_FACTOR));
+    m_pilots.assign(m_bucketCount, 0);
+
+    std::vector<std::uint32_t> positions(mainCount);
+    KeyedHash<std::uint64_t> seeds(hashes[0]);
+    for (int attempt = 0;; ++attempt) {
+      if (attempt == FROZENHASHMAP_MAX_ATTEMPTS)
+        throw std::runtime_error("No perfect hash function found");
+      m_seed = seeds(attempt);
+      if (placeKeys(mainHashes, positions))
+        break;
+    }
+
+    std::vector<std::uint32_t> itemAt(count);
+    for (size_type i = 0; i < mainCount; ++i) {
+      const std::uint32_t position = positions[i];
+      itemAt[position < mainCount ? position
+                                  : m_remap[position - mainCount]] =
+          mainItems[i];
+    }
+    std::stable_sort(stashItems.begin(), stashItems.end(),
+                     [&](std::uint32_t a, std::uint32_t b) {
+                       return hashes[a] < hashes[b];
+                     });
+    std::copy(stashItems.begin(), stashItems.end(),
+              itemAt.begin() + mainCount);
+    m_stashHashes.reserve(stashItems.size());
+    for (std::uint32_t i : stashItems)
+      m_stashHashes.push_back(hashes[i]);
+
+    m_elements.reserve(count);
+    for (size_type slot = 0; slot < count; ++slot)
+      m_elements.emplace_back(std::move(items[itemAt[slot]].first),
+                              std::move(items[itemAt[slot]].second));
+  }
+
+  bool isEmpty() const { return m_elements.empty(); }
+
+  size_type getSize() const { return m_elements.size(); }
+
+  const mapped_type& valueOf(const key_type& key) const {
+    const const_iterator it = find(key);
+    if (it == end())
+      throw std::out_of_range("Element with given key does not exist");
+    return it->second;
+  }
+
+  const_iterator find(const key_type& key) const {
+    if (m_elements.empty())
+      return end();
+    const std::uint64_t hash = hash_fn(key);
+    const const_iterator it = m_elements.begin() + slotOf(hash);
+    return equal_fn(it->first, key) ? it : findInStash(hash, key);
+  }
+
+  bool contains(const key_type& key) const { return find(key) != end(); }
+
+  hasher getHashFunction() const { return hash_fn; }
+
+  // Number of elements kept in the stash, because their hashes equal that
+  // of another key.
+  size_type getStashSize() const { return m_stashHashes.size(); }
+
+  // Bytes held by the map: elements, pilots, remapped positions and stashed
+  // hashes.
+  size_type getMemoryUsage() const {
+    return m_elements.capacity() * sizeof(value_type) +
+           m_pilots.capacity() * sizeof(std::uint16_t) +
+           m_remap.capacity() * sizeof(std::uint32_t) +
+           m_stashHashes.capacity() * sizeof(std::uint64_t);
+  }
+
+  bool operator==(const FrozenHashMap& other) const {
+    if (getSize() != other.getSize())
+      return false;
+    for (const value_type& item : m_elements) {
+      const const_iterator it = other.find(item.first);
+      if (it == other.end() || !(it->second == item.second))
+        return false;
+    }
+    return true;
+  }
+
+  bool operator!=(const FrozenHashMap& other) const {
+    return !(*this == other);
+  }
+
+  const_iterator cbegin() const { return m_elements.cbegin(); }
+
+  const_iterator cend() const { return m_elements.cend(); }
+
+  const_iterator begin() const { return cbegin(); }
+
+  const_iterator end() const { return cend(); }
+};
+}  // namespace aisdi
+
+#endif /* AISDI_MAPS_FROZENHASHMAP_H */
@@ -2,20 +2,46 @@
 #define AISDI_MAPS_HASHMAP_H
 
 #include <algorithm>
-#include <array>
+#include <atomic>
 #include <cstddef>
+#include <cstdint>
 #include <functional>
 #include <initializer_list>
-#include <list>
+#include <iterator>
+#include <memory>
 #include <stdexcept>
 #include <string>
+#include <tuple>
+#include <type_traits>
 #include <utility>
-
-#define HASHMAP_SIZE 8192
+#include <vector>
+
+#include "FrozenHashMap.h"
+#include "KeyedHash.h"
+#include "NodePool.h"
+#include "RedBlackTree.h"
+#include "ThreadPool.h"
+
+#define HASHMAP_MIN_BUCKET_COUNT 8
+#define HASHMAP_SMALL_SIZE 8
+#define HASHMAP_TREEIFY_THRESHOLD 8
+#define HASHMAP_UNTREEIFY_THRESHOLD 6
+#define HASHMAP_DEFAULT_MAX_LOAD_FACTOR 1.0f
+#define HASHMAP_OCCUPANCY_WORD_BITS 64
+#define HASHMAP_PREFETCH_DISTANCE 8
+#define HASHMAP_REHASH_STEP 4
+#define HASHMAP_PARALLEL_GRAIN 16384
 
 namespace aisdi {
 
-template <typename KeyType, typename ValueType>
+// Keys are hashed with a KeyedHash seeded differently for every map, unless
+// another hash function is given.
+template <typename KeyType,
+          typename ValueType,
+          typename Hash = KeyedHash<KeyType>,
+          typename KeyEqual = std::equal_to<KeyType>,
+          typename Allocator =
+              std::allocator<std::pair<const KeyType, ValueType>>>
 class HashMap {
  public:
   using key_type = KeyType;
@@ -24,6 +50,9 @@ class HashMap {
   using size_type = std::size_t;
   using reference = value_type&;
   using const_reference = const value_type&;
+  using hasher = Hash;
+  using key_equal = KeyEqual;
+  using allocator_type = Allocator;
 
   class ConstIterator;
   class Iterator;
@@ -31,188 +60,1579 @@ class HashMap {
   using const_iterator = ConstIterator;
 
  private:
-  std::array<std::list<value_type>, HASHMAP_SIZE> m_data;
+  // Chains are hand-linked nodes drawn from the map's own pool. Every node
+  // keeps the full hash of its key, so that rehashing, removal by iterator
+  // and comparison never hash a key again, and chain walks only compare keys
+  // whose hashes match.
+  struct Node {
+    template <typename... Args>
+    explicit Node(size_type hash, Args&&... args)
+        : m_hash(hash), m_value(std::forward<Args>(args)...) {}
+
+    Node* m_next = nullptr;
+    // The head of a chain points back to its tail, so appending is O(1).
+    Node* m_prev = nullptr;
+    size_type m_hash;
+    value_type m_value;
+  };
+
+  template <typename T>
+  using rebind_allocator =
+      typename std::allocator_traits<Allocator>::template rebind_alloc<T>;
+
+  // Leaves value-initialized elements uninitialized, so that a bucket table
+  // can be allocated without touching its memory. Explicitly given values are
+  // still constructed.
+  template <typename T>
+  class BucketAllocator : public rebind_allocator<T> {
+   public:
+    template <typename U>
+    struct rebind {
+      using other = BucketAllocator<U>;
+    };
+
+    explicit BucketAllocator(const Allocator& allocator)
+        : rebind_allocator<T>(allocator) {}
+
+    template <typename U>
+    BucketAllocator(const BucketAllocator<U>& other)
+        : rebind_allocator<T>(other) {}
+
+    template <typename U>
+    void construct(U* pointer) {
+      ::new (static_cast<void*>(pointer)) U;
+    }
+
+    template <typename U, typename... Args>
+    void construct(U* pointer, Args&&... args) {
+      std::allocator_traits<rebind_allocator<T>>::construct(
+          *this, pointer, std::forward<Args>(args)...);
+    }
+  };
+
+  using pool_type = NodePool<Node, Allocator>;
+  using occupancy_word = std::uint64_t;
+  using data_type = std::vector<Node*, BucketAllocator<Node*>>;
+  using occupancy_type =
+      std::vector<occupancy_word, rebind_allocator<occupancy_word>>;
+
+  // Search tree over the chain of an overloaded bucket, so that a hash
+  // function piling many keys into one bucket makes lookups in it O(log n)
+  // instead of O(n). The chain itself stays as it is, for iteration, removal
+  // and rehashing; the tree only indexes its nodes.
+  struct TreeNode {
+    enum Color { BLACK, RED };
+
+    TreeNode* m_p;
+    TreeNode* m_left;
+    TreeNode* m_right;
+    Color m_color;
+    Node* m_node;
+  };
+
+  struct Tree {
+    Tree(size_type index, const Allocator& allocator)
+        : m_index(index), m_root(&m_nil), m_pool(allocator) {
+      m_nil.m_p = m_nil.m_left = m_nil.m_right = &m_nil;
+      m_nil.m_color = TreeNode::BLACK;
+    }
+
+    Tree(const Tree&) = delete;
+    Tree& operator=(const Tree&) = delete;
+
+    RedBlackTree<TreeNode> view() {
+      return RedBlackTree<TreeNode>(m_root, &m_nil);
+    }
+
+    // Bucket of the chain, in the index space of headAt().
+    size_type m_index;
+    TreeNode m_nil;
+    TreeNode* m_root;
+    size_type m_size = 0;
+    NodePool<TreeNode, Allocator> m_pool;
+  };
+
+  using tree_allocator = rebind_allocator<Tree>;
+  using trees_type = std::vector<Tree*, rebind_allocator<Tree*>>;
+
+  Hash hash_fn;
+  KeyEqual equal_fn;
+  Allocator m_allocator;
+  pool_type m_pool;
+  // Heads of the chains. Bucket count is always a power of two, so that the
+  // bucket index can be computed with a mask instead of a division.
+  data_type m_data;
+  // One bit per bucket, set when the bucket is not empty. Iteration skips
+  // empty buckets a whole word at a time instead of visiting each of them.
+  occupancy_type m_occupied;
+  // While an incremental rehash is in progress, the table being drained.
+  // Its buckets below m_rehashIndex have already been moved to m_data.
+  // Bucket indices past m_data.size() refer to this table, so that
+  // iterators and the chain helpers can address both tables alike.
+  data_type m_oldData;
+  occupancy_type m_oldOccupied;
+  // Until the map first holds more than HASHMAP_SMALL_SIZE elements, it has
+  // no bucket table at all: every node sits in this single chain, searched
+  // linearly, and addressed as bucket 0. Creating, copying and destroying
+  // small maps thus never allocates a table.
+  Node* m_smallChain = nullptr;
+  // Trees of the buckets whose chains are longer than
+  // HASHMAP_TREEIFY_THRESHOLD nodes, sorted by bucket. Empty unless the hash
+  // function collides badly.
+  trees_type m_trees;
+  size_type m_rehashIndex = 0;
   size_type m_size = 0;
-  std::hash<key_type> hash_fn;
+  // Sum of the mixed hashes of all keys. Addition makes it independent of
+  // insertion order and lets removal undo an insertion exactly.
+  std::uint64_t m_fingerprint = 0;
+  float m_maxLoadFactor = HASHMAP_DEFAULT_MAX_LOAD_FACTOR;
+  bool m_incrementalRehash = false;
+
+  static size_type roundUpToPowerOfTwo(size_type count) {
+    size_type result = HASHMAP_MIN_BUCKET_COUNT;
+    while (result < count)
+      result <<= 1;
+    return result;
+  }
 
- public:
-  HashMap() {}
+  data_type emptyBuckets(size_type bucketCount) const {
+    return data_type(bucketCount, nullptr, BucketAllocator<Node*>(m_allocator));
+  }
+
+  // Bucket table with indeterminate heads. An incremental rehash clears
+  // buckets just before the first chain may be linked to them.
+  data_type uninitializedBuckets(size_type bucketCount) const {
+    return data_type(bucketCount, BucketAllocator<Node*>(m_allocator));
+  }
+
+  occupancy_type emptyOccupancy(size_type bucketCount) const {
+    return occupancy_type((bucketCount + HASHMAP_OCCUPANCY_WORD_BITS - 1) /
+                              HASHMAP_OCCUPANCY_WORD_BITS,
+                          0, rebind_allocator<occupancy_word>(m_allocator));
+  }
+
+  static occupancy_word occupancyBit(size_type index) {
+    return occupancy_word(1) << (index % HASHMAP_OCCUPANCY_WORD_BITS);
+  }
+
+  void markEmpty(size_type index) {
+    if (isSmall())
+      return;
+    if (index < m_data.size()) {
+      m_occupied[index / HASHMAP_OCCUPANCY_WORD_BITS] &= ~occupancyBit(index);
+    } else {
+      index -= m_data.size();
+      m_oldOccupied[index / HASHMAP_OCCUPANCY_WORD_BITS] &=
+          ~occupancyBit(index);
+    }
+  }
+
+  // Returns the first non-empty bucket in [index, end) of a table, or `end`
+  // if there is none.
+  static size_type nextOccupiedIn(const occupancy_type& occupied,
+                                  size_type index,
+                                  size_type end) {
+    if (index >= end)
+      return end;
+
+    size_type word = index / HASHMAP_OCCUPANCY_WORD_BITS;
+    occupancy_word bits =
+        occupied[word] &
+        (~occupancy_word(0) << (index % HASHMAP_OCCUPANCY_WORD_BITS));
+    while (!bits) {
+      if (++word * HASHMAP_OCCUPANCY_WORD_BITS >= end)
+        return end;
+      bits = occupied[word];
+    }
+    return std::min(end,
+                    word * HASHMAP_OCCUPANCY_WORD_BITS + __builtin_ctzll(bits));
+  }
+
+  // Returns the last non-empty bucket before `index` of a table, or
+  // `bucketCount` if there is none.
+  static size_type previousOccupiedIn(const occupancy_type& occupied,
+                                      size_type bucketCount,
+                                      size_type index) {
+    if (!index)
+      return bucketCount;
+
+    --index;
+    size_type word = index / HASHMAP_OCCUPANCY_WORD_BITS;
+    const size_type bit = index % HASHMAP_OCCUPANCY_WORD_BITS;
+    occupancy_word bits =
+        occupied[word] &
+        (~occupancy_word(0) >> (HASHMAP_OCCUPANCY_WORD_BITS - 1 - bit));
+    while (!bits) {
+      if (!word--)
+        return bucketCount;
+      bits = occupied[word];
+    }
+    return word * HASHMAP_OCCUPANCY_WORD_BITS + HASHMAP_OCCUPANCY_WORD_BITS -
+           1 - __builtin_clzll(bits);
+  }
+
+  bool isSmall() const { return m_data.empty(); }
+
+  // Number of addressable buckets, counting those of a table being drained.
+  size_type bucketSpan() const {
+    return isSmall() ? 1 : m_data.size() + m_oldData.size();
+  }
+
+  // Returns the first non-empty bucket at or after `index`, or the bucket
+  // span if there is none.
+  size_type nextOccupied(size_type index) const {
+    if (isSmall())
+      return index || !m_smallChain ? 1 : 0;
+
+    const size_type bucketCount = m_data.size();
+    if (index < bucketCount) {
+      const size_type next = nextOccupiedIn(m_occupied, index, bucketCount);
+      if (next < bucketCount)
+        return next;
+      index = bucketCount;
+    }
+    return bucketCount + nextOccupiedIn(m_oldOccupied, index - bucketCount,
+                                        m_oldData.size());
+  }
+
+  // Returns the last non-empty bucket before `index`, or the bucket span if
+  // there is none.
+  size_type previousOccupied(size_type index) const {
+    if (isSmall())
+      return index && m_smallChain ? 0 : 1;
+
+    const size_type bucketCount = m_data.size();
+    if (index > bucketCount) {
+      const size_type previous = previousOccupiedIn(
+          m_oldOccupied, m_oldData.size(), index - bucketCount);
+      if (previous < m_oldData.size())
+        return bucketCount + previous;
+      index = bucketCount;
+    }
+    const size_type previous =
+        previousOccupiedIn(m_occupied, bucketCount, index);
+    return previous < bucketCount ? previous : bucketSpan();
+  }
+
+  Node*& headAt(size_type index) {
+    if (isSmall())
+      return m_smallChain;
+    return index < m_data.size() ? m_data[index]
+                                 : m_oldData[index - m_data.size()];
+  }
+
+  Node* const& headAt(size_type index) const {
+    if (isSmall())
+      return m_smallChain;
+    return index < m_data.size() ? m_data[index]
+                                 : m_oldData[index - m_data.size()];
+  }
+
+  // Keys whose bucket in the old table has not been drained yet are still
+  // found there.
+  size_type bucketIndex(size_type hash) const {
+    if (isSmall())
+      return 0;
+    if (!m_oldData.empty()) {
+      const size_type oldIndex = hash & (m_oldData.size() - 1);
+      if (oldIndex >= m_rehashIndex)
+        return m_data.size() + oldIndex;
+    }
+    return hash & (m_data.size() - 1);
+  }
+
+  static std::uint64_t fingerprintOf(size_type hash) {
+    std::uint64_t h = hash;
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return h;
+  }
+
+  // Smallest bucket count able to hold `count` elements without exceeding
+  // the maximum load factor.
+  size_type minBucketCountFor(size_type count) const {
+    return roundUpToPowerOfTwo(
+        static_cast<size_type>(static_cast<double>(count) / m_maxLoadFactor) +
+        1);
+  }
+
+  // Appends `node` to the chain starting at `head`. Returns true if the chain
+  // was empty.
+  static bool appendToChain(Node*& head, Node* node) {
+    node->m_next = nullptr;
+    if (!head) {
+      node->m_prev = node;
+      head = node;
+      return true;
+    }
+    node->m_prev = head->m_prev;
+    head->m_prev->m_next = node;
+    head->m_prev = node;
+    return false;
+  }
+
+  // Appends `node` to the chain of bucket `index` in the given table.
+  static void linkBack(data_type& data,
+                       occupancy_type& occupied,
+                       size_type index,
+                       Node* node) {
+    if (appendToChain(data[index], node))
+      occupied[index / HASHMAP_OCCUPANCY_WORD_BITS] |= occupancyBit(index);
+  }
+
+  void linkBack(size_type index, Node* node) {
+    if (isSmall())
+      appendToChain(m_smallChain, node);
+    else if (index < m_data.size())
+      linkBack(m_data, m_occupied, index, node);
+    else
+      linkBack(m_oldData, m_oldOccupied, index - m_data.size(), node);
+  }
+
+  void unlink(size_type index, Node* node) {
+    Node*& head = headAt(index);
+    if (node == head) {
+      head = node->m_next;
+      if (head)
+        head->m_prev = node->m_prev;
+      else
+        markEmpty(index);
+    } else {
+      node->m_prev->m_next = node->m_next;
+      if (node->m_next)
+        node->m_next->m_prev = node->m_prev;
+      else
+        head->m_prev = node->m_prev;
+    }
+  }
+
+  // Moves every node to a table of `bucketCount` buckets at once, finishing
+  // any incremental rehash. Nodes are relinked, not copied, so no element is
+  // constructed or destroyed.
+  void rehashTo(size_type bucketCount) {
+    if (bucketCount == m_data.size() && m_oldData.empty())
+      return;
+
+    // Growing a table without trees splits chains and cannot make any of
+    // them too long.
+    const bool rescan = !m_trees.empty() || !m_oldData.empty() ||
+                        bucketCount < m_data.size();
+    dropTrees();
+    data_type data = emptyBuckets(bucketCount);
+    occupancy_type occupied = emptyOccupancy(bucketCount);
+    for (size_type i = nextOccupied(0); i < bucketSpan();
+         i = nextOccupied(i + 1)) {
+      for (Node* node = headAt(i); node;) {
+        Node* next = node->m_next;
+        linkBack(data, occupied, node->m_hash & (bucketCount - 1), node);
+        node = next;
+      }
+    }
+    m_data.swap(data);
+    m_occupied.swap(occupied);
+    m_smallChain = nullptr;
+    dropOldTable();
+    if (rescan)
+      treeifyLongChains();
+  }
+
+  void dropOldTable() {
+    data_type data = emptyBuckets(0);
+    occupancy_type occupied = emptyOccupancy(0);
+    m_oldData.swap(data);
+    m_oldOccupied.swap(occupied);
+    m_rehashIndex = 0;
+  }
+
+  // Moves the chains of up to `chains` buckets of the old table to the new
+  // one, looking at no more than `buckets` of them, empty ones included.
+  void migrate(size_type chains, size_type buckets) {
+    if (m_oldData.empty())
+      return;
+
+    const size_type oldCount = m_oldData.size();
+    const size_type end = buckets < oldCount - m_rehashIndex
+                              ? m_rehashIndex + buckets
+                              : oldCount;
+    const size_type mask = m_data.size() - 1;
+    for (; chains; --chains) {
+      const size_type index =
+          nextOccupiedIn(m_oldOccupied, m_rehashIndex, end);
+      const size_type next = index == end ? end : index + 1;
+      clearTargetBuckets(m_rehashIndex, next);
+      m_rehashIndex = next;
+      if (index == end)
+        break;
+
+      if (!m_trees.empty())
+        untreeify(m_data.size() + index);
+      size_type moved = 0;
+      for (Node* node = m_oldData[index]; node; ++moved) {
+        Node* following = node->m_next;
+        linkBack(m_data, m_occupied, node->m_hash & mask, node);
+        node = following;
+      }
+      m_oldData[index] = nullptr;
+      m_oldOccupied[index / HASHMAP_OCCUPANCY_WORD_BITS] &=
+          ~occupancyBit(index);
+
+      // A growing table splits the chain over buckets that were empty, a
+      // shrinking one merges it into a chain that may have a tree already.
+      if (mask + 1 < oldCount)
+        retreeify(index & mask);
+      else if (moved > HASHMAP_TREEIFY_THRESHOLD)
+        for (size_type target = index; target <= mask; target += oldCount)
+          retreeify(target);
+    }
+    if (m_rehashIndex == oldCount)
+      dropOldTable();
+  }
+
+  // Clears the new buckets that receive keys from old buckets [first, last)
+  // and from no old bucket before them.
+  void clearTargetBuckets(size_type first, size_type last) {
+    const size_type oldCount = m_oldData.size();
+    const size_type newCount = m_data.size();
+    if (newCount > oldCount) {
+      for (size_type base = 0; base < newCount; base += oldCount)
+        std::fill(m_data.begin() + base + first, m_data.begin() + base + last,
+                  nullptr);
+    } else if (first < newCount) {
+      std::fill(m_data.begin() + first,
+                m_data.begin() + std::min(last, newCount), nullptr);
+    }
+  }
+
+  // Does a bounded share of a pending incremental rehash. Called by every
+  // operation that may change the table, but not by lookups, which must stay
+  // safe to run concurrently on a const map.
+  void rehashStep() {
+    migrate(HASHMAP_REHASH_STEP,
+            HASHMAP_REHASH_STEP * HASHMAP_OCCUPANCY_WORD_BITS);
+  }
+
+  void finishRehash() {
+    migrate(m_oldData.size(), m_oldData.size());
+  }
+
+  // Switches to a table of `bucketCount` buckets, either at once or, in
+  // incremental mode, by starting to drain the current table into it.
+  void resizeTo(size_type bucketCount) {
+    if (!m_incrementalRehash || !m_size || isSmall()) {
+      rehashTo(bucketCount);
+      return;
+    }
+
+    finishRehash();
+    data_type data = uninitializedBuckets(bucketCount);
+    occupancy_type occupied = emptyOccupancy(bucketCount);
+    m_data.swap(data);
+    m_occupied.swap(occupied);
+    m_oldData.swap(data);
+    m_oldOccupied.swap(occupied);
+    m_rehashIndex = 0;
+    for (Tree* tree : m_trees)
+      tree->m_index += m_data.size();
+  }
+
+  // Destroys every element and hands all slabs back at once, instead of
+  // freeing nodes one by one. The bucket table is left dangling.
+  void destroyNodes() {
+    dropTrees();
+    if (!std::is_trivially_destructible<Node>::value) {
+      for (size_type i = nextOccupied(0); i < bucketSpan();
+           i = nextOccupied(i + 1)) {
+        for (Node* node = headAt(i); node;) {
+          Node* next = node->m_next;
+          node->~Node();
+          node = next;
+        }
+      }
+    }
+    m_pool.release();
+  }
+
+  // Leaves the map empty and without a bucket table, like a newly created
+  // one. This is also the state of a map that has been moved from.
+  // Bucket tables are always swapped rather than move-assigned, which would
+  // need assignable elements for allocators that do not propagate.
+  void reset() {
+    data_type data = emptyBuckets(0);
+    occupancy_type occupied = emptyOccupancy(0);
+    destroyNodes();
+    m_data.swap(data);
+    m_occupied.swap(occupied);
+    m_smallChain = nullptr;
+    dropOldTable();
+    m_size = 0;
+    m_fingerprint = 0;
+  }
+
+  // Exchanges elements with a map that uses an equal allocator.
+  void swapElements(HashMap& other) {
+    m_pool.swap(other.m_pool);
+    m_data.swap(other.m_data);
+    m_occupied.swap(other.m_occupied);
+    m_oldData.swap(other.m_oldData);
+    m_oldOccupied.swap(other.m_oldOccupied);
+    std::swap(m_smallChain, other.m_smallChain);
+    m_trees.swap(other.m_trees);
+    std::swap(m_rehashIndex, other.m_rehashIndex);
+    std::swap(m_size, other.m_size);
+    std::swap(m_fingerprint, other.m_fingerprint);
+  }
+
+  // Copies (or, given an rvalue, moves) the elements of `other` into this
+  // map, which must be empty.
+  template <typename Source>
+  void takeElementsFrom(Source&& other) {
+    rehashTo(std::max(m_data.size(), other.m_data.size()));
+    m_pool.reserve(other.m_size);
+    for (size_type i = other.nextOccupied(0); i < other.bucketSpan();
+         i = other.nextOccupied(i + 1)) {
+      for (Node* node = other.headAt(i); node; node = node->m_next) {
+        Node* copy = m_pool.create(
+            node->m_hash, std::forward<Source>(other).valueOfNode(node));
+        addNode(bucketIndex(copy->m_hash), copy);
+      }
+    }
+  }
+
+  const value_type& valueOfNode(Node* node) const& { return node->m_value; }
+
+  value_type&& valueOfNode(Node* node) && { return std::move(node->m_value); }
+
+  void growIfNeeded() {
+    if (isSmall()) {
+      if (m_size >= HASHMAP_SMALL_SIZE)
+        rehashTo(minBucketCountFor(m_size + 1));
+      return;
+    }
+    if (m_size + 1 > m_data.size() * m_maxLoadFactor)
+      resizeTo(std::max<size_type>(HASHMAP_MIN_BUCKET_COUNT,
+                                   m_data.size() << 1));
+  }
+
+  // Never shrinks in the middle of an incremental rehash; the next removal
+  // after it finishes will.
+  void shrinkIfNeeded() {
+    if (m_oldData.empty() && m_data.size() > HASHMAP_MIN_BUCKET_COUNT &&
+        m_size < m_data.size() * m_maxLoadFactor / 4)
+      resizeTo(m_data.size() >> 1);
+  }
+
+  // Walks no more than HASHMAP_TREEIFY_THRESHOLD nodes, since a longer chain
+  // has a tree to search instead. Should building the tree have failed, the
+  // walk goes on to the end of the chain.
+  Node* findNode(size_type index, size_type hash, const key_type& key) const {
+    size_type walked = 0;
+    for (Node* node = headAt(index); node; node = node->m_next) {
+      if (node->m_hash == hash && equal_fn(node->m_value.first, key))
+        return node;
+      if (++walked == HASHMAP_TREEIFY_THRESHOLD && node->m_next) {
+        if (Tree* tree = treeAt(index))
+          return findInTree(*tree, hash, key);
+      }
+    }
+    return nullptr;
+  }
+
+  template <typename K, typename = void>
+  struct IsLessComparable : std::false_type {};
+
+  template <typename K>
+  struct IsLessComparable<K,
+                          decltype(void(std::declval<const K&>() <
+                                        std::declval<const K&>()))>
+      : std::true_type {};
+
+  // Trees order nodes by hash and then, if operator< is consistent with the
+  // key equality of the map, by key. Otherwise, keys with equal hashes are
+  // told apart by scanning all of them.
+  using keys_ordered =
+      std::integral_constant<bool,
+                             IsLessComparable<key_type>::value &&
+                                 std::is_same<KeyEqual,
+                                              std::equal_to<key_type>>::value>;
+
+  static int compareKeys(const key_type& a, const key_type& b, std::true_type) {
+    return a < b ? -1 : b < a ? 1 : 0;
+  }
+
+  static int compareKeys(const key_type&, const key_type&, std::false_type) {
+    return 0;
+  }
+
+  // Compares a key with hash `hash` to the key of `node`, in tree order.
+  static int compareInTree(size_type hash,
+                           const key_type& key,
+                           const Node* node) {
+    if (hash != node->m_hash)
+      return hash < node->m_hash ? -1 : 1;
+    return compareKeys(key, node->m_value.first, keys_ordered());
+  }
+
+  typename trees_type::const_iterator findTree(size_type index) const {
+    return std::lower_bound(
+        m_trees.begin(), m_trees.end(), index,
+        [](const Tree* tree, size_type i) { return tree->m_index < i; });
+  }
+
+  Tree* treeAt(size_type index) const {
+    const auto it = findTree(index);
+    return it != m_trees.end() && (*it)->m_index == index ? *it : nullptr;
+  }
+
+  // First node of `tree` not ordered before the key.
+  static TreeNode* lowerBound(Tree& tree,
+                              size_type hash,
+                              const key_type& key) {
+    TreeNode* bound = &tree.m_nil;
+    for (TreeNode* x = tree.m_root; x != &tree.m_nil;) {
+      if (compareInTree(hash, key, x->m_node) <= 0) {
+        bound = x;
+        x = x->m_left;
+      } else {
+        x = x->m_right;
+      }
+    }
+    return bound;
+  }
+
+  Node* findInTree(Tree& tree, size_type hash, const key_type& key) const {
+    RedBlackTree<TreeNode> view = tree.view();
+    for (TreeNode* x = lowerBound(tree, hash, key);
+         x != &tree.m_nil && !compareInTree(hash, key, x->m_node);
+         x = view.next(x)) {
+      if (equal_fn(x->m_node->m_value.first, key))
+        return x->m_node;
+    }
+    return nullptr;
+  }
+
+  bool chainLongerThan(size_type index, size_type length) const {
+    const Node* node = headAt(index);
+    for (; node && length; --length)
+      node = node->m_next;
+    return node != nullptr;
+  }
+
+  void destroyTree(Tree* tree) {
+    tree_allocator allocator(m_allocator);
+    tree->~Tree();
+    std::allocator_traits<tree_allocator>::deallocate(allocator, tree, 1);
+  }
+
+  // Builds the tree of bucket `index`. A tree only speeds lookups up, so if
+  // building it fails, e.g. for lack of memory, the bucket stays a chain.
+  void treeify(size_type index) {
+    tree_allocator allocator(m_allocator);
+    Tree* tree = nullptr;
+    try {
+      tree = std::allocator_traits<tree_allocator>::allocate(allocator, 1);
+      try {
+        ::new (static_cast<void*>(tree)) Tree(index, m_allocator);
+      } catch (...) {
+        std::allocator_traits<tree_allocator>::deallocate(allocator, tree, 1);
+        tree = nullptr;
+        throw;
+      }
+
+      std::vector<TreeNode*> nodes;
+      for (Node* node = headAt(index); node; node = node->m_next) {
+        TreeNode* x = tree->m_pool.create();
+        x->m_node = node;
+        nodes.push_back(x);
+      }
+      std::sort(nodes.begin(), nodes.end(),
+                [](const TreeNode* a, const TreeNode* b) {
+                  return compareInTree(a->m_node->m_hash,
+                                       a->m_node->m_value.first,
+                                       b->m_node) < 0;
+                });
+      tree->view().buildFromSorted(nodes.begin(), nodes.end());
+      tree->m_size = nodes.size();
+      m_trees.insert(findTree(index), tree);
+    } catch (...) {
+      if (tree)
+        destroyTree(tree);
+    }
+  }
+
+  void untreeify(size_type index) {
+    const auto it = findTree(index);
+    if (it != m_trees.end() && (*it)->m_index == index) {
+      destroyTree(*it);
+      m_trees.erase(it);
+    }
+  }
+
+  // Rebuilds the tree of bucket `index` after nodes were moved into it, or
+  // drops it if the chain is no longer too long.
+  void retreeify(size_type index) {
+    if (!m_trees.empty())
+      untreeify(index);
+    if (chainLongerThan(index, HASHMAP_TREEIFY_THRESHOLD))
+      treeify(index);
+  }
+
+  void treeifyLongChains() {
+    if (isSmall())
+      return;
+    for (size_type i = nextOccupied(0); i < bucketSpan();
+         i = nextOccupied(i + 1)) {
+      if (chainLongerThan(i, HASHMAP_TREEIFY_THRESHOLD))
+        treeify(i);
+    }
+  }
+
+  void dropTrees() {
+    for (Tree* tree : m_trees)
+      destroyTree(tree);
+    m_trees.clear();
+  }
+
+  // Adds `node`, just linked to bucket `index`, to the bucket's tree, or
+  // builds the tree once the chain gets too long.
+  void indexNode(size_type index, Node* node) {
+    if (isSmall())
+      return;
+    Tree* tree = m_trees.empty() ? nullptr : treeAt(index);
+    if (!tree) {
+      if (chainLongerThan(index, HASHMAP_TREEIFY_THRESHOLD))
+        treeify(index);
+      return;
+    }
+
+    try {
+      TreeNode* z = tree->m_pool.create();
+      z->m_node = node;
+      TreeNode* parent = &tree->m_nil;
+      bool left = false;
+      for (TreeNode* x = tree->m_root; x != &tree->m_nil;
+           x = left ? x->m_left : x->m_right) {
+        parent = x;
+        left = compareInTree(node->m_hash, node->m_value.first, x->m_node) < 0;
+      }
+      tree->view().link(parent, left, z);
+      ++tree->m_size;
+    } catch (...) {
+      untreeify(index);
+    }
+  }
+
+  // Removes `node` from the tree of bucket `index`, if there is one, turning
+  // the bucket back into a plain chain once it is down to
+  // HASHMAP_UNTREEIFY_THRESHOLD nodes.
+  void unindexNode(size_type index, Node* node) {
+    const auto it = findTree(index);
+    if (it == m_trees.end() || (*it)->m_index != index)
+      return;
+
+    Tree& tree = **it;
+    if (tree.m_size <= HASHMAP_UNTREEIFY_THRESHOLD + 1) {
+      destroyTree(*it);
+      m_trees.erase(it);
+      return;
+    }
+
+    RedBlackTree<TreeNode> view = tree.view();
+    TreeNode* x = lowerBound(tree, node->m_hash, node->m_value.first);
+    while (x->m_node != node)
+      x = view.next(x);
+    view.unlink(x);
+    tree.m_pool.destroy(x);
+    --tree.m_size;
+  }
+
+  template <typename InputIt>
+  void insertRange(InputIt first, InputIt last, std::input_iterator_tag) {
+    for (; first != last; ++first)
+      insertOrAssign(first->first, first->second);
+  }
+
+  // The size of the input is known, so the table and the node pool are sized
+  // once up front. Keys are hashed HASHMAP_PREFETCH_DISTANCE elements ahead of
+  // their insertion and their bucket slots prefetched, like in findNodes().
+  template <typename ForwardIt>
+  void insertRange(ForwardIt first,
+                   ForwardIt last,
+                   std::forward_iterator_tag) {
+    const size_type count = std::distance(first, last);
+    reserve(m_size + count);
+    m_pool.reserve(count);
+
+    size_type hashes[HASHMAP_PREFETCH_DISTANCE];
+    ForwardIt ahead = first;
+    for (size_type i = 0; i < HASHMAP_PREFETCH_DISTANCE && ahead != last;
+         ++i, ++ahead) {
+      hashes[i] = hash_fn(ahead->first);
+      __builtin_prefetch(&headAt(bucketIndex(hashes[i])));
+    }
+
+    for (size_type i = 0; first != last; ++i, ++first) {
+      const size_type hash = hashes[i % HASHMAP_PREFETCH_DISTANCE];
+      if (ahead != last) {
+        const size_type next = hash_fn(ahead->first);
+        hashes[i % HASHMAP_PREFETCH_DISTANCE] = next;
+        __builtin_prefetch(&headAt(bucketIndex(next)));
+        ++ahead;
+      }
+
+      rehashStep();
+      const size_type index = bucketIndex(hash);
+      if (Node* node = findNode(index, hash, first->first)) {
+        node->m_value.second = first->second;
+        continue;
+      }
+      addNode(index, m_pool.create(hash, first->first, first->second));
+    }
+  }
+
+  // Looks up `count` keys and passes each result to `visit`, in order. The
+  // lookups are software-pipelined: the bucket slot of a key is prefetched
+  // 2 * HASHMAP_PREFETCH_DISTANCE keys ahead and its chain head
+  // HASHMAP_PREFETCH_DISTANCE keys ahead, so that the cache misses of
+  // different keys overlap instead of being paid one after another.
+  template <typename Visitor>
+  void findNodes(const key_type* keys, size_type count, Visitor visit) const {
+    const size_type distance = HASHMAP_PREFETCH_DISTANCE;
+    // Hashes of the keys in flight, indexed modulo the window.
+    size_type hashes[2 * HASHMAP_PREFETCH_DISTANCE];
+
+    for (size_type i = 0; i < count + 2 * distance; ++i) {
+      if (i >= 2 * distance) {
+        const size_type k = i - 2 * distance;
+        const size_type hash = hashes[k % (2 * distance)];
+        const size_type index = bucketIndex(hash);
+        visit(index, findNode(index, hash, keys[k]));
+      }
+      if (i >= distance && i - distance < count) {
+        const size_type hash = hashes[(i - distance) % (2 * distance)];
+        Node* head = headAt(bucketIndex(hash));
+        if (head)
+          __builtin_prefetch(head);
+      }
+      if (i < count) {
+        const size_type hash = hash_fn(keys[i]);
+        hashes[i % (2 * distance)] = hash;
+        __builtin_prefetch(&headAt(bucketIndex(hash)));
+      }
+    }
+  }
+
+  template <typename K, typename... Args>
+  std::pair<iterator, bool> tryEmplaceKey(K&& key, Args&&... args) {
+    rehashStep();
+    const size_type hash = hash_fn(key);
+    if (Node* node = findNode(bucketIndex(hash), hash, key))
+      return std::make_pair(iterator(*this, bucketIndex(hash), node), false);
+
+    growIfNeeded();
+    Node* node = m_pool.create(
+        hash, std::piecewise_construct,
+        std::forward_as_tuple(std::forward<K>(key)),
+        std::forward_as_tuple(std::forward<Args>(args)...));
+    const size_type index = bucketIndex(hash);
+    addNode(index, node);
+    return std::make_pair(iterator(*this, index, node), true);
+  }
 
-  HashMap(std::initializer_list<value_type> list) : m_size(list.size()) {
-    for (const value_type& val : list) {
-      const size_type index = hash_fn(val.first) % HASHMAP_SIZE;
-      m_data[index].emplace_back(val.first, val.second);
+  // Number of tasks to split the buckets into: a few per thread of `pool`,
+  // but no fewer than HASHMAP_PARALLEL_GRAIN elements per task on average.
+  size_type parallelChunkCount(const ThreadPool& pool) const {
+    return std::max<size_type>(
+        1, std::min<size_type>(pool.getTaskCount(),
+                               m_size / HASHMAP_PARALLEL_GRAIN));
+  }
+
+  // Runs `function(chunk, first, last)` on `pool` for `chunks` consecutive
+  // ranges of buckets. Range bounds fall on occupancy word boundaries, so
+  // that tasks unlinking nodes never update the same word.
+  template <typename Function>
+  void forEachChunk(ThreadPool& pool,
+                    size_type chunks,
+                    const Function& function) const {
+    const size_type span = bucketSpan();
+    const size_type words =
+        (span + HASHMAP_OCCUPANCY_WORD_BITS - 1) / HASHMAP_OCCUPANCY_WORD_BITS;
+    pool.parallelFor(chunks, [&](size_type chunk) {
+      const size_type first =
+          words * chunk / chunks * HASHMAP_OCCUPANCY_WORD_BITS;
+      const size_type last =
+          words * (chunk + 1) / chunks * HASHMAP_OCCUPANCY_WORD_BITS;
+      function(chunk, std::min(first, span), std::min(last, span));
+    });
+  }
+
+  // Like nextOccupied(), but returns `last` rather than look past it, and
+  // ignores a table being drained.
+  size_type nextOccupiedBefore(size_type index, size_type last) const {
+    if (isSmall())
+      return std::min(nextOccupied(index), last);
+    return nextOccupiedIn(m_occupied, index, last);
+  }
+
+  // Unlinks the nodes of buckets [first, last) of the current table whose
+  // elements satisfy `predicate`, and pushes them onto `unlinked`. Reads no
+  // occupancy word outside of the range.
+  template <typename Predicate>
+  void unlinkIf(Predicate& predicate,
+                size_type first,
+                size_type last,
+                Node*& unlinked) {
+    for (size_type i = nextOccupiedBefore(first, last); i < last;
+         i = nextOccupiedBefore(i + 1, last)) {
+      for (Node* node = headAt(i); node;) {
+        Node* next = node->m_next;
+        if (predicate(static_cast<const value_type&>(node->m_value))) {
+          unlink(i, node);
+          node->m_next = unlinked;
+          unlinked = node;
+        }
+        node = next;
+      }
     }
   }
 
-  HashMap(const HashMap& other) {
-    for (auto i = 0; i < HASHMAP_SIZE; i++) {
-      if (!other.m_data[i].empty())
-        for (auto elem : other.m_data[i])
-          m_data[i].emplace_back(elem.first, elem.second);
+  size_type destroyUnlinked(const std::vector<Node*>& lists) {
+    size_type count = 0;
+    for (Node* node : lists) {
+      while (node) {
+        Node* next = node->m_next;
+        m_fingerprint -= fingerprintOf(node);
+        m_pool.destroy(node);
+        node = next;
+        ++count;
+      }
     }
-    m_size = other.m_size;
+    m_size -= count;
+    return count;
   }
 
-  HashMap(HashMap&& other) { *this = std::move(other); }
+  void addNode(size_type index, Node* node) {
+    linkBack(index, node);
+    ++m_size;
+    m_fingerprint += fingerprintOf(node);
+    indexNode(index, node);
+  }
+
+  void eraseNode(size_type index, Node* node) {
+    if (!m_trees.empty())
+      unindexNode(index, node);
+    unlink(index, node);
+    m_fingerprint -= fingerprintOf(node);
+    m_pool.destroy(node);
+    --m_size;
+  }
+
+  // Whether two hash functors hash every key alike: always for stateless
+  // ones, and for stateful ones that compare equal. Functors that cannot be
+  // compared are assumed to differ.
+  template <typename H>
+  static auto hashesAgree(const H& hash, const H& other, int)
+      -> decltype(static_cast<bool>(hash == other)) {
+    return std::is_empty<H>::value || hash == other;
+  }
+
+  template <typename H>
+  static bool hashesAgree(const H&, const H&, long) {
+    return std::is_empty<H>::value;
+  }
+
+  // Hash functions with a fingerprint() member, like KeyedHash, digest keys
+  // alike whatever their seed, so maps built apart get comparable
+  // fingerprints. Others are digested from the stored hash.
+  template <typename H>
+  static auto digestOf(const H& hash, const Node* node, int)
+      -> decltype(static_cast<std::uint64_t>(
+          hash.fingerprint(node->m_value.first, node->m_hash))) {
+    return hash.fingerprint(node->m_value.first, node->m_hash);
+  }
+
+  template <typename H>
+  static std::uint64_t digestOf(const H&, const Node* node, long) {
+    return fingerprintOf(node->m_hash);
+  }
+
+  std::uint64_t fingerprintOf(const Node* node) const {
+    return digestOf(hash_fn, node, 0);
+  }
+
+  template <typename H>
+  static auto digestsAgree(const H& hash, const H&, int)
+      -> decltype(hash.fingerprint(std::declval<const key_type&>(), 0),
+                  true) {
+    return true;
+  }
+
+  template <typename H>
+  static bool digestsAgree(const H& hash, const H& other, long) {
+    return hashesAgree(hash, other, 0);
+  }
+
+  // Fingerprints are only comparable if both maps digest keys alike.
+  bool mayEqual(const HashMap& other) const {
+    return m_size == other.m_size &&
+           (!digestsAgree(hash_fn, other.hash_fn, 0) ||
+            m_fingerprint == other.m_fingerprint);
+  }
+
+  // Whether every element in buckets [first, last) has an equal element in
+  // `other`. Keys are hashed again only if the hash functions of the maps
+  // may differ. Gives up early, returning true, once `mismatch` is set by
+  // another thread.
+  bool bucketsMatch(const HashMap& other,
+                    size_type first,
+                    size_type last,
+                    const std::atomic<bool>& mismatch) const {
+    const bool sameHashes = hashesAgree(hash_fn, other.hash_fn, 0);
+    for (size_type i = nextOccupied(first); i < last;
+         i = nextOccupied(i + 1)) {
+      if (mismatch.load(std::memory_order_relaxed))
+        return true;
+      for (const Node* node = headAt(i); node; node = node->m_next) {
+        const size_type hash = sameHashes
+                                   ? node->m_hash
+                                   : other.hash_fn(node->m_value.first);
+        const Node* found =
+            other.findNode(other.bucketIndex(hash), hash, node->m_value.first);
+        if (!found || !(found->m_value.second == node->m_value.second))
+          return false;
+      }
+    }
+    return true;
+  }
+
+ public:
+  HashMap() : HashMap(0) {}
+
+  // The hash and equality functors and the allocator are copied into the map,
+  // so they may carry state, e.g. a seed or an arena. A `bucketCount` of 0
+  // defers allocating the table until the map outgrows HASHMAP_SMALL_SIZE
+  // elements.
+  explicit HashMap(size_type bucketCount,
+                   const Hash& hash = Hash(),
+                   const KeyEqual& equal = KeyEqual(),
+                   const Allocator& allocator = Allocator())
+      : hash_fn(hash),
+        equal_fn(equal),
+        m_allocator(allocator),
+        m_pool(allocator),
+        m_data(emptyBuckets(bucketCount ? roundUpToPowerOfTwo(bucketCount)
+                                        : 0)),
+        m_occupied(emptyOccupancy(m_data.size())),
+        m_oldData(emptyBuckets(0)),
+        m_oldOccupied(emptyOccupancy(0)),
+        m_trees(rebind_allocator<Tree*>(allocator)) {}
+
+  HashMap(std::initializer_list<value_type> list,
+          size_type bucketCount = 0,
+          const Hash& hash = Hash(),
+          const KeyEqual& equal = KeyEqual(),
+          const Allocator& allocator = Allocator())
+      : HashMap(bucketCount, hash, equal, allocator) {
+    reserve(list.size());
+    for (const value_type& val : list)
+      insertOrAssign(val.first, val.second);
+  }
+
+  template <typename InputIt,
+            typename =
+                typename std::iterator_traits<InputIt>::iterator_category>
+  HashMap(InputIt first,
+          InputIt last,
+          size_type bucketCount = 0,
+          const Hash& hash = Hash(),
+          const KeyEqual& equal = KeyEqual(),
+          const Allocator& allocator = Allocator())
+      : HashMap(bucketCount, hash, equal, allocator) {
+    insert(first, last);
+  }
+
+  HashMap(const HashMap& other)
+      : HashMap(other.m_data.size(),
+                other.hash_fn,
+                other.equal_fn,
+                std::allocator_traits<Allocator>::
+                    select_on_container_copy_construction(other.m_allocator)) {
+    m_maxLoadFactor = other.m_maxLoadFactor;
+    m_incrementalRehash = other.m_incrementalRehash;
+    takeElementsFrom(other);
+  }
+
+  // Takes over the nodes and bucket tables of `other` without touching them
+  // or allocating anything, leaving `other` empty and without a table.
+  HashMap(HashMap&& other) noexcept(
+      std::is_nothrow_copy_constructible<Hash>::value &&
+      std::is_nothrow_copy_constructible<KeyEqual>::value)
+      : hash_fn(other.hash_fn),
+        equal_fn(other.equal_fn),
+        m_allocator(other.m_allocator),
+        m_pool(m_allocator),
+        m_data(emptyBuckets(0)),
+        m_occupied(emptyOccupancy(0)),
+        m_oldData(emptyBuckets(0)),
+        m_oldOccupied(emptyOccupancy(0)),
+        m_trees(rebind_allocator<Tree*>(m_allocator)),
+        m_maxLoadFactor(other.m_maxLoadFactor),
+        m_incrementalRehash(other.m_incrementalRehash) {
+    swapElements(other);
+  }
+
+  ~HashMap() { destroyNodes(); }
 
   HashMap& operator=(const HashMap& other) {
     if (this != &other) {
-      for (auto i = 0; i < HASHMAP_SIZE; i++) {
-        m_data[i].clear();
-        if (!other.m_data[i].empty())
-          for (auto elem : other.m_data[i])
-            m_data[i].emplace_back(elem.first, elem.second);
-      }
-      m_size = other.m_size;
+      HashMap copy(other.m_data.size(), other.hash_fn, other.equal_fn,
+                   m_allocator);
+      copy.takeElementsFrom(other);
+      hash_fn = other.hash_fn;
+      equal_fn = other.equal_fn;
+      m_maxLoadFactor = other.m_maxLoadFactor;
+      m_incrementalRehash = other.m_incrementalRehash;
+      swapElements(copy);
     }
     return *this;
   }
 
   HashMap& operator=(HashMap&& other) {
     if (this != &other) {
-      m_data = std::move(other.m_data);
-      m_size = std::move(other.m_size);
-
-      other.m_size = 0;
+      hash_fn = other.hash_fn;
+      equal_fn = other.equal_fn;
+      m_maxLoadFactor = other.m_maxLoadFactor;
+      m_incrementalRehash = other.m_incrementalRehash;
+      reset();
+
+      if (m_allocator == other.m_allocator) {
+        swapElements(other);
+      } else {
+        // Memory of the other map cannot be taken over, so its elements are
+        // moved one by one into nodes of this map's pool.
+        takeElementsFrom(std::move(other));
+        other.reset();
+      }
     }
     return *this;
   }
 
+  // Exchanges the contents and settings of two maps in constant time, without
+  // invalidating references to elements. Allocators are exchanged if they
+  // propagate on swap, and must be equal otherwise.
+  void swap(HashMap& other) {
+    using std::swap;
+    swap(hash_fn, other.hash_fn);
+    swap(equal_fn, other.equal_fn);
+    swap(m_maxLoadFactor, other.m_maxLoadFactor);
+    swap(m_incrementalRehash, other.m_incrementalRehash);
+    if (std::allocator_traits<Allocator>::propagate_on_container_swap::value)
+      swap(m_allocator, other.m_allocator);
+    swapElements(other);
+  }
+
   bool isEmpty() const { return !m_size; }
 
   mapped_type& operator[](const key_type& key) {
-    const size_type index = hash_fn(key) % HASHMAP_SIZE;
+    return tryEmplace(key).first->second;
+  }
 
-    for (auto it = m_data[index].begin(); it != m_data[index].end(); it++) {
-      if ((*it).first == key)
-        return (*it).second;
+  mapped_type& operator[](key_type&& key) {
+    return tryEmplace(std::move(key)).first->second;
+  }
+
+  // Inserts every pair of [first, last), later pairs overwriting values of
+  // earlier ones with the same key, like the initializer list constructor.
+  template <typename InputIt>
+  void insert(InputIt first, InputIt last) {
+    insertRange(first, last,
+                typename std::iterator_traits<InputIt>::iterator_category());
+  }
+
+  // Constructs an element from `args` in place. If its key is already in the
+  // map, the new element is destroyed again and the existing one is returned
+  // along with false.
+  template <typename... Args>
+  std::pair<iterator, bool> emplace(Args&&... args) {
+    rehashStep();
+    Node* node = m_pool.create(0, std::forward<Args>(args)...);
+    try {
+      node->m_hash = hash_fn(node->m_value.first);
+      const size_type index = bucketIndex(node->m_hash);
+      if (Node* existing = findNode(index, node->m_hash, node->m_value.first)) {
+        m_pool.destroy(node);
+        return std::make_pair(iterator(*this, index, existing), false);
+      }
+      growIfNeeded();
+    } catch (...) {
+      m_pool.destroy(node);
+      throw;
     }
 
-    m_data[index].emplace_back(key, mapped_type{});
-    ++m_size;
-    return m_data[index].back().second;
+    const size_type index = bucketIndex(node->m_hash);
+    addNode(index, node);
+    return std::make_pair(iterator(*this, index, node), true);
+  }
+
+  // Inserts `key` with a value constructed from `args` in place, unless the
+  // key is already in the map. Then nothing is constructed, and neither
+  // `key` nor `args` are moved from.
+  template <typename... Args>
+  std::pair<iterator, bool> tryEmplace(const key_type& key, Args&&... args) {
+    return tryEmplaceKey(key, std::forward<Args>(args)...);
+  }
+
+  template <typename... Args>
+  std::pair<iterator, bool> tryEmplace(key_type&& key, Args&&... args) {
+    return tryEmplaceKey(std::move(key), std::forward<Args>(args)...);
+  }
+
+  // Inserts `key` with `value`, or assigns `value` to the existing element.
+  // Returns true if the key was inserted.
+  template <typename M>
+  std::pair<iterator, bool> insertOrAssign(const key_type& key, M&& value) {
+    auto result = tryEmplaceKey(key, std::forward<M>(value));
+    if (!result.second)
+      result.first->second = std::forward<M>(value);
+    return result;
+  }
+
+  template <typename M>
+  std::pair<iterator, bool> insertOrAssign(key_type&& key, M&& value) {
+    auto result = tryEmplaceKey(std::move(key), std::forward<M>(value));
+    if (!result.second)
+      result.first->second = std::forward<M>(value);
+    return result;
   }
 
   const mapped_type& valueOf(const key_type& key) const {
-    const size_type index = hash_fn(key) % HASHMAP_SIZE;
+    const size_type hash = hash_fn(key);
+    const size_type index = bucketIndex(hash);
 
-    for (auto it = m_data[index].begin(); it != m_data[index].end(); it++) {
-      if ((*it).first == key)
-        return (*it).second;
-    }
+    Node* node = findNode(index, hash, key);
+    if (!node)
+      throw std::out_of_range("Element with given key does not exist");
 
-    throw std::out_of_range("Element with given key does not exist");
+    return node->m_value.second;
   }
 
   mapped_type& valueOf(const key_type& key) {
-    // return const_cast<HashMap&>(*this).valueOf(key);
-    const size_type index = hash_fn(key) % HASHMAP_SIZE;
+    const size_type hash = hash_fn(key);
+    const size_type index = bucketIndex(hash);
 
-    for (auto it = m_data[index].begin(); it != m_data[index].end(); it++) {
-      if ((*it).first == key)
-        return (*it).second;
-    }
+    Node* node = findNode(index, hash, key);
+    if (!node)
+      throw std::out_of_range("Element with given key does not exist");
 
-    throw std::out_of_range("Element with given key does not exist");
+    return node->m_value.second;
   }
 
   const_iterator find(const key_type& key) const {
-    const size_type index = hash_fn(key) % HASHMAP_SIZE;
+    const size_type hash = hash_fn(key);
+    const size_type index = bucketIndex(hash);
 
-    for (auto it = m_data[index].begin(); it != m_data[index].end(); it++) {
-      if ((*it).first == key)
-        return const_iterator(*this, index, it);
-    }
-    return cend();
+    Node* node = findNode(index, hash, key);
+    if (!node)
+      return cend();
+
+    return const_iterator(*this, index, node);
   }
 
   iterator find(const key_type& key) {
-    const size_type index = hash_fn(key) % HASHMAP_SIZE;
+    const size_type hash = hash_fn(key);
+    const size_type index = bucketIndex(hash);
 
-    for (auto it = m_data[index].begin(); it != m_data[index].end(); it++) {
-      if ((*it).first == key)
-        return iterator(*this, index, it);
-    }
+    Node* node = findNode(index, hash, key);
+    if (!node)
+      return end();
 
-    return end();
+    return iterator(*this, index, node);
   }
 
-  void remove(const key_type& key) {
-    const size_type index = hash_fn(key) % HASHMAP_SIZE;
+  // Finds `count` keys at once and writes an iterator for each of them, or
+  // end() for a missing one, to `out`. Faster than calling find() in a loop
+  // once the table no longer fits in cache.
+  template <typename OutputIt>
+  void findBatch(const key_type* keys, size_type count, OutputIt out) const {
+    findNodes(keys, count, [this, &out](size_type index, Node* node) {
+      *out++ = node ? const_iterator(*this, index, node) : cend();
+    });
+  }
 
-    for (auto it = m_data[index].begin(); it != m_data[index].end(); it++) {
-      if ((*it).first == key) {
-        m_data[index].erase(it);
-        --m_size;
-        return;
-      }
-    }
+  template <typename OutputIt>
+  void findBatch(const key_type* keys, size_type count, OutputIt out) {
+    findNodes(keys, count, [this, &out](size_type index, Node* node) {
+      *out++ = node ? iterator(*this, index, node) : end();
+    });
+  }
 
-    throw std::out_of_range("Element with given key does not exist");
+  // Writes the values of `count` keys to `out`. Throws std::out_of_range at
+  // the first missing key, after the values of the keys before it.
+  template <typename OutputIt>
+  void valueOfBatch(const key_type* keys,
+                    size_type count,
+                    OutputIt out) const {
+    findNodes(keys, count, [&out](size_type, Node* node) {
+      if (!node)
+        throw std::out_of_range("Element with given key does not exist");
+      *out++ = node->m_value.second;
+    });
   }
 
-  void remove(const const_iterator& it) {
-    const size_type index = hash_fn(it->first) % HASHMAP_SIZE;
+  void remove(const key_type& key) {
+    rehashStep();
+    const size_type hash = hash_fn(key);
+    const size_type index = bucketIndex(hash);
 
-    for (auto it_ = m_data[index].begin(); it_ != m_data[index].end(); it_++) {
-      if ((*it_).first == (*it).first) {
-        m_data[index].erase(it_);
-        --m_size;
-        return;
-      }
-    }
+    Node* node = findNode(index, hash, key);
+    if (!node)
+      throw std::out_of_range("Element with given key does not exist");
 
-    throw std::out_of_range("Element with given key does not exist");
+    eraseNode(index, node);
+    shrinkIfNeeded();
+  }
+
+  // Unlinks the element the iterator points to and returns an iterator to
+  // the following one. The table is never shrunk here, so that the returned
+  // iterator stays valid while removing elements during iteration.
+  iterator remove(const const_iterator& it) {
+    if (it.m_source != this || !it.m_node)
+      throw std::out_of_range("Element with given key does not exist");
+
+    const_iterator next = it;
+    ++next;
+    eraseNode(it.m_index, it.m_node);
+    return next;
   }
 
   size_type getSize() const { return m_size; }
 
+  hasher getHashFunction() const { return hash_fn; }
+
+  key_equal getKeyEqual() const { return equal_fn; }
+
+  allocator_type getAllocator() const { return m_allocator; }
+
+  // Immutable copy of the map on a minimal perfect hash function, for data
+  // that is built once and then only read; see FrozenHashMap.
+  FrozenHashMap<key_type, mapped_type, hasher, key_equal> freeze() const {
+    return FrozenHashMap<key_type, mapped_type, hasher, key_equal>(
+        begin(), end(), hash_fn, equal_fn);
+  }
+
+  // 0 while the map is small and has no table.
+  size_type getBucketCount() const { return m_data.size(); }
+
+  float getLoadFactor() const {
+    if (m_data.empty())
+      return 0.0f;
+    return static_cast<float>(m_size) / m_data.size();
+  }
+
+  float getMaxLoadFactor() const { return m_maxLoadFactor; }
+
+  void setMaxLoadFactor(float maxLoadFactor) {
+    if (!(maxLoadFactor > 0))
+      throw std::invalid_argument("Max load factor must be positive");
+
+    m_maxLoadFactor = maxLoadFactor;
+    if (!isSmall() && m_size > m_data.size() * m_maxLoadFactor)
+      rehashTo(minBucketCountFor(m_size));
+  }
+
+  // In incremental mode, growing or shrinking the table only allocates the
+  // new one. The nodes are moved over a few buckets at a time by the
+  // following insertions and removals, and lookups meanwhile search whichever
+  // table still holds the key, so that no single operation pays for a whole
+  // rehash. Explicit reserve(), rehash() and setMaxLoadFactor() calls still
+  // rehash at once.
+  void setIncrementalRehash(bool enabled) {
+    m_incrementalRehash = enabled;
+    if (!enabled)
+      finishRehash();
+  }
+
+  bool isIncrementalRehash() const { return m_incrementalRehash; }
+
+  bool isRehashing() const { return !m_oldData.empty(); }
+
+  // Makes room for `count` elements, so that inserting them does not trigger
+  // any further rehash.
+  void reserve(size_type count) {
+    if (isSmall() ? count > HASHMAP_SMALL_SIZE
+                  : count > m_data.size() * m_maxLoadFactor)
+      rehashTo(minBucketCountFor(count));
+  }
+
+  // Sets the bucket count to at least `count`, rounded up to a power of two.
+  // The table is never shrunk below what the current size requires.
+  void rehash(size_type count) {
+    rehashTo(std::max(roundUpToPowerOfTwo(count), minBucketCountFor(m_size)));
+  }
+
+  // Order-independent digest of the keys, kept up to date by every insertion
+  // and removal. Maps with equal keys have equal fingerprints if they hash
+  // with a KeyedHash, whatever its seed, or with equal hash functions.
+  // Values are not covered, since they can be changed through references
+  // the map never sees.
+  std::uint64_t getFingerprint() const { return m_fingerprint; }
+
+  // Maps whose sizes or fingerprints differ are told apart in constant time.
   bool operator==(const HashMap& other) const {
-    if (this->getSize() != other.getSize())
+    if (!mayEqual(other))
       return false;
 
-    const_iterator it = this->cbegin();
+    const std::atomic<bool> mismatch(false);
+    return bucketsMatch(other, 0, bucketSpan(), mismatch);
+  }
 
-    for (size_type i = 0; i < getSize(); i++) {
-      size_type index = hash_fn(it->first) % HASHMAP_SIZE;
-      if (std::find(other.m_data[index].begin(), other.m_data[index].end(),
-                    *it) == other.m_data[index].end())
-        return false;
-      ++it;
-    }
+  // Like operator==, but compares ranges of buckets in parallel on `pool`.
+  // The first mismatch found stops the other tasks. Both maps must not be
+  // modified meanwhile, and the operator== of values must be safe to call
+  // from several threads.
+  bool parallelEquals(const HashMap& other,
+                      ThreadPool& pool = ThreadPool::global()) const {
+    if (!mayEqual(other))
+      return false;
 
-    return true;
+    std::atomic<bool> mismatch(false);
+    forEachChunk(pool, parallelChunkCount(pool),
+                 [&](size_type, size_type first, size_type last) {
+                   if (!bucketsMatch(other, first, last, mismatch))
+                     mismatch = true;
+                 });
+    return !mismatch;
+  }
+
+  // Calls `function` on every element, spreading ranges of buckets over
+  // `pool`. Elements are visited concurrently and in no particular order;
+  // `function` may change values but not the map.
+  template <typename Function>
+  void parallelForEach(Function function,
+                       ThreadPool& pool = ThreadPool::global()) {
+    forEachChunk(pool, parallelChunkCount(pool),
+                 [&](size_type, size_type first, size_type last) {
+                   for (size_type i = nextOccupied(first); i < last;
+                        i = nextOccupied(i + 1)) {
+                     for (Node* node = headAt(i); node; node = node->m_next)
+                       function(node->m_value);
+                   }
+                 });
+  }
+
+  template <typename Function>
+  void parallelForEach(Function function,
+                       ThreadPool& pool = ThreadPool::global()) const {
+    forEachChunk(pool, parallelChunkCount(pool),
+                 [&](size_type, size_type first, size_type last) {
+                   for (size_type i = nextOccupied(first); i < last;
+                        i = nextOccupied(i + 1)) {
+                     for (const Node* node = headAt(i); node;
+                          node = node->m_next)
+                       function(static_cast<const value_type&>(node->m_value));
+                   }
+                 });
+  }
+
+  // Folds `transform(element)` of every element with `reduce`, starting from
+  // `identity`. Every range of buckets is folded separately on `pool` and the
+  // partial results are then folded in bucket order, so `reduce` must be
+  // associative and `identity` neutral to it.
+  template <typename T, typename Transform, typename Reduce>
+  T parallelReduce(T identity,
+                   Transform transform,
+                   Reduce reduce,
+                   ThreadPool& pool = ThreadPool::global()) const {
+    const size_type chunks = parallelChunkCount(pool);
+    std::vector<T> partials(chunks, identity);
+    forEachChunk(pool, chunks,
+                 [&](size_type chunk, size_type first, size_type last) {
+                   T result = identity;
+                   for (size_type i = nextOccupied(first); i < last;
+                        i = nextOccupied(i + 1)) {
+                     for (const Node* node = headAt(i); node;
+                          node = node->m_next)
+                       result = reduce(std::move(result),
+                                       transform(static_cast<const value_type&>(
+                                           node->m_value)));
+                   }
+                   partials[chunk] = std::move(result);
+                 });
+
+    T result = std::move(identity);
+    for (T& partial : partials)
+      result = reduce(std::move(result), std::move(partial));
+    return result;
+  }
+
+  // Removes every element satisfying `predicate` and returns their number.
+  // Ranges of buckets are unlinked in parallel on `pool`; the elements are
+  // then destroyed by the calling thread. Finishes any incremental rehash
+  // first, and, like removal by iterator, never shrinks the table.
+  template <typename Predicate>
+  size_type parallelRemoveIf(Predicate predicate,
+                             ThreadPool& pool = ThreadPool::global()) {
+    finishRehash();
+    // Trees cannot follow unlinking in parallel, so they are dropped and
+    // rebuilt afterwards where chains are still long.
+    std::vector<size_type> treeified;
+    for (const Tree* tree : m_trees)
+      treeified.push_back(tree->m_index);
+    dropTrees();
+    const auto retreeifyAll = [&]() {
+      for (size_type index : treeified)
+        retreeify(index);
+    };
+
+    const size_type chunks = parallelChunkCount(pool);
+    // Unlinked nodes of every chunk, chained through m_next.
+    std::vector<Node*> removed(chunks, nullptr);
+    try {
+      forEachChunk(pool, chunks,
+                   [&](size_type chunk, size_type first, size_type last) {
+                     Node* unlinked = nullptr;
+                     try {
+                       unlinkIf(predicate, first, last, unlinked);
+                     } catch (...) {
+                       removed[chunk] = unlinked;
+                       throw;
+                     }
+                     removed[chunk] = unlinked;
+                   });
+    } catch (...) {
+      destroyUnlinked(removed);
+      retreeifyAll();
+      throw;
+    }
+    const size_type count = destroyUnlinked(removed);
+    retreeifyAll();
+    return count;
   }
 
   bool operator!=(const HashMap& other) const { return !(*this == other); }
 
   iterator begin() {
-    if (!isEmpty())
-      for (auto i = 0; i < HASHMAP_SIZE; ++i)
-        if (!m_data[i].empty())
-          return iterator(*this, i, m_data[i].begin());
+    const size_type index = nextOccupied(0);
+    if (index == bucketSpan())
+      return end();
 
-    return iterator(*this, 0, m_data[0].begin(), true);
+    return iterator(*this, index, headAt(index));
   }
 
-  iterator end() {
-    return iterator(*this, HASHMAP_SIZE - 1, m_data[HASHMAP_SIZE - 1].end(),
-                    true);
-  }
+  iterator end() { return iterator(*this, bucketSpan(), nullptr); }
 
   const_iterator cbegin() const {
-    if (!isEmpty())
-      for (auto i = 0; i < HASHMAP_SIZE; ++i)
-        if (!m_data[i].empty())
-          return const_iterator(*this, i, m_data[i].begin());
+    const size_type index = nextOccupied(0);
+    if (index == bucketSpan())
+      return cend();
 
-    return const_iterator(*this, 0, m_data[0].begin(), true);
+    return const_iterator(*this, index, headAt(index));
   }
 
   const_iterator cend() const {
-    return const_iterator(*this, HASHMAP_SIZE - 1,
-                          m_data[HASHMAP_SIZE - 1].end(), true);
+    return const_iterator(*this, bucketSpan(), nullptr);
   }
 
   const_iterator begin() const { return cbegin(); }
@@ -220,60 +1640,49 @@ class HashMap {
   const_iterator end() const { return cend(); }
 };
 
-template <typename KeyType, typename ValueType>
-class HashMap<KeyType, ValueType>::ConstIterator {
+template <typename KeyType,
+          typename ValueType,
+          typename Hash,
+          typename KeyEqual,
+          typename Allocator>
+class HashMap<KeyType, ValueType, Hash, KeyEqual, Allocator>::ConstIterator {
  public:
   using reference = typename HashMap::const_reference;
-  // using iterator_category = std::bidirectional_iterator_tag;
+  using iterator_category = std::bidirectional_iterator_tag;
   using value_type = typename HashMap::value_type;
+  using difference_type = std::ptrdiff_t;
   using pointer = const typename HashMap::value_type*;
   using size_type = typename HashMap::size_type;
-  using list_iterator =
-      typename std::list<std::pair<const KeyType, ValueType>>::const_iterator;
+  using node_pointer = typename HashMap::Node*;
+
+  friend class HashMap;
 
  protected:
-  const HashMap& m_source;
+  const HashMap* m_source;
   size_type m_index;
-  list_iterator m_element;
-  bool m_isSentinel;
+  // Null for the end iterator.
+  node_pointer m_node;
 
  public:
   explicit ConstIterator(const HashMap& source,
                          size_type index,
-                         list_iterator element,
-                         bool isSentinel = false)
-      : m_source(source),
-        m_index(index),
-        m_element(element),
-        m_isSentinel(isSentinel) {}
-
-  ConstIterator(const ConstIterator& other)
-      : m_source(other.m_source),
-        m_index(other.m_index),
-        m_element(other.m_element),
-        m_isSentinel(other.m_isSentinel) {}
+                         node_pointer node)
+      : m_source(&source), m_index(index), m_node(node) {}
 
   ConstIterator& operator++() {
-    if (m_isSentinel)
+    if (!m_node)
       throw std::out_of_range("Next iterator does not exist");
 
-    list_iterator tmp = ++m_element;
-    if (tmp != m_source.m_data[m_index].end()) {
-      ++m_element;
+    if (m_node->m_next) {
+      m_node = m_node->m_next;
       return *this;
     }
 
-    for (size_type i = m_index + 1; i < HASHMAP_SIZE; ++i) {
-      if (!m_source.m_data[i].empty()) {
-        m_element = m_source.m_data[i].begin();
-        m_index = i;
-        return *this;
-      }
-    }
-
-    m_index = HASHMAP_SIZE - 1;
-    m_element = m_source.m_data[HASHMAP_SIZE - 1].end();
-    m_isSentinel = true;
+    m_index = m_source->nextOccupied(m_index + 1);
+    if (m_index == m_source->bucketSpan())
+      m_node = nullptr;
+    else
+      m_node = m_source->headAt(m_index);
     return *this;
   }
 
@@ -284,25 +1693,18 @@ class HashMap<KeyType, ValueType>::ConstIterator {
   }
 
   ConstIterator& operator--() {
-    if (m_element != m_source.m_data[m_index].begin()) {
-      --m_element;
-      m_isSentinel = false;
+    if (m_node && m_node != m_source->headAt(m_index)) {
+      m_node = m_node->m_prev;
       return *this;
     }
 
-    if (m_index == 0)
+    const size_type previous = m_source->previousOccupied(m_index);
+    if (previous == m_source->bucketSpan())
       throw std::out_of_range("Previous iterator does not exist");
 
-    for (size_type i = m_index; i; --i) {
-      if (!m_source.m_data[i - 1].empty()) {
-        m_element = --(m_source.m_data[i - 1].end());
-        m_index = i - 1;
-        m_isSentinel = false;
-        return *this;
-      }
-    }
-
-    throw std::out_of_range("Previous iterator does not exist");
+    m_index = previous;
+    m_node = m_source->headAt(previous)->m_prev;
+    return *this;
   }
 
   ConstIterator operator--(int) {
@@ -312,20 +1714,15 @@ class HashMap<KeyType, ValueType>::ConstIterator {
   }
 
   reference operator*() const {
-    if (m_isSentinel)
+    if (!m_node)
       throw std::out_of_range("Iterator does not have a value");
-    return *(m_element);
+    return m_node->m_value;
   }
 
   pointer operator->() const { return &this->operator*(); }
 
   bool operator==(const ConstIterator& other) const {
-    if (&m_source == &(other.m_source)) {
-      if (m_isSentinel == other.m_isSentinel)
-        return true;
-      return m_index == other.m_index && m_element == other.m_element;
-    }
-    return false;
+    return m_source == other.m_source && m_node == other.m_node;
   }
 
   bool operator!=(const ConstIterator& other) const {
@@ -333,19 +1730,22 @@ class HashMap<KeyType, ValueType>::ConstIterator {
   }
 };
 
-template <typename KeyType, typename ValueType>
-class HashMap<KeyType, ValueType>::Iterator
-    : public HashMap<KeyType, ValueType>::ConstIterator {
+template <typename KeyType,
+          typename ValueType,
+          typename Hash,
+          typename KeyEqual,
+          typename Allocator>
+class HashMap<KeyType, ValueType, Hash, KeyEqual, Allocator>::Iterator
+    : public HashMap<KeyType, ValueType, Hash, KeyEqual, Allocator>::
+          ConstIterator {
  public:
   using reference = typename HashMap::reference;
   using pointer = typename HashMap::value_type*;
-  using list_iterator =
-      typename std::list<std::pair<const KeyType, ValueType>>::iterator;
+  using node_pointer = typename ConstIterator::node_pointer;
   explicit Iterator(const HashMap& source,
                     size_type index,
-                    list_iterator element,
-                    bool isSentinel = false)
-      : ConstIterator(source, index, element, isSentinel) {}
+                    node_pointer node)
+      : ConstIterator(source, index, node) {}
 
   Iterator(const ConstIterator& other) : ConstIterator(other) {}
 
@@ -378,6 +1778,16 @@ class HashMap<KeyType, ValueType>::Iterator
     return const_cast<reference>(ConstIterator::operator*());
   }
 };
+
+template <typename KeyType,
+          typename ValueType,
+          typename Hash,
+          typename KeyEqual,
+          typename Allocator>
+void swap(HashMap<KeyType, ValueType, Hash, KeyEqual, Allocator>& lhs,
+          HashMap<KeyType, ValueType, Hash, KeyEqual, Allocator>& rhs) {
+  lhs.swap(rhs);
+}
 }  // namespace aisdi
 
 #endif /* AISDI_MAPS_HASHMAP_H */
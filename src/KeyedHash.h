@@ -0,0 +1,218 @@
+#ifndef AISDI_MAPS_KEYEDHASH_H
+#define AISDI_MAPS_KEYEDHASH_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <random>
+#include <string>
+#include <type_traits>
+
+namespace aisdi {
+
+// Hash keyed with a secret seed, different for every default constructed
+// instance.
+//
+// std::hash of an integer is the integer itself, so keys sharing their low
+// bits, e.g. IDs with a power-of-two stride, all land in one bucket of a
+// power-of-two table. Integers, enums and pointers are therefore run through
+// a multiplicative mixer, which spreads every input bit over the low bits.
+// Strings are hashed with SipHash-1-3, which without the seed gives no way to
+// craft keys that collide, so a hostile key set cannot turn a map into a
+// list. Other types get their std::hash mixed with the seed.
+//
+// Copies keep the seed, so maps copied from one another hash alike. Maps
+// seeded apart can still compare digests of their keys built from
+// fingerprint(), which only depends on a per-process secret.
+template <typename Key>
+class KeyedHash {
+ private:
+  std::uint64_t m_seed0;
+  std::uint64_t m_seed1;
+
+  static std::uint64_t mix(std::uint64_t h) {
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return h;
+  }
+
+  static std::uint64_t processSecret() {
+    static const std::uint64_t secret = []() {
+      std::random_device device;
+      return (static_cast<std::uint64_t>(device()) << 32) ^ device();
+    }();
+    return secret;
+  }
+
+  // Seeds are a counter mixed with a per-process secret, so that drawing
+  // one costs a single atomic increment.
+  static std::uint64_t nextSeed() {
+    static std::atomic<std::uint64_t> counter(0);
+    return mix(processSecret() + ++counter * 0x9e3779b97f4a7c15ULL);
+  }
+
+  static std::uint64_t rotate(std::uint64_t value, int bits) {
+    return (value << bits) | (value >> (64 - bits));
+  }
+
+  static void sipRound(std::uint64_t& v0,
+                       std::uint64_t& v1,
+                       std::uint64_t& v2,
+                       std::uint64_t& v3) {
+    v0 += v1;
+    v1 = rotate(v1, 13);
+    v1 ^= v0;
+    v0 = rotate(v0, 32);
+    v2 += v3;
+    v3 = rotate(v3, 16);
+    v3 ^= v2;
+    v0 += v3;
+    v3 = rotate(v3, 21);
+    v3 ^= v0;
+    v2 += v1;
+    v1 = rotate(v1, 17);
+    v1 ^= v2;
+    v2 = rotate(v2, 32);
+  }
+
+  // SipHash-1-3: one compression round per 8-byte word, three finalization
+  // rounds.
+  std::uint64_t sipHash(const char* data, std::size_t length) const {
+    std::uint64_t v0 = m_seed0 ^ 0x736f6d6570736575ULL;
+    std::uint64_t v1 = m_seed1 ^ 0x646f72616e646f6dULL;
+    std::uint64_t v2 = m_seed0 ^ 0x6c7967656e657261ULL;
+    std::uint64_t v3 = m_seed1 ^ 0x7465646279746573ULL;
+
+    const char* end = data + (length & ~std::size_t(7));
+    for (; data != end; data += 8) {
+      std::uint64_t word;
+      std::memcpy(&word, data, sizeof(word));
+      v3 ^= word;
+      sipRound(v0, v1, v2, v3);
+      v0 ^= word;
+    }
+
+    std::uint64_t last = static_cast<std::uint64_t>(length) << 56;
+    for (std::size_t i = 0; i < (length & 7); ++i)
+      last |= static_cast<std::uint64_t>(static_cast<unsigned char>(data[i]))
+              << (8 * i);
+    v3 ^= last;
+    sipRound(v0, v1, v2, v3);
+    v0 ^= last;
+
+    v2 ^= 0xff;
+    for (int i = 0; i < 3; ++i)
+      sipRound(v0, v1, v2, v3);
+    return v0 ^ v1 ^ v2 ^ v3;
+  }
+
+  std::uint64_t mixInteger(std::uint64_t key) const {
+    return mix((key ^ m_seed0) * 0x9e3779b97f4a7c15ULL + m_seed1);
+  }
+
+  struct IntegerKey {};
+  struct PointerKey {};
+  struct StringKey {};
+  struct OtherKey {};
+
+  using key_kind = typename std::conditional<
+      std::is_integral<Key>::value || std::is_enum<Key>::value,
+      IntegerKey,
+      typename std::conditional<
+          std::is_pointer<Key>::value,
+          PointerKey,
+          typename std::conditional<std::is_same<Key, std::string>::value,
+                                    StringKey,
+                                    OtherKey>::type>::type>::type;
+
+  std::uint64_t hashOf(const Key& key, IntegerKey) const {
+    return mixInteger(static_cast<std::uint64_t>(key));
+  }
+
+  std::uint64_t hashOf(const Key& key, PointerKey) const {
+    return mixInteger(reinterpret_cast<std::uintptr_t>(key));
+  }
+
+  std::uint64_t hashOf(const Key& key, StringKey) const {
+    return sipHash(key.data(), key.size());
+  }
+
+  std::uint64_t hashOf(const Key& key, OtherKey) const {
+    return mixInteger(std::hash<Key>()(key));
+  }
+
+  // Inverse of mix(), as the multipliers are odd and shifting by over half
+  // the width undoes itself.
+  static std::uint64_t unmix(std::uint64_t h) {
+    h ^= h >> 33;
+    h *= 0x9cb4b2f8129337dbULL;
+    h ^= h >> 33;
+    h *= 0x4f74430c22a54005ULL;
+    h ^= h >> 33;
+    return h;
+  }
+
+  static std::uint64_t fingerprintOf(std::uint64_t key) {
+    return mix((key ^ processSecret()) * 0x9e3779b97f4a7c15ULL);
+  }
+
+  std::uint64_t fingerprintOf(const Key& key, std::uint64_t, IntegerKey) const {
+    return fingerprintOf(static_cast<std::uint64_t>(key));
+  }
+
+  std::uint64_t fingerprintOf(const Key& key, std::uint64_t, PointerKey) const {
+    return fingerprintOf(reinterpret_cast<std::uintptr_t>(key));
+  }
+
+  // Strings go through std::hash, which is cheaper than SipHash. Keys that
+  // collide on purpose can only force a full comparison of the maps.
+  std::uint64_t fingerprintOf(const Key& key, std::uint64_t, StringKey) const {
+    return fingerprintOf(std::hash<std::string>()(key));
+  }
+
+  // The std::hash of the key is recovered from the seeded hash instead of
+  // being computed again.
+  std::uint64_t fingerprintOf(const Key& key,
+                              std::uint64_t hash,
+                              OtherKey) const {
+    if (sizeof(std::size_t) < sizeof(std::uint64_t))
+      return fingerprintOf(std::hash<Key>()(key));
+    return fingerprintOf(((unmix(hash) - m_seed1) * 0xf1de83e19937733dULL) ^
+                         m_seed0);
+  }
+
+ public:
+  KeyedHash() : KeyedHash(nextSeed()) {}
+
+  // Deterministic seeding, e.g. to reproduce a run. The second half of the
+  // seed is derived from the first.
+  explicit KeyedHash(std::uint64_t seed)
+      : m_seed0(seed), m_seed1(mix(seed + 0x9e3779b97f4a7c15ULL)) {}
+
+  std::size_t operator()(const Key& key) const {
+    return static_cast<std::size_t>(hashOf(key, key_kind()));
+  }
+
+  std::uint64_t getSeed() const { return m_seed0; }
+
+  // Hash of `key` that is the same for every instance in the process,
+  // whatever its seed. `hash` must be this instance's hash of `key`.
+  std::uint64_t fingerprint(const Key& key, std::size_t hash) const {
+    return fingerprintOf(key, hash, key_kind());
+  }
+
+  // Equal instances hash every key to the same value.
+  bool operator==(const KeyedHash& other) const {
+    return m_seed0 == other.m_seed0 && m_seed1 == other.m_seed1;
+  }
+
+  bool operator!=(const KeyedHash& other) const { return !(*this == other); }
+};
+}  // namespace aisdi
+
+#endif /* AISDI_MAPS_KEYEDHASH_H */
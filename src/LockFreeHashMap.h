@@ -0,0 +1,299 @@
+#ifndef AISDI_MAPS_LOCKFREEHASHMAP_H
+#define AISDI_MAPS_LOCKFREEHASHMAP_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <initializer_list>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "EpochDomain.h"
+
+#define LOCKFREEHASHMAP_MIN_BUCKET_COUNT 8
+#define LOCKFREEHASHMAP_RECLAIM_THRESHOLD 64
+
+namespace aisdi {
+
+// Concurrent map for read-mostly workloads. Lookups take no lock and never
+// wait: they only pin the current epoch and follow atomic pointers. Writers
+// serialize on a mutex among themselves.
+//
+// Published nodes are never modified. Assigning a value links a fresh node in
+// place of the old one, and growing the table publishes a complete copy, so a
+// reader always walks a consistent chain. Unlinked nodes and tables are freed
+// through EpochDomain once no reader can reach them.
+template <typename KeyType,
+          typename ValueType,
+          typename Hash = std::hash<KeyType>,
+          typename KeyEqual = std::equal_to<KeyType>>
+class LockFreeHashMap {
+ public:
+  using key_type = KeyType;
+  using mapped_type = ValueType;
+  using value_type = std::pair<const key_type, mapped_type>;
+  using size_type = std::size_t;
+  using hasher = Hash;
+  using key_equal = KeyEqual;
+
+ private:
+  struct Node {
+    Node(size_type hash, const key_type& key, const mapped_type& value)
+        : m_hash(hash), m_value(key, value) {}
+
+    const size_type m_hash;
+    const value_type m_value;
+    std::atomic<Node*> m_next{nullptr};
+  };
+
+  // Owns every node linked into it.
+  struct Table {
+    explicit Table(size_type bucketCount)
+        : m_mask(bucketCount - 1),
+          m_buckets(new std::atomic<Node*>[bucketCount]) {
+      for (size_type i = 0; i < bucketCount; ++i)
+        m_buckets[i].store(nullptr, std::memory_order_relaxed);
+    }
+
+    ~Table() {
+      for (size_type i = 0; i <= m_mask; ++i) {
+        Node* node = m_buckets[i].load(std::memory_order_relaxed);
+        while (node) {
+          Node* next = node->m_next.load(std::memory_order_relaxed);
+          delete node;
+          node = next;
+        }
+      }
+    }
+
+    size_type getBucketCount() const { return m_mask + 1; }
+
+    std::atomic<Node*>& bucketFor(size_type hash) const {
+      return m_buckets[hash & m_mask];
+    }
+
+    const size_type m_mask;
+    std::unique_ptr<std::atomic<Node*>[]> m_buckets;
+  };
+
+  struct Retired {
+    void* m_pointer;
+    void (*m_deleter)(void*);
+    std::uint64_t m_epoch;
+  };
+
+  Hash hash_fn;
+  KeyEqual equal_fn;
+  std::atomic<Table*> m_table;
+  std::atomic<size_type> m_size{0};
+  std::mutex m_writeMutex;
+  // Unlinked objects waiting for readers to move on. Guarded by m_writeMutex.
+  std::vector<Retired> m_retired;
+
+  static void deleteNode(void* node) { delete static_cast<Node*>(node); }
+
+  static void deleteTable(void* table) { delete static_cast<Table*>(table); }
+
+  static size_type roundUpToPowerOfTwo(size_type count) {
+    size_type result = LOCKFREEHASHMAP_MIN_BUCKET_COUNT;
+    while (result < count)
+      result <<= 1;
+    return result;
+  }
+
+  Node* findNode(const Table& table,
+                 size_type hash,
+                 const key_type& key) const {
+    Node* node = table.bucketFor(hash).load(std::memory_order_acquire);
+    for (; node; node = node->m_next.load(std::memory_order_acquire)) {
+      if (node->m_hash == hash && equal_fn(node->m_value.first, key))
+        return node;
+    }
+    return nullptr;
+  }
+
+  void retire(void* pointer, void (*deleter)(void*)) {
+    EpochDomain& domain = EpochDomain::global();
+    m_retired.push_back(Retired{pointer, deleter, domain.getEpoch()});
+    if (m_retired.size() >= LOCKFREEHASHMAP_RECLAIM_THRESHOLD)
+      reclaim();
+  }
+
+  // Frees retired objects no reader can reach any more. Each object needs
+  // two epoch advances, so two are attempted.
+  void reclaim() {
+    EpochDomain& domain = EpochDomain::global();
+    if (domain.tryAdvance())
+      domain.tryAdvance();
+
+    auto pending = std::partition(
+        m_retired.begin(), m_retired.end(), [&domain](const Retired& retired) {
+          return !domain.isSafeToFree(retired.m_epoch);
+        });
+    for (auto it = pending; it != m_retired.end(); ++it)
+      it->m_deleter(it->m_pointer);
+    m_retired.erase(pending, m_retired.end());
+  }
+
+  // Publishes a copy of the table with twice as many buckets. Nodes of the
+  // old table may be in use by readers, so they are copied, not relinked.
+  void grow(Table* table) {
+    Table* bigger = new Table(table->getBucketCount() << 1);
+    for (size_type i = 0; i <= table->m_mask; ++i) {
+      Node* node = table->m_buckets[i].load(std::memory_order_relaxed);
+      for (; node; node = node->m_next.load(std::memory_order_relaxed)) {
+        Node* copy =
+            new Node(node->m_hash, node->m_value.first, node->m_value.second);
+        std::atomic<Node*>& bucket = bigger->bucketFor(node->m_hash);
+        copy->m_next.store(bucket.load(std::memory_order_relaxed),
+                           std::memory_order_relaxed);
+        bucket.store(copy, std::memory_order_relaxed);
+      }
+    }
+    m_table.store(bigger, std::memory_order_release);
+    retire(table, &deleteTable);
+  }
+
+ public:
+  LockFreeHashMap() : LockFreeHashMap(LOCKFREEHASHMAP_MIN_BUCKET_COUNT) {}
+
+  explicit LockFreeHashMap(size_type bucketCount,
+                           const Hash& hash = Hash(),
+                           const KeyEqual& equal = KeyEqual())
+      : hash_fn(hash),
+        equal_fn(equal),
+        m_table(new Table(roundUpToPowerOfTwo(bucketCount))) {}
+
+  LockFreeHashMap(std::initializer_list<value_type> list)
+      : LockFreeHashMap(list.size()) {
+    for (const value_type& val : list)
+      insertOrAssign(val.first, val.second);
+  }
+
+  LockFreeHashMap(const LockFreeHashMap&) = delete;
+  LockFreeHashMap& operator=(const LockFreeHashMap&) = delete;
+
+  // No reader may use the map any more, so everything is freed at once.
+  ~LockFreeHashMap() {
+    for (const Retired& retired : m_retired)
+      retired.m_deleter(retired.m_pointer);
+    delete m_table.load();
+  }
+
+  // Returns true if the key was inserted, false if its value was replaced.
+  bool insertOrAssign(const key_type& key, const mapped_type& value) {
+    const size_type hash = hash_fn(key);
+    std::lock_guard<std::mutex> lock(m_writeMutex);
+    Table* table = m_table.load(std::memory_order_relaxed);
+    std::atomic<Node*>& bucket = table->bucketFor(hash);
+
+    std::atomic<Node*>* link = &bucket;
+    Node* node = link->load(std::memory_order_relaxed);
+    while (node &&
+           !(node->m_hash == hash && equal_fn(node->m_value.first, key))) {
+      link = &node->m_next;
+      node = link->load(std::memory_order_relaxed);
+    }
+
+    if (node) {
+      Node* replacement = new Node(hash, key, value);
+      replacement->m_next.store(node->m_next.load(std::memory_order_relaxed),
+                                std::memory_order_relaxed);
+      link->store(replacement, std::memory_order_release);
+      retire(node, &deleteNode);
+      return false;
+    }
+
+    Node* inserted = new Node(hash, key, value);
+    inserted->m_next.store(bucket.load(std::memory_order_relaxed),
+                           std::memory_order_relaxed);
+    bucket.store(inserted, std::memory_order_release);
+    const size_type size = m_size.load(std::memory_order_relaxed) + 1;
+    m_size.store(size, std::memory_order_relaxed);
+    if (size > table->getBucketCount())
+      grow(table);
+    return true;
+  }
+
+  void remove(const key_type& key) {
+    const size_type hash = hash_fn(key);
+    std::lock_guard<std::mutex> lock(m_writeMutex);
+    Table* table = m_table.load(std::memory_order_relaxed);
+
+    std::atomic<Node*>* link = &table->bucketFor(hash);
+    Node* node = link->load(std::memory_order_relaxed);
+    while (node &&
+           !(node->m_hash == hash && equal_fn(node->m_value.first, key))) {
+      link = &node->m_next;
+      node = link->load(std::memory_order_relaxed);
+    }
+    if (!node)
+      throw std::out_of_range("Element with given key does not exist");
+
+    link->store(node->m_next.load(std::memory_order_relaxed),
+                std::memory_order_release);
+    m_size.store(m_size.load(std::memory_order_relaxed) - 1,
+                 std::memory_order_relaxed);
+    retire(node, &deleteNode);
+  }
+
+  // Copies the value of `key` to `value`. Returns false if the key is
+  // missing. Lock-free and wait-free.
+  bool tryGet(const key_type& key, mapped_type& value) const {
+    const size_type hash = hash_fn(key);
+    EpochDomain::Guard guard;
+    const Node* node =
+        findNode(*m_table.load(std::memory_order_acquire), hash, key);
+    if (!node)
+      return false;
+    value = node->m_value.second;
+    return true;
+  }
+
+  mapped_type valueOf(const key_type& key) const {
+    const size_type hash = hash_fn(key);
+    EpochDomain::Guard guard;
+    const Node* node =
+        findNode(*m_table.load(std::memory_order_acquire), hash, key);
+    if (!node)
+      throw std::out_of_range("Element with given key does not exist");
+    return node->m_value.second;
+  }
+
+  bool contains(const key_type& key) const {
+    const size_type hash = hash_fn(key);
+    EpochDomain::Guard guard;
+    return findNode(*m_table.load(std::memory_order_acquire), hash, key);
+  }
+
+  // Visits the elements of the table current at the time of the call.
+  // Concurrent updates may or may not be seen.
+  template <typename Function>
+  void forEach(Function function) const {
+    EpochDomain::Guard guard;
+    const Table& table = *m_table.load(std::memory_order_acquire);
+    for (size_type i = 0; i <= table.m_mask; ++i) {
+      Node* node = table.m_buckets[i].load(std::memory_order_acquire);
+      for (; node; node = node->m_next.load(std::memory_order_acquire))
+        function(node->m_value);
+    }
+  }
+
+  size_type getSize() const { return m_size.load(std::memory_order_relaxed); }
+
+  hasher getHashFunction() const { return hash_fn; }
+
+  bool isEmpty() const { return !getSize(); }
+
+  size_type getBucketCount() const {
+    return m_table.load(std::memory_order_acquire)->getBucketCount();
+  }
+};
+}  // namespace aisdi
+
+#endif /* AISDI_MAPS_LOCKFREEHASHMAP_H */
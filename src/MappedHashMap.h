@@ -0,0 +1,391 @@
+#ifndef AISDI_MAPS_MAPPEDHASHMAP_H
+#define AISDI_MAPS_MAPPEDHASHMAP_H
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "KeyedHash.h"
+
+#define MAPPEDHASHMAP_MAGIC 0x31504d4849445341ULL /* "ASDIHMP1" */
+#define MAPPEDHASHMAP_VERSION 1
+#define MAPPEDHASHMAP_SECTION_ALIGNMENT 64
+
+namespace aisdi {
+
+// Read-only hash map served straight from a memory-mapped image file.
+//
+// writeImage() lays a map out as a flat file that holds offsets instead of
+// pointers, so it can be mapped at any address: a header, then for every
+// bucket the index of its first entry, then the hashes of all entries and
+// the entries themselves, both grouped by bucket. Opening an image maps the
+// file and checks the header and the bucket index; no element is read until
+// it is looked up, pages are loaded by the kernel as they are touched, and
+// processes mapping the same image share them.
+//
+// An image must never be modified in place: every process mapping it would
+// see the change, and one that shrinks the file gets SIGBUS on its next
+// lookup. writeImage() therefore writes a new file and renames it over the
+// old one, which views opened before keep reading until they are reopened.
+//
+// Keys and values must be trivially copyable, and an image can only be read
+// by a build with the same layout of entries and byte order, which opening
+// checks. Keys are hashed with the function the image was written with: a
+// KeyedHash gets its seed back from the image, other hash functions are
+// default constructed and must hash alike in every process.
+template <typename KeyType,
+          typename ValueType,
+          typename Hash = KeyedHash<KeyType>,
+          typename KeyEqual = std::equal_to<KeyType>>
+class MappedHashMap {
+  static_assert(std::is_trivially_copyable<KeyType>::value &&
+                    std::is_trivially_copyable<ValueType>::value,
+                "Only trivially copyable keys and values can be mapped");
+
+ public:
+  using key_type = KeyType;
+  using mapped_type = ValueType;
+  using size_type = std::size_t;
+  using hasher = Hash;
+  using key_equal = KeyEqual;
+
+  // Stored as is in the image. Unlike std::pair, it is trivially copyable.
+  struct value_type {
+    key_type first;
+    mapped_type second;
+  };
+
+  using const_reference = const value_type&;
+  using const_iterator = const value_type*;
+
+ private:
+  struct Header {
+    std::uint64_t m_magic;
+    std::uint32_t m_version;
+    std::uint32_t m_entrySize;
+    std::uint32_t m_entryAlignment;
+    std::uint32_t m_keySize;
+    std::uint64_t m_hashSeed;
+    std::uint64_t m_size;
+    std::uint64_t m_bucketCount;
+    std::uint64_t m_bucketsOffset;
+    std::uint64_t m_hashesOffset;
+    std::uint64_t m_entriesOffset;
+    std::uint64_t m_fileSize;
+  };
+
+  const char* m_image = nullptr;
+  size_type m_imageSize = 0;
+  size_type m_size = 0;
+  size_type m_bucketCount = 0;
+  // Bucket i holds entries [m_buckets[i], m_buckets[i + 1]).
+  const std::uint64_t* m_buckets = nullptr;
+  const std::uint64_t* m_hashes = nullptr;
+  const value_type* m_entries = nullptr;
+  Hash hash_fn;
+  KeyEqual equal_fn;
+
+  template <typename H>
+  static std::uint64_t seedOf(const H&) {
+    return 0;
+  }
+
+  template <typename K>
+  static std::uint64_t seedOf(const KeyedHash<K>& hash) {
+    return hash.getSeed();
+  }
+
+  template <typename H>
+  static H hashWithSeed(std::uint64_t, H*) {
+    return H();
+  }
+
+  template <typename K>
+  static KeyedHash<K> hashWithSeed(std::uint64_t seed, KeyedHash<K>*) {
+    return KeyedHash<K>(seed);
+  }
+
+  static size_type alignUp(size_type offset) {
+    return (offset + MAPPEDHASHMAP_SECTION_ALIGNMENT - 1) &
+           ~size_type(MAPPEDHASHMAP_SECTION_ALIGNMENT - 1);
+  }
+
+  static std::runtime_error systemError(const std::string& what,
+                                        const std::string& path) {
+    return std::runtime_error(what + " " + path + ": " +
+                              std::strerror(errno));
+  }
+
+  static void writeAt(std::ofstream& out,
+                      std::uint64_t offset,
+                      const void* data,
+                      size_type length) {
+    static const char padding[MAPPEDHASHMAP_SECTION_ALIGNMENT] = {};
+    for (std::uint64_t position = out.tellp(); out && position < offset;
+         position = out.tellp()) {
+      const std::uint64_t gap = offset - position;
+      out.write(padding, gap < sizeof(padding) ? gap : sizeof(padding));
+    }
+    out.write(static_cast<const char*>(data), length);
+  }
+
+  // Whether `count` items of `itemSize` bytes from `offset` on lie within
+  // the image, starting at a section boundary.
+  bool holdsSection(std::uint64_t offset,
+                    std::uint64_t count,
+                    std::uint64_t itemSize) const {
+    return offset % MAPPEDHASHMAP_SECTION_ALIGNMENT == 0 &&
+           offset <= m_imageSize && count <= (m_imageSize - offset) / itemSize;
+  }
+
+  // Checks the header and the bucket index of the mapped image and points
+  // the sections into it, so that no lookup can read past them.
+  void attach(const std::string& path) {
+    if (m_imageSize < sizeof(Header))
+      throw std::runtime_error("Truncated hash map image " + path);
+    Header header;
+    std::memcpy(&header, m_image, sizeof(header));
+    if (header.m_magic != MAPPEDHASHMAP_MAGIC ||
+        header.m_version != MAPPEDHASHMAP_VERSION)
+      throw std::runtime_error("Not a hash map image " + path);
+    if (header.m_entrySize != sizeof(value_type) ||
+        header.m_entryAlignment != alignof(value_type) ||
+        header.m_keySize != sizeof(key_type))
+      throw std::runtime_error("Hash map image of other types " + path);
+
+    const std::uint64_t bucketCount = header.m_bucketCount;
+    if (!bucketCount || (bucketCount & (bucketCount - 1)) ||
+        header.m_fileSize != m_imageSize ||
+        !holdsSection(header.m_bucketsOffset, bucketCount + 1,
+                      sizeof(std::uint64_t)) ||
+        !holdsSection(header.m_hashesOffset, header.m_size,
+                      sizeof(std::uint64_t)) ||
+        !holdsSection(header.m_entriesOffset, header.m_size,
+                      sizeof(value_type)))
+      throw std::runtime_error("Truncated hash map image " + path);
+
+    m_size = header.m_size;
+    m_bucketCount = bucketCount;
+    m_buckets = reinterpret_cast<const std::uint64_t*>(
+        m_image + header.m_bucketsOffset);
+    m_hashes = reinterpret_cast<const std::uint64_t*>(m_image +
+                                                      header.m_hashesOffset);
+    m_entries =
+        reinterpret_cast<const value_type*>(m_image + header.m_entriesOffset);
+    // Bucket bounds must rise from 0 to the size, or a lookup could leave
+    // the sections.
+    std::uint64_t previous = 0;
+    for (std::uint64_t i = 0; i <= bucketCount; ++i) {
+      if (m_buckets[i] < previous || m_buckets[i] > m_size)
+        throw std::runtime_error("Corrupt hash map image " + path);
+      previous = m_buckets[i];
+    }
+    if (m_buckets[0] != 0 || previous != m_size)
+      throw std::runtime_error("Corrupt hash map image " + path);
+    hash_fn = hashWithSeed(header.m_hashSeed, static_cast<Hash*>(nullptr));
+  }
+
+  void unmap() {
+    if (m_image)
+      munmap(const_cast<char*>(m_image), m_imageSize);
+    m_image = nullptr;
+    m_imageSize = 0;
+  }
+
+  const value_type* findEntry(const key_type& key) const {
+    if (!m_size)
+      return nullptr;
+    const std::uint64_t hash = hash_fn(key);
+    const size_type index = hash & (m_bucketCount - 1);
+    for (std::uint64_t i = m_buckets[index]; i != m_buckets[index + 1]; ++i) {
+      if (m_hashes[i] == hash && equal_fn(m_entries[i].first, key))
+        return m_entries + i;
+    }
+    return nullptr;
+  }
+
+ public:
+  // Writes an image of `map`, which may be any map of these key and value
+  // types iterating over pairs, hashed with its own hash function.
+  template <typename Map>
+  static void writeImage(const Map& map, const std::string& path) {
+    const Hash hash = map.getHashFunction();
+    const size_type size = map.getSize();
+    size_type bucketCount = 1;
+    while (bucketCount < size)
+      bucketCount <<= 1;
+
+    std::vector<std::uint64_t> buckets(bucketCount + 1, 0);
+    for (const auto& item : map)
+      ++buckets[(hash(item.first) & (bucketCount - 1)) + 1];
+    for (size_type i = 0; i < bucketCount; ++i)
+      buckets[i + 1] += buckets[i];
+
+    // Entries are placed by counting sort on their bucket.
+    std::vector<std::uint64_t> hashes(size);
+    std::vector<value_type> entries(size);
+    std::vector<std::uint64_t> next(buckets.begin(), buckets.end() - 1);
+    for (const auto& item : map) {
+      const std::uint64_t h = hash(item.first);
+      const std::uint64_t position = next[h & (bucketCount - 1)]++;
+      hashes[position] = h;
+      entries[position] = value_type{item.first, item.second};
+    }
+
+    Header header = Header();
+    header.m_magic = MAPPEDHASHMAP_MAGIC;
+    header.m_version = MAPPEDHASHMAP_VERSION;
+    header.m_entrySize = sizeof(value_type);
+    header.m_entryAlignment = alignof(value_type);
+    header.m_keySize = sizeof(key_type);
+    header.m_hashSeed = seedOf(hash);
+    header.m_size = size;
+    header.m_bucketCount = bucketCount;
+    header.m_bucketsOffset = alignUp(sizeof(Header));
+    header.m_hashesOffset = alignUp(header.m_bucketsOffset +
+                                    buckets.size() * sizeof(std::uint64_t));
+    header.m_entriesOffset =
+        alignUp(header.m_hashesOffset + size * sizeof(std::uint64_t));
+    header.m_fileSize = header.m_entriesOffset + size * sizeof(value_type);
+
+    // The image is written next to `path` and renamed over it, so that
+    // views of an image previously at `path` keep reading it unchanged.
+    std::vector<char> name(path.begin(), path.end());
+    const char suffix[] = ".XXXXXX";
+    name.insert(name.end(), suffix, suffix + sizeof(suffix));
+    const int fd = ::mkstemp(name.data());
+    if (fd < 0)
+      throw systemError("Cannot create", path);
+    const std::string temporary(name.data());
+    const bool created = ::fchmod(fd, 0644) == 0;
+    ::close(fd);
+
+    try {
+      if (!created)
+        throw systemError("Cannot create", temporary);
+      std::ofstream out(temporary, std::ios::binary | std::ios::trunc);
+      if (!out)
+        throw systemError("Cannot create", temporary);
+      writeAt(out, 0, &header, sizeof(header));
+      writeAt(out, header.m_bucketsOffset, buckets.data(),
+              buckets.size() * sizeof(std::uint64_t));
+      writeAt(out, header.m_hashesOffset, hashes.data(),
+              size * sizeof(std::uint64_t));
+      writeAt(out, header.m_entriesOffset, entries.data(),
+              size * sizeof(value_type));
+      out.close();
+      if (!out)
+        throw systemError("Cannot write", temporary);
+      if (std::rename(temporary.c_str(), path.c_str()) != 0)
+        throw systemError("Cannot replace", path);
+    } catch (...) {
+      std::remove(temporary.c_str());
+      throw;
+    }
+  }
+
+  // Maps the image at `path` read-only. Throws std::runtime_error if it
+  // cannot be read or does not hold a map of these types.
+  explicit MappedHashMap(const std::string& path,
+                         const KeyEqual& equal = KeyEqual())
+      : equal_fn(equal) {
+    const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+      throw systemError("Cannot open", path);
+    struct stat status;
+    if (::fstat(fd, &status) != 0) {
+      const std::runtime_error error = systemError("Cannot stat", path);
+      ::close(fd);
+      throw error;
+    }
+
+    m_imageSize = status.st_size;
+    void* image = m_imageSize ? ::mmap(nullptr, m_imageSize, PROT_READ,
+                                       MAP_SHARED, fd, 0)
+                              : MAP_FAILED;
+    const int mapError = errno;
+    ::close(fd);
+    if (image == MAP_FAILED) {
+      errno = m_imageSize ? mapError : EINVAL;
+      throw systemError("Cannot map", path);
+    }
+    m_image = static_cast<const char*>(image);
+
+    try {
+      attach(path);
+    } catch (...) {
+      unmap();
+      throw;
+    }
+  }
+
+  MappedHashMap(const MappedHashMap&) = delete;
+  MappedHashMap& operator=(const MappedHashMap&) = delete;
+
+  MappedHashMap(MappedHashMap&& other) noexcept
+      : m_image(other.m_image),
+        m_imageSize(other.m_imageSize),
+        m_size(other.m_size),
+        m_bucketCount(other.m_bucketCount),
+        m_buckets(other.m_buckets),
+        m_hashes(other.m_hashes),
+        m_entries(other.m_entries),
+        hash_fn(other.hash_fn),
+        equal_fn(other.equal_fn) {
+    other.m_image = nullptr;
+    other.m_imageSize = 0;
+    other.m_size = 0;
+    other.m_entries = nullptr;
+  }
+
+  ~MappedHashMap() { unmap(); }
+
+  bool isEmpty() const { return !m_size; }
+
+  size_type getSize() const { return m_size; }
+
+  size_type getBucketCount() const { return m_bucketCount; }
+
+  hasher getHashFunction() const { return hash_fn; }
+
+  const mapped_type& valueOf(const key_type& key) const {
+    const value_type* entry = findEntry(key);
+    if (!entry)
+      throw std::out_of_range("Element with given key does not exist");
+    return entry->second;
+  }
+
+  const_iterator find(const key_type& key) const {
+    const value_type* entry = findEntry(key);
+    return entry ? entry : end();
+  }
+
+  bool contains(const key_type& key) const { return findEntry(key); }
+
+  // Entries come in the order of their buckets.
+  const_iterator cbegin() const { return m_entries; }
+
+  const_iterator cend() const { return m_entries + m_size; }
+
+  const_iterator begin() const { return cbegin(); }
+
+  const_iterator end() const { return cend(); }
+};
+}  // namespace aisdi
+
+#endif /* AISDI_MAPS_MAPPEDHASHMAP_H */
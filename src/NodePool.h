@@ -0,0 +1,163 @@
+#ifndef AISDI_MAPS_NODEPOOL_H
+#define AISDI_MAPS_NODEPOOL_H
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#define NODEPOOL_MIN_SLAB_BLOCKS 4
+#define NODEPOOL_MAX_SLAB_BLOCKS 4096
+
+namespace aisdi {
+
+// Hands out fixed-size blocks for objects of type T, carved from slabs that
+// grow geometrically up to NODEPOOL_MAX_SLAB_BLOCKS blocks. Freed blocks go to
+// a free list and are reused before any new slab is requested, so steady
+// insert/remove churn does not touch the underlying allocator at all.
+//
+// The pool owns its slabs and returns them all at once in release() or in the
+// destructor. Objects still alive at that point are not destroyed; the owner
+// is expected to destroy them first, if their type requires it.
+template <typename T, typename Allocator = std::allocator<T>>
+class NodePool {
+ public:
+  using size_type = std::size_t;
+  using allocator_type = Allocator;
+
+ private:
+  union Block {
+    Block* m_next;
+    typename std::aligned_storage<sizeof(T), alignof(T)>::type m_storage;
+  };
+
+  struct Slab {
+    Block* m_blocks;
+    size_type m_count;
+  };
+
+  template <typename U>
+  using rebind_allocator =
+      typename std::allocator_traits<Allocator>::template rebind_alloc<U>;
+  using block_allocator = rebind_allocator<Block>;
+  using block_traits = std::allocator_traits<block_allocator>;
+
+  block_allocator m_allocator;
+  std::vector<Slab, rebind_allocator<Slab>> m_slabs;
+  // Blocks returned by deallocate(), linked through their first word.
+  Block* m_free = nullptr;
+  // Never used blocks at the end of the newest slab.
+  Block* m_next = nullptr;
+  Block* m_end = nullptr;
+  size_type m_nextSlabSize = NODEPOOL_MIN_SLAB_BLOCKS;
+
+  // Adds a slab of at least `count` blocks, and never fewer than the
+  // geometric growth calls for.
+  void addSlab(size_type count) {
+    count = std::max(count, m_nextSlabSize);
+    m_slabs.reserve(m_slabs.size() + 1);
+    Block* blocks = block_traits::allocate(m_allocator, count);
+    m_slabs.push_back(Slab{blocks, count});
+    m_next = blocks;
+    m_end = blocks + count;
+    if (m_nextSlabSize < NODEPOOL_MAX_SLAB_BLOCKS)
+      m_nextSlabSize <<= 1;
+  }
+
+ public:
+  explicit NodePool(const Allocator& allocator = Allocator())
+      : m_allocator(allocator), m_slabs(rebind_allocator<Slab>(allocator)) {}
+
+  NodePool(const NodePool&) = delete;
+  NodePool& operator=(const NodePool&) = delete;
+
+  NodePool(NodePool&& other)
+      : m_allocator(other.m_allocator),
+        m_slabs(rebind_allocator<Slab>(other.m_allocator)) {
+    swap(other);
+  }
+
+  ~NodePool() { release(); }
+
+  // Both pools must use equal allocators.
+  void swap(NodePool& other) {
+    using std::swap;
+    swap(m_allocator, other.m_allocator);
+    m_slabs.swap(other.m_slabs);
+    swap(m_free, other.m_free);
+    swap(m_next, other.m_next);
+    swap(m_end, other.m_end);
+    swap(m_nextSlabSize, other.m_nextSlabSize);
+  }
+
+  void* allocate() {
+    if (m_free) {
+      Block* block = m_free;
+      m_free = block->m_next;
+      return block;
+    }
+
+    if (m_next == m_end)
+      addSlab(0);
+    return m_next++;
+  }
+
+  void deallocate(void* pointer) {
+    Block* block = static_cast<Block*>(pointer);
+    block->m_next = m_free;
+    m_free = block;
+  }
+
+  template <typename... Args>
+  T* create(Args&&... args) {
+    void* memory = allocate();
+    try {
+      return ::new (memory) T(std::forward<Args>(args)...);
+    } catch (...) {
+      deallocate(memory);
+      throw;
+    }
+  }
+
+  void destroy(T* object) {
+    object->~T();
+    deallocate(object);
+  }
+
+  // Makes sure the next `count` allocations do not reach the allocator, e.g.
+  // before copying a whole map. Blocks on the free list are not counted.
+  // Unused blocks of the newest slab go to the free list, to be handed out
+  // before those of the slab added for the rest.
+  void reserve(size_type count) {
+    const size_type available = m_end - m_next;
+    if (available >= count)
+      return;
+    // Added first, so that the free list is untouched if this throws.
+    Block* next = m_next;
+    Block* end = m_end;
+    addSlab(count - available);
+    while (end != next) {
+      --end;
+      end->m_next = m_free;
+      m_free = end;
+    }
+  }
+
+  // Returns every slab to the allocator. All blocks handed out before become
+  // invalid.
+  void release() {
+    for (const Slab& slab : m_slabs)
+      block_traits::deallocate(m_allocator, slab.m_blocks, slab.m_count);
+    m_slabs.clear();
+    m_free = m_next = m_end = nullptr;
+    m_nextSlabSize = NODEPOOL_MIN_SLAB_BLOCKS;
+  }
+
+  size_type getSlabCount() const { return m_slabs.size(); }
+};
+}  // namespace aisdi
+
+#endif /* AISDI_MAPS_NODEPOOL_H */
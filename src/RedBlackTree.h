@@ -0,0 +1,311 @@
+#ifndef AISDI_MAPS_REDBLACKTREE_H
+#define AISDI_MAPS_REDBLACKTREE_H
+
+#include <cstddef>
+#include <iterator>
+
+namespace aisdi {
+
+// Red-black balancing of an intrusive tree, shared by TreeMap and the
+// treeified buckets of HashMap.
+//
+// `Node` needs m_p, m_left and m_right pointers and an m_color of an enum
+// Color { BLACK, RED }. The tree owns none of its nodes: it works on a root
+// pointer and a sentinel `nil` node held by the caller, which stands for
+// every missing child and for the parent of the root. The children of `nil`
+// are kept pointing at the root, so that an iterator at `nil` can step back
+// into the tree. Searching is left to the caller, since the order of keys
+// is its business.
+template <typename Node>
+class RedBlackTree {
+ public:
+  using size_type = std::size_t;
+
+  RedBlackTree(Node*& root, Node* nil) : m_root(root), m_nil(nil) {}
+
+  // Links the new node `z` as the left or right child of `parent`, which is
+  // `nil` for an empty tree, and rebalances.
+  void link(Node* parent, bool left, Node* z) {
+    z->m_p = parent;
+
+    if (parent == m_nil)
+      setRoot(z);
+    else if (left)
+      parent->m_left = z;
+    else
+      parent->m_right = z;
+
+    z->m_left = m_nil;
+    z->m_right = m_nil;
+    z->m_color = Node::Color::RED;
+
+    insertFixup(z);
+  }
+
+  // Unlinks `z` and rebalances. The node itself is left to the caller.
+  void unlink(Node* z) {
+    Node* x;
+    Node* y = z;
+    auto yOriginalColor = y->m_color;
+
+    if (z->m_left == m_nil) {
+      x = z->m_right;
+      transplant(z, z->m_right);
+    } else if (z->m_right == m_nil) {
+      x = z->m_left;
+      transplant(z, z->m_left);
+    } else {
+      y = z->m_right;
+
+      while (y->m_left != m_nil)
+        y = y->m_left;
+
+      yOriginalColor = y->m_color;
+      x = y->m_right;
+
+      if (y->m_p == z)
+        x->m_p = y;
+      else {
+        transplant(y, y->m_right);
+        y->m_right = z->m_right;
+        y->m_right->m_p = y;
+      }
+
+      transplant(z, y);
+      y->m_left = z->m_left;
+      y->m_left->m_p = y;
+      y->m_color = z->m_color;
+    }
+
+    if (yOriginalColor == Node::Color::BLACK)
+      deleteFixup(x);
+  }
+
+  // Replaces the empty tree with one linking the nodes of [first, last),
+  // sorted by key, in linear time.
+  template <typename RandomIt>
+  void buildFromSorted(RandomIt first, RandomIt last) {
+    const size_type count = std::distance(first, last);
+    if (!count)
+      return;
+
+    size_type redDepth = 0;
+    while ((size_type(2) << redDepth) <= count)
+      ++redDepth;
+    setRoot(buildBalanced(first, 0, count, m_nil, 0, redDepth));
+    m_root->m_color = Node::Color::BLACK;
+  }
+
+  // Leftmost node, or `nil` for an empty tree.
+  Node* first() const {
+    if (m_root == m_nil)
+      return m_nil;
+
+    Node* x = m_root;
+    while (x->m_left != m_nil)
+      x = x->m_left;
+    return x;
+  }
+
+  // In-order successor of `x`, or `nil` after the last node.
+  Node* next(Node* x) const {
+    if (x->m_right != m_nil) {
+      x = x->m_right;
+      while (x->m_left != m_nil)
+        x = x->m_left;
+      return x;
+    }
+
+    Node* y = x->m_p;
+    while (y != m_nil && x == y->m_right) {
+      x = y;
+      y = y->m_p;
+    }
+    return y;
+  }
+
+ private:
+  Node*& m_root;
+  Node* m_nil;
+
+  void setRoot(Node* root) {
+    m_root = root;
+    m_nil->m_left = m_root;
+    m_nil->m_right = m_root;
+  }
+
+  void leftRotate(Node* x) {
+    Node* y = x->m_right;
+    x->m_right = y->m_left;
+
+    if (y->m_left != m_nil)
+      y->m_left->m_p = x;
+
+    y->m_p = x->m_p;
+
+    if (x->m_p == m_nil)
+      setRoot(y);
+    else if (x == x->m_p->m_left)
+      x->m_p->m_left = y;
+    else
+      x->m_p->m_right = y;
+    y->m_left = x;
+    x->m_p = y;
+  }
+
+  void rightRotate(Node* x) {
+    Node* y = x->m_left;
+    x->m_left = y->m_right;
+
+    if (y->m_right != m_nil)
+      y->m_right->m_p = x;
+
+    y->m_p = x->m_p;
+
+    if (x->m_p == m_nil)
+      setRoot(y);
+    else if (x == x->m_p->m_right)
+      x->m_p->m_right = y;
+    else
+      x->m_p->m_left = y;
+    y->m_right = x;
+    x->m_p = y;
+  }
+
+  void insertFixup(Node* z) {
+    Node* y;
+
+    while (z->m_p->m_color) {
+      if (z->m_p == z->m_p->m_p->m_left) {
+        y = z->m_p->m_p->m_right;
+        if (y->m_color) {
+          z->m_p->m_color = Node::Color::BLACK;
+          y->m_color = Node::Color::BLACK;
+          z->m_p->m_p->m_color = Node::Color::RED;
+          z = z->m_p->m_p;
+        } else {
+          if (z == z->m_p->m_right) {
+            z = z->m_p;
+            leftRotate(z);
+          }
+          z->m_p->m_color = Node::Color::BLACK;
+          z->m_p->m_p->m_color = Node::Color::RED;
+          rightRotate(z->m_p->m_p);
+        }
+      } else {
+        y = z->m_p->m_p->m_left;
+        if (y->m_color) {
+          z->m_p->m_color = Node::Color::BLACK;
+          y->m_color = Node::Color::BLACK;
+          z->m_p->m_p->m_color = Node::Color::RED;
+          z = z->m_p->m_p;
+        } else {
+          if (z == z->m_p->m_left) {
+            z = z->m_p;
+            rightRotate(z);
+          }
+          z->m_p->m_color = Node::Color::BLACK;
+          z->m_p->m_p->m_color = Node::Color::RED;
+          leftRotate(z->m_p->m_p);
+        }
+      }
+    }
+
+    m_root->m_color = Node::Color::BLACK;
+  }
+
+  void transplant(Node* u, Node* v) {
+    if (u->m_p == m_nil)
+      setRoot(v);
+    else if (u == u->m_p->m_left)
+      u->m_p->m_left = v;
+    else
+      u->m_p->m_right = v;
+    v->m_p = u->m_p;
+  }
+
+  void deleteFixup(Node* x) {
+    Node* w;
+    while (x != m_root && x->m_color == Node::Color::BLACK) {
+      if (x == x->m_p->m_left) {
+        w = x->m_p->m_right;
+        if (w->m_color) {
+          w->m_color = Node::Color::BLACK;
+          x->m_p->m_color = Node::Color::RED;
+          leftRotate(x->m_p);
+          w = x->m_p->m_right;
+        }
+        if (w->m_left->m_color == Node::Color::BLACK &&
+            w->m_right->m_color == Node::Color::BLACK) {
+          w->m_color = Node::Color::RED;
+          x = x->m_p;
+        } else {
+          if (w->m_right->m_color == Node::Color::BLACK) {
+            w->m_left->m_color = Node::Color::BLACK;
+            w->m_color = Node::Color::RED;
+            rightRotate(w);
+            w = x->m_p->m_right;
+          }
+          w->m_color = x->m_p->m_color;
+          x->m_p->m_color = Node::Color::BLACK;
+          w->m_right->m_color = Node::Color::BLACK;
+          leftRotate(x->m_p);
+          x = m_root;
+        }
+      } else {
+        w = x->m_p->m_left;
+        if (w->m_color) {
+          w->m_color = Node::Color::BLACK;
+          x->m_p->m_color = Node::Color::RED;
+          rightRotate(x->m_p);
+          w = x->m_p->m_left;
+        }
+        if (w->m_right->m_color == Node::Color::BLACK &&
+            w->m_left->m_color == Node::Color::BLACK) {
+          w->m_color = Node::Color::RED;
+          x = x->m_p;
+        } else {
+          if (w->m_left->m_color == Node::Color::BLACK) {
+            w->m_right->m_color = Node::Color::BLACK;
+            w->m_color = Node::Color::RED;
+            leftRotate(w);
+            w = x->m_p->m_left;
+          }
+          w->m_color = x->m_p->m_color;
+          x->m_p->m_color = Node::Color::BLACK;
+          w->m_left->m_color = Node::Color::BLACK;
+          rightRotate(x->m_p);
+          x = m_root;
+        }
+      }
+    }
+
+    x->m_color = Node::Color::BLACK;
+  }
+
+  // Links nodes[first, last) into a balanced subtree and returns its root.
+  // The split keeps every level but the deepest one full, so coloring just
+  // the deepest level red gives all paths the same number of black nodes.
+  template <typename RandomIt>
+  Node* buildBalanced(RandomIt nodes,
+                      size_type first,
+                      size_type last,
+                      Node* parent,
+                      size_type depth,
+                      size_type redDepth) {
+    if (first == last)
+      return m_nil;
+
+    const size_type middle = first + (last - first) / 2;
+    Node* x = nodes[middle];
+    x->m_p = parent;
+    x->m_left = buildBalanced(nodes, first, middle, x, depth + 1, redDepth);
+    x->m_right =
+        buildBalanced(nodes, middle + 1, last, x, depth + 1, redDepth);
+    x->m_color = depth == redDepth ? Node::Color::RED : Node::Color::BLACK;
+    return x;
+  }
+};
+}  // namespace aisdi
+
+#endif /* AISDI_MAPS_REDBLACKTREE_H */
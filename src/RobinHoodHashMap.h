@@ -0,0 +1,575 @@
+#ifndef AISDI_MAPS_ROBINHOODHASHMAP_H
+#define AISDI_MAPS_ROBINHOODHASHMAP_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <initializer_list>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <utility>
+
+#define ROBINHOODHASHMAP_MIN_CAPACITY 8
+#define ROBINHOODHASHMAP_MIN_PROBE_LENGTH 4
+#define ROBINHOODHASHMAP_MAX_LOAD_PERCENT 90
+
+namespace aisdi {
+
+// Open addressing hash map with Robin Hood linear probing. Every slot records
+// its distance from the home slot of its key, and entries are kept ordered by
+// home slot, so that a lookup can stop as soon as it meets an entry closer to
+// its home than the probed key would be. Removal shifts the following entries
+// back by one slot, so no tombstones are ever left behind.
+//
+// Probes never wrap around: the table has extra slots past its capacity and
+// grows whenever an entry would have to be placed further than the maximum
+// probe length from its home.
+template <typename KeyType, typename ValueType>
+class RobinHoodHashMap {
+ public:
+  using key_type = KeyType;
+  using mapped_type = ValueType;
+  using value_type = std::pair<const key_type, mapped_type>;
+  using size_type = std::size_t;
+  using reference = value_type&;
+  using const_reference = const value_type&;
+
+  class ConstIterator;
+  class Iterator;
+  using iterator = Iterator;
+  using const_iterator = ConstIterator;
+
+ private:
+  using distance_type = std::int8_t;
+
+  static const distance_type kEmpty = -1;
+
+  // m_distances has one more element than there are slots; it is always
+  // empty and stops every scan.
+  distance_type* m_distances = nullptr;
+  value_type* m_slots = nullptr;
+  size_type m_capacity = 0;
+  size_type m_maxProbeLength = 0;
+  size_type m_size = 0;
+  std::hash<key_type> hash_fn;
+  std::allocator<value_type> m_allocator;
+
+  size_type hashOf(const key_type& key) const {
+    std::uint64_t h = hash_fn(key);
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return static_cast<size_type>(h);
+  }
+
+  size_type homeOf(size_type hash) const { return hash & (m_capacity - 1); }
+
+  size_type slotCount() const {
+    return m_capacity ? m_capacity + m_maxProbeLength : 0;
+  }
+
+  bool isFull(size_type index) const { return m_distances[index] != kEmpty; }
+
+  static size_type probeLengthFor(size_type capacity) {
+    size_type length = 0;
+    while (capacity >>= 1)
+      ++length;
+    return length < ROBINHOODHASHMAP_MIN_PROBE_LENGTH
+               ? ROBINHOODHASHMAP_MIN_PROBE_LENGTH
+               : length;
+  }
+
+  size_type findIndex(const key_type& key) const {
+    if (!m_capacity)
+      return slotCount();
+
+    size_type index = homeOf(hashOf(key));
+    for (distance_type distance = 0; m_distances[index] >= distance;
+         ++index, ++distance) {
+      if (m_slots[index].first == key)
+        return index;
+    }
+    return slotCount();
+  }
+
+  // Replaces the arrays only once both are allocated, so the map is left
+  // untouched if either allocation throws.
+  void allocate(size_type capacity, size_type maxProbeLength) {
+    const size_type count = capacity + maxProbeLength;
+    distance_type* distances = new distance_type[count + 1];
+    value_type* slots;
+    try {
+      slots = m_allocator.allocate(count);
+    } catch (...) {
+      delete[] distances;
+      throw;
+    }
+    std::memset(distances, kEmpty, count + 1);
+    m_distances = distances;
+    m_slots = slots;
+    m_capacity = capacity;
+    m_maxProbeLength = maxProbeLength;
+  }
+
+  void destroyAll() {
+    for (size_type i = 0; i < slotCount(); ++i)
+      if (isFull(i))
+        m_slots[i].~value_type();
+  }
+
+  void deallocate() {
+    if (m_capacity) {
+      delete[] m_distances;
+      m_allocator.deallocate(m_slots, slotCount());
+    }
+    m_distances = nullptr;
+    m_slots = nullptr;
+    m_capacity = 0;
+    m_maxProbeLength = 0;
+  }
+
+  void moveSlot(size_type from, size_type to, distance_type distance) {
+    ::new (static_cast<void*>(m_slots + to))
+        value_type(std::move(m_slots[from]));
+    m_slots[from].~value_type();
+    m_distances[to] = distance;
+    m_distances[from] = kEmpty;
+  }
+
+  // Finds the slot for a key known to be absent and frees it by shifting the
+  // following run of entries forward by one slot. Returns slotCount() when
+  // that would push an entry past the maximum probe length. The slot is left
+  // empty, and `distance` is set to the probe distance to store there once
+  // the entry has been constructed; closeGap() undoes the shift otherwise.
+  // An entry that fails to move, as moving copies the key, has the shift
+  // undone in the same way.
+  size_type makeRoomFor(size_type hash, distance_type& distance) {
+    size_type index = homeOf(hash);
+    distance = 0;
+    while (m_distances[index] >= distance) {
+      ++index;
+      ++distance;
+    }
+    if (static_cast<size_type>(distance) > m_maxProbeLength)
+      return slotCount();
+
+    size_type last = index;
+    while (isFull(last)) {
+      if (static_cast<size_type>(m_distances[last]) + 1 > m_maxProbeLength)
+        return slotCount();
+      ++last;
+    }
+    if (last >= slotCount())
+      return slotCount();
+
+    try {
+      for (; last > index; --last)
+        moveSlot(last - 1, last, m_distances[last - 1] + 1);
+    } catch (...) {
+      closeGap(last);
+      throw;
+    }
+    return index;
+  }
+
+  // Shifts the run of displaced entries after an empty slot back by one. If
+  // an entry fails to move, it and the rest of the run are destroyed rather
+  // than left unreachable behind the empty slot, and the exception is
+  // rethrown.
+  void closeGap(size_type index) {
+    for (++index; m_distances[index] > 0; ++index) {
+      try {
+        moveSlot(index, index - 1, m_distances[index] - 1);
+      } catch (...) {
+        for (; m_distances[index] > 0; ++index) {
+          m_slots[index].~value_type();
+          m_distances[index] = kEmpty;
+          --m_size;
+        }
+        throw;
+      }
+    }
+  }
+
+  // Rebuilds the table with the given capacity and probe limit. Entries are
+  // moved only if that cannot throw, and copied otherwise, so that the old
+  // table is left intact if an entry fails to transfer.
+  void resize(size_type capacity, size_type maxProbeLength) {
+    distance_type* oldDistances = m_distances;
+    value_type* oldSlots = m_slots;
+    const size_type oldCapacity = m_capacity;
+    const size_type oldMaxProbeLength = m_maxProbeLength;
+    const size_type oldCount = slotCount();
+    const size_type oldSize = m_size;
+
+    allocate(capacity, maxProbeLength);
+    try {
+      for (size_type i = 0; i < oldCount; ++i) {
+        if (oldDistances[i] != kEmpty) {
+          distance_type distance;
+          const size_type index =
+              findSlotFor(hashOf(oldSlots[i].first), distance);
+          try {
+            ::new (static_cast<void*>(m_slots + index))
+                value_type(std::move_if_noexcept(oldSlots[i]));
+          } catch (...) {
+            closeGap(index);
+            throw;
+          }
+          m_distances[index] = distance;
+        }
+      }
+    } catch (...) {
+      destroyAll();
+      deallocate();
+      m_distances = oldDistances;
+      m_slots = oldSlots;
+      m_capacity = oldCapacity;
+      m_maxProbeLength = oldMaxProbeLength;
+      m_size = oldSize;
+      throw;
+    }
+
+    if (oldCount) {
+      for (size_type i = 0; i < oldCount; ++i)
+        if (oldDistances[i] != kEmpty)
+          oldSlots[i].~value_type();
+      delete[] oldDistances;
+      m_allocator.deallocate(oldSlots, oldCount);
+    }
+  }
+
+  // A probe overflow at a low load factor means that many keys share a hash;
+  // doubling the capacity would not help them, so the probe limit grows
+  // instead.
+  void grow() {
+    if (!m_capacity)
+      resize(ROBINHOODHASHMAP_MIN_CAPACITY,
+             probeLengthFor(ROBINHOODHASHMAP_MIN_CAPACITY));
+    else if (m_size * 2 < m_capacity &&
+             m_maxProbeLength * 2 < static_cast<size_type>(INT8_MAX))
+      resize(m_capacity, m_maxProbeLength * 2);
+    else
+      resize(m_capacity * 2, probeLengthFor(m_capacity * 2));
+  }
+
+  // Growing in the middle of a resize is fine: it rebuilds the partially
+  // filled new table, and the caller keeps moving the remaining entries.
+  size_type findSlotFor(size_type hash, distance_type& distance) {
+    size_type index;
+    while ((index = makeRoomFor(hash, distance)) == slotCount())
+      grow();
+    return index;
+  }
+
+  // Frees a slot for a new entry; see makeRoomFor().
+  size_type prepareInsert(size_type hash, distance_type& distance) {
+    if ((m_size + 1) * 100 > m_capacity * ROBINHOODHASHMAP_MAX_LOAD_PERCENT)
+      resize(m_capacity ? m_capacity * 2 : ROBINHOODHASHMAP_MIN_CAPACITY,
+             probeLengthFor(m_capacity ? m_capacity * 2
+                                       : ROBINHOODHASHMAP_MIN_CAPACITY));
+    return findSlotFor(hash, distance);
+  }
+
+  void eraseAt(size_type index) {
+    m_slots[index].~value_type();
+    m_distances[index] = kEmpty;
+    --m_size;
+    closeGap(index);
+  }
+
+  void copyFrom(const RobinHoodHashMap& other) {
+    if (!other.m_capacity)
+      return;
+
+    allocate(other.m_capacity, other.m_maxProbeLength);
+    try {
+      for (size_type i = 0; i < slotCount(); ++i) {
+        if (other.isFull(i)) {
+          ::new (static_cast<void*>(m_slots + i)) value_type(other.m_slots[i]);
+          m_distances[i] = other.m_distances[i];
+        }
+      }
+    } catch (...) {
+      destroyAll();
+      deallocate();
+      throw;
+    }
+    m_size = other.m_size;
+  }
+
+  void swapContents(RobinHoodHashMap& other) {
+    std::swap(m_distances, other.m_distances);
+    std::swap(m_slots, other.m_slots);
+    std::swap(m_capacity, other.m_capacity);
+    std::swap(m_maxProbeLength, other.m_maxProbeLength);
+    std::swap(m_size, other.m_size);
+  }
+
+  size_type nextFull(size_type index) const {
+    const size_type count = slotCount();
+    while (index < count && !isFull(index))
+      ++index;
+    return index < count ? index : count;
+  }
+
+ public:
+  RobinHoodHashMap() {}
+
+  RobinHoodHashMap(std::initializer_list<value_type> list) {
+    reserve(list.size());
+    for (const value_type& val : list)
+      (*this)[val.first] = val.second;
+  }
+
+  RobinHoodHashMap(const RobinHoodHashMap& other) { copyFrom(other); }
+
+  RobinHoodHashMap(RobinHoodHashMap&& other) { swapContents(other); }
+
+  ~RobinHoodHashMap() {
+    destroyAll();
+    deallocate();
+  }
+
+  RobinHoodHashMap& operator=(const RobinHoodHashMap& other) {
+    if (this != &other) {
+      RobinHoodHashMap copy(other);
+      swapContents(copy);
+    }
+    return *this;
+  }
+
+  RobinHoodHashMap& operator=(RobinHoodHashMap&& other) {
+    if (this != &other) {
+      destroyAll();
+      deallocate();
+      m_size = 0;
+      swapContents(other);
+    }
+    return *this;
+  }
+
+  bool isEmpty() const { return !m_size; }
+
+  mapped_type& operator[](const key_type& key) {
+    size_type index = findIndex(key);
+    if (index == slotCount()) {
+      distance_type distance;
+      index = prepareInsert(hashOf(key), distance);
+      try {
+        ::new (static_cast<void*>(m_slots + index))
+            value_type(key, mapped_type{});
+      } catch (...) {
+        closeGap(index);
+        throw;
+      }
+      m_distances[index] = distance;
+      ++m_size;
+    }
+    return m_slots[index].second;
+  }
+
+  const mapped_type& valueOf(const key_type& key) const {
+    const size_type index = findIndex(key);
+    if (index == slotCount())
+      throw std::out_of_range("Element with given key does not exist");
+    return m_slots[index].second;
+  }
+
+  mapped_type& valueOf(const key_type& key) {
+    const size_type index = findIndex(key);
+    if (index == slotCount())
+      throw std::out_of_range("Element with given key does not exist");
+    return m_slots[index].second;
+  }
+
+  const_iterator find(const key_type& key) const {
+    return const_iterator(*this, findIndex(key));
+  }
+
+  iterator find(const key_type& key) {
+    return iterator(*this, findIndex(key));
+  }
+
+  void remove(const key_type& key) {
+    const size_type index = findIndex(key);
+    if (index == slotCount())
+      throw std::out_of_range("Element with given key does not exist");
+    eraseAt(index);
+  }
+
+  // Removes the element the iterator points to and returns an iterator to
+  // the following one. Backward shifting may move that element into the
+  // removed slot, but only ever from a higher index, so removal during
+  // iteration never skips or revisits an element.
+  iterator remove(const const_iterator& it) {
+    if (it.m_source != this || it.m_index >= slotCount())
+      throw std::out_of_range("Element with given key does not exist");
+    eraseAt(it.m_index);
+    return iterator(*this, nextFull(it.m_index));
+  }
+
+  size_type getSize() const { return m_size; }
+
+  size_type getCapacity() const { return m_capacity; }
+
+  size_type getMaxProbeLength() const { return m_maxProbeLength; }
+
+  // Makes room for `count` elements, so that inserting them does not trigger
+  // a rehash because of the load factor.
+  void reserve(size_type count) {
+    size_type capacity = ROBINHOODHASHMAP_MIN_CAPACITY;
+    while (count * 100 > capacity * ROBINHOODHASHMAP_MAX_LOAD_PERCENT)
+      capacity <<= 1;
+    if (capacity > m_capacity)
+      resize(capacity, probeLengthFor(capacity));
+  }
+
+  bool operator==(const RobinHoodHashMap& other) const {
+    if (this->getSize() != other.getSize())
+      return false;
+
+    for (const auto& elem : *this) {
+      const size_type index = other.findIndex(elem.first);
+      if (index == other.slotCount() ||
+          !(other.m_slots[index].second == elem.second))
+        return false;
+    }
+
+    return true;
+  }
+
+  bool operator!=(const RobinHoodHashMap& other) const {
+    return !(*this == other);
+  }
+
+  iterator begin() { return iterator(*this, nextFull(0)); }
+
+  iterator end() { return iterator(*this, slotCount()); }
+
+  const_iterator cbegin() const { return const_iterator(*this, nextFull(0)); }
+
+  const_iterator cend() const { return const_iterator(*this, slotCount()); }
+
+  const_iterator begin() const { return cbegin(); }
+
+  const_iterator end() const { return cend(); }
+};
+
+template <typename KeyType, typename ValueType>
+class RobinHoodHashMap<KeyType, ValueType>::ConstIterator {
+ public:
+  using reference = typename RobinHoodHashMap::const_reference;
+  using iterator_category = std::bidirectional_iterator_tag;
+  using value_type = typename RobinHoodHashMap::value_type;
+  using difference_type = std::ptrdiff_t;
+  using pointer = const typename RobinHoodHashMap::value_type*;
+  using size_type = typename RobinHoodHashMap::size_type;
+
+  friend class RobinHoodHashMap;
+
+ protected:
+  const RobinHoodHashMap* m_source;
+  size_type m_index;
+
+ public:
+  explicit ConstIterator(const RobinHoodHashMap& source, size_type index)
+      : m_source(&source), m_index(index) {}
+
+  ConstIterator& operator++() {
+    if (m_index >= m_source->slotCount())
+      throw std::out_of_range("Next iterator does not exist");
+
+    m_index = m_source->nextFull(m_index + 1);
+    return *this;
+  }
+
+  ConstIterator operator++(int) {
+    ConstIterator tmp(*this);
+    ++(*this);
+    return tmp;
+  }
+
+  ConstIterator& operator--() {
+    for (size_type i = m_index; i; --i) {
+      if (m_source->isFull(i - 1)) {
+        m_index = i - 1;
+        return *this;
+      }
+    }
+
+    throw std::out_of_range("Previous iterator does not exist");
+  }
+
+  ConstIterator operator--(int) {
+    ConstIterator tmp(*this);
+    --(*this);
+    return tmp;
+  }
+
+  reference operator*() const {
+    if (m_index >= m_source->slotCount())
+      throw std::out_of_range("Iterator does not have a value");
+    return m_source->m_slots[m_index];
+  }
+
+  pointer operator->() const { return &this->operator*(); }
+
+  bool operator==(const ConstIterator& other) const {
+    return m_source == other.m_source && m_index == other.m_index;
+  }
+
+  bool operator!=(const ConstIterator& other) const {
+    return !(*this == other);
+  }
+};
+
+template <typename KeyType, typename ValueType>
+class RobinHoodHashMap<KeyType, ValueType>::Iterator
+    : public RobinHoodHashMap<KeyType, ValueType>::ConstIterator {
+ public:
+  using reference = typename RobinHoodHashMap::reference;
+  using pointer = typename RobinHoodHashMap::value_type*;
+
+  explicit Iterator(const RobinHoodHashMap& source, size_type index)
+      : ConstIterator(source, index) {}
+
+  Iterator(const ConstIterator& other) : ConstIterator(other) {}
+
+  Iterator& operator++() {
+    ConstIterator::operator++();
+    return *this;
+  }
+
+  Iterator operator++(int) {
+    auto result = *this;
+    ConstIterator::operator++();
+    return result;
+  }
+
+  Iterator& operator--() {
+    ConstIterator::operator--();
+    return *this;
+  }
+
+  Iterator operator--(int) {
+    auto result = *this;
+    ConstIterator::operator--();
+    return result;
+  }
+
+  pointer operator->() const { return &this->operator*(); }
+
+  reference operator*() const {
+    // ugly cast, yet reduces code duplication.
+    return const_cast<reference>(ConstIterator::operator*());
+  }
+};
+
+}  // namespace aisdi
+
+#endif /* AISDI_MAPS_ROBINHOODHASHMAP_H */
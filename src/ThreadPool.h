@@ -0,0 +1,202 @@
+#ifndef AISDI_MAPS_THREADPOOL_H
+#define AISDI_MAPS_THREADPOOL_H
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#define THREADPOOL_TASKS_PER_THREAD 4
+
+namespace aisdi {
+
+// Fixed set of worker threads running the tasks of parallelFor() calls.
+//
+// Every worker has its own queue. Tasks are dealt round-robin to the queues,
+// a worker takes tasks from the back of its own queue and, once it runs dry,
+// steals from the front of the others, so that threads finishing their
+// share early take over the work of slower ones. The thread calling
+// parallelFor() runs tasks as well until its own ones are done, which keeps
+// nested calls from deadlocking.
+class ThreadPool {
+ private:
+  using task_type = std::function<void()>;
+
+  struct Queue {
+    std::mutex m_mutex;
+    std::deque<task_type> m_tasks;
+  };
+
+  // Completion state of the tasks of one parallelFor() call.
+  struct Batch {
+    std::atomic<std::size_t> m_remaining;
+    std::atomic<bool> m_failed{false};
+    std::exception_ptr m_error;
+    std::mutex m_mutex;
+    std::condition_variable m_done;
+
+    explicit Batch(std::size_t count) : m_remaining(count) {}
+  };
+
+  std::vector<std::unique_ptr<Queue>> m_queues;
+  std::vector<std::thread> m_workers;
+  // Guards sleeping and waking of idle workers, not the queues.
+  std::mutex m_mutex;
+  std::condition_variable m_wakeUp;
+  std::size_t m_queued = 0;
+  std::size_t m_nextQueue = 0;
+  bool m_stopping = false;
+
+  // Takes a task from the back of queue `own`, or steals one from the front
+  // of another queue.
+  bool tryPop(std::size_t own, task_type& task) {
+    const std::size_t count = m_queues.size();
+    for (std::size_t i = 0; i < count; ++i) {
+      Queue& queue = *m_queues[(own + i) % count];
+      std::lock_guard<std::mutex> lock(queue.m_mutex);
+      if (queue.m_tasks.empty())
+        continue;
+      if (!i) {
+        task = std::move(queue.m_tasks.back());
+        queue.m_tasks.pop_back();
+      } else {
+        task = std::move(queue.m_tasks.front());
+        queue.m_tasks.pop_front();
+      }
+      std::lock_guard<std::mutex> countLock(m_mutex);
+      --m_queued;
+      return true;
+    }
+    return false;
+  }
+
+  void work(std::size_t own) {
+    task_type task;
+    for (;;) {
+      if (tryPop(own, task)) {
+        task();
+        continue;
+      }
+      std::unique_lock<std::mutex> lock(m_mutex);
+      m_wakeUp.wait(lock, [this]() { return m_stopping || m_queued; });
+      if (m_stopping)
+        return;
+    }
+  }
+
+  void push(task_type task) {
+    std::size_t index;
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      index = m_nextQueue++ % m_queues.size();
+      ++m_queued;
+    }
+    {
+      Queue& queue = *m_queues[index];
+      std::lock_guard<std::mutex> lock(queue.m_mutex);
+      queue.m_tasks.push_back(std::move(task));
+    }
+    m_wakeUp.notify_one();
+  }
+
+  // Counts down under the batch's lock, so that the waiting thread cannot
+  // see the batch done and destroy it while it is still being notified.
+  static void finish(Batch& batch) {
+    std::lock_guard<std::mutex> lock(batch.m_mutex);
+    if (batch.m_remaining.fetch_sub(1) == 1)
+      batch.m_done.notify_all();
+  }
+
+ public:
+  // A pool of `threadCount` threads in total, counting the thread that calls
+  // parallelFor(), so one fewer worker is started.
+  explicit ThreadPool(std::size_t threadCount) {
+    const std::size_t workers = std::max<std::size_t>(threadCount, 1) - 1;
+    m_queues.reserve(std::max<std::size_t>(workers, 1));
+    for (std::size_t i = 0; i < std::max<std::size_t>(workers, 1); ++i)
+      m_queues.emplace_back(new Queue());
+    m_workers.reserve(workers);
+    for (std::size_t i = 0; i < workers; ++i)
+      m_workers.emplace_back(&ThreadPool::work, this, i);
+  }
+
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+
+  ~ThreadPool() {
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_stopping = true;
+    }
+    m_wakeUp.notify_all();
+    for (std::thread& worker : m_workers)
+      worker.join();
+  }
+
+  // Pool with a thread for every hardware thread, created on first use.
+  static ThreadPool& global() {
+    static ThreadPool pool(std::max(1u, std::thread::hardware_concurrency()));
+    return pool;
+  }
+
+  std::size_t getThreadCount() const { return m_workers.size() + 1; }
+
+  // Runs `function(i)` for every i in [0, count), spread over the pool, and
+  // returns once all of them have finished. If some calls throw, the
+  // remaining ones are skipped and the first exception is rethrown.
+  template <typename Function>
+  void parallelFor(std::size_t count, const Function& function) {
+    if (count == 1 || m_workers.empty()) {
+      for (std::size_t i = 0; i < count; ++i)
+        function(i);
+      return;
+    }
+
+    Batch batch(count);
+    for (std::size_t i = 0; i < count; ++i) {
+      push([&batch, &function, i]() {
+        if (!batch.m_failed.load(std::memory_order_relaxed)) {
+          try {
+            function(i);
+          } catch (...) {
+            if (!batch.m_failed.exchange(true))
+              batch.m_error = std::current_exception();
+          }
+        }
+        finish(batch);
+      });
+    }
+
+    // Helps with any queued task, not only those of this batch, since a
+    // task of this batch may be waiting for another batch to finish.
+    task_type task;
+    while (batch.m_remaining.load()) {
+      if (tryPop(0, task)) {
+        task();
+        continue;
+      }
+      std::unique_lock<std::mutex> lock(batch.m_mutex);
+      batch.m_done.wait(lock, [&batch]() { return !batch.m_remaining; });
+    }
+    // Waits for the last finish() to let go of the batch.
+    std::lock_guard<std::mutex> lock(batch.m_mutex);
+    if (batch.m_error)
+      std::rethrow_exception(batch.m_error);
+  }
+
+  // Number of tasks to split a job into: a few per thread, so that stealing
+  // can even out chunks of unequal cost.
+  std::size_t getTaskCount() const {
+    return getThreadCount() * THREADPOOL_TASKS_PER_THREAD;
+  }
+};
+}  // namespace aisdi
+
+#endif /* AISDI_MAPS_THREADPOOL_H */
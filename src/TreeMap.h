@@ -6,6 +6,9 @@
 #include <initializer_list>
 #include <stdexcept>
 #include <utility>
+#include <vector>
+
+#include "RedBlackTree.h"
 
 namespace aisdi {
 
@@ -59,89 +62,7 @@ class TreeMap {
  private:
   // Methods
 
-  void leftRotate(Node* x) {
-    Node* y = x->m_right;
-    x->m_right = y->m_left;
-
-    if (y->m_left != m_nil)
-      y->m_left->m_p = x;
-
-    y->m_p = x->m_p;
-
-    if (x->m_p == m_nil) {
-      m_root = y;
-      m_nil->m_left = m_root;
-      m_nil->m_right = m_root;
-    } else if (x == x->m_p->m_left)
-      x->m_p->m_left = y;
-    else
-      x->m_p->m_right = y;
-    y->m_left = x;
-    x->m_p = y;
-  }
-
-  void rightRotate(Node* x) {
-    Node* y = x->m_left;
-    x->m_left = y->m_right;
-
-    if (y->m_right != m_nil)
-      y->m_right->m_p = x;
-
-    y->m_p = x->m_p;
-
-    if (x->m_p == m_nil) {
-      m_root = y;
-      m_nil->m_left = m_root;
-      m_nil->m_right = m_root;
-    } else if (x == x->m_p->m_right)
-      x->m_p->m_right = y;
-    else
-      x->m_p->m_left = y;
-    y->m_right = x;
-    x->m_p = y;
-  }
-
-  void insertFixup(Node* z) {
-    Node* y;
-
-    while (z->m_p->m_color) {
-      if (z->m_p == z->m_p->m_p->m_left) {
-        y = z->m_p->m_p->m_right;
-        if (y->m_color) {
-          z->m_p->m_color = Node::Color::BLACK;
-          y->m_color = Node::Color::BLACK;
-          z->m_p->m_p->m_color = Node::Color::RED;
-          z = z->m_p->m_p;
-        } else {
-          if (z == z->m_p->m_right) {
-            z = z->m_p;
-            leftRotate(z);
-          }
-          z->m_p->m_color = Node::Color::BLACK;
-          z->m_p->m_p->m_color = Node::Color::RED;
-          rightRotate(z->m_p->m_p);
-        }
-      } else {
-        y = z->m_p->m_p->m_left;
-        if (y->m_color) {
-          z->m_p->m_color = Node::Color::BLACK;
-          y->m_color = Node::Color::BLACK;
-          z->m_p->m_p->m_color = Node::Color::RED;
-          z = z->m_p->m_p;
-        } else {
-          if (z == z->m_p->m_left) {
-            z = z->m_p;
-            rightRotate(z);
-          }
-          z->m_p->m_color = Node::Color::BLACK;
-          z->m_p->m_p->m_color = Node::Color::RED;
-          leftRotate(z->m_p->m_p);
-        }
-      }
-    }
-
-    m_root->m_color = Node::Color::BLACK;
-  }
+  RedBlackTree<Node> tree() { return RedBlackTree<Node>(m_root, m_nil); }
 
   Node* search(key_type key) const {
     Node* ptr = m_root;
@@ -164,135 +85,17 @@ class TreeMap {
       else
         x = x->m_right;
     }
-    z->m_p = y;
-
-    if (y == m_nil) {
-      m_root = z;
-      m_nil->m_left = m_root;
-      m_nil->m_right = m_root;
-    } else if (z->m_value.first < static_cast<ValueNode*>(y)->m_value.first)
-      y->m_left = z;
-    else
-      y->m_right = z;
-
-    z->m_left = m_nil;
-    z->m_right = m_nil;
-    z->m_color = Node::Color::RED;
-
+    tree().link(y,
+                y != m_nil && z->m_value.first <
+                                  static_cast<ValueNode*>(y)->m_value.first,
+                z);
     m_size++;
-    insertFixup(z);
-  }
-
-  void transplant(Node* u, Node* v) {
-    if (u->m_p == m_nil) {
-      m_root = v;
-      m_nil->m_left = m_root;
-      m_nil->m_right = m_root;
-    } else if (u == u->m_p->m_left)
-      u->m_p->m_left = v;
-    else
-      u->m_p->m_right = v;
-    v->m_p = u->m_p;
-  }
-
-  void deleteFixup(Node* x) {
-    Node* w;
-    while (x != m_root && x->m_color == Node::Color::BLACK) {
-      if (x == x->m_p->m_left) {
-        w = x->m_p->m_right;
-        if (w->m_color) {
-          w->m_color = Node::Color::BLACK;
-          x->m_p->m_color = Node::Color::RED;
-          leftRotate(x->m_p);
-          w = x->m_p->m_right;
-        }
-        if (w->m_left->m_color == Node::Color::BLACK &&
-            w->m_right->m_color == Node::Color::BLACK) {
-          w->m_color = Node::Color::RED;
-          x = x->m_p;
-        } else {
-          if (w->m_right->m_color == Node::Color::BLACK) {
-            w->m_left->m_color = Node::Color::BLACK;
-            w->m_color = Node::Color::RED;
-            rightRotate(w);
-            w = x->m_p->m_right;
-          }
-          w->m_color = x->m_p->m_color;
-          x->m_p->m_color = Node::Color::BLACK;
-          w->m_right->m_color = Node::Color::BLACK;
-          leftRotate(x->m_p);
-          x = m_root;
-        }
-      } else {
-        w = x->m_p->m_left;
-        if (w->m_color) {
-          w->m_color = Node::Color::BLACK;
-          x->m_p->m_color = Node::Color::RED;
-          rightRotate(x->m_p);
-          w = x->m_p->m_left;
-        }
-        if (w->m_right->m_color == Node::Color::BLACK &&
-            w->m_left->m_color == Node::Color::BLACK) {
-          w->m_color = Node::Color::RED;
-          x = x->m_p;
-        } else {
-          if (w->m_left->m_color == Node::Color::BLACK) {
-            w->m_right->m_color = Node::Color::BLACK;
-            w->m_color = Node::Color::RED;
-            leftRotate(w);
-            w = x->m_p->m_left;
-          }
-          w->m_color = x->m_p->m_color;
-          x->m_p->m_color = Node::Color::BLACK;
-          w->m_left->m_color = Node::Color::BLACK;
-          rightRotate(x->m_p);
-          x = m_root;
-        }
-      }
-    }
-
-    x->m_color = Node::Color::BLACK;
   }
 
   void remove(Node* z) {
-    Node* org = z;
-    Node* x;
-    Node* y = z;
-    auto yOriginalColor = y->m_color;
-
-    if (z->m_left == m_nil) {
-      x = z->m_right;
-      transplant(z, z->m_right);
-    } else if (z->m_right == m_nil) {
-      x = z->m_left;
-      transplant(z, z->m_left);
-    } else {
-      y = z->m_right;
-
-      while (y->m_left != m_nil)
-        y = y->m_left;
-
-      yOriginalColor = y->m_color;
-      x = y->m_right;
-
-      if (y->m_p == z)
-        x->m_p = y;
-      else {
-        transplant(y, y->m_right);
-        y->m_right = z->m_right;
-        y->m_right->m_p = y;
-      }
-
-      transplant(z, y);
-      y->m_left = z->m_left;
-      y->m_left->m_p = y;
-      y->m_color = z->m_color;
-    }
-
+    tree().unlink(z);
     m_size--;
-    if (yOriginalColor == Node::Color::BLACK)
-      deleteFixup(x);
-    delete org;
+    delete z;
   }
 
   void clear() {
@@ -300,6 +103,12 @@ class TreeMap {
       remove(m_root);
   }
 
+  // Replaces the empty tree with one built from sorted nodes in linear time.
+  void buildFromSorted(const std::vector<ValueNode*>& nodes) {
+    tree().buildFromSorted(nodes.begin(), nodes.end());
+    m_size = nodes.size();
+  }
+
  public:
   TreeMap() {
     m_nil = new Node();
@@ -319,6 +128,11 @@ class TreeMap {
     }
   }
 
+  template <typename InputIt>
+  TreeMap(InputIt first, InputIt last) : TreeMap() {
+    insert(first, last);
+  }
+
   TreeMap(const TreeMap& other) : TreeMap() {
     for (auto i = other.begin(); i != other.end(); ++i) {
       ValueNode* x = new ValueNode(i->first, i->second);
@@ -363,6 +177,40 @@ class TreeMap {
 
   bool isEmpty() const { return !m_size; }
 
+  // Inserts every pair of [first, last), later pairs overwriting values of
+  // earlier ones with the same key. While the map is empty and the input is
+  // sorted, nodes are collected and linked into a balanced tree in linear
+  // time; input after the first key out of order is inserted one by one.
+  template <typename InputIt>
+  void insert(InputIt first, InputIt last) {
+    if (!m_size) {
+      std::vector<ValueNode*> nodes;
+      try {
+        for (; first != last; ++first) {
+          if (!nodes.empty()) {
+            ValueNode* previous = nodes.back();
+            if (first->first < previous->m_value.first)
+              break;
+            if (!(previous->m_value.first < first->first)) {
+              previous->m_value.second = first->second;
+              continue;
+            }
+          }
+          nodes.push_back(nullptr);
+          nodes.back() = new ValueNode(first->first, first->second);
+        }
+      } catch (...) {
+        for (ValueNode* node : nodes)
+          delete node;
+        throw;
+      }
+      buildFromSorted(nodes);
+    }
+
+    for (; first != last; ++first)
+      (*this)[first->first] = first->second;
+  }
+
   mapped_type& operator[](const key_type& key) {
     Node* ptr = search(key);
     if (ptr == m_nil) {
@@ -1,14 +1,537 @@
+#include <algorithm>
+#include <atomic>
 #include <chrono>
 #include <cstddef>
+#include <cstdint>
+#include <cstdio>
 #include <cstdlib>
+#include <functional>
 #include <iostream>
+#include <iterator>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
+#include <utility>
+#include <vector>
 
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "BloomFilteredMap.h"
+#include "ConcurrentHashMap.h"
+#include "CowHashMap.h"
+#include "DenseHashMap.h"
+#include "FlatHashMap.h"
+#include "FrozenHashMap.h"
 #include "HashMap.h"
+#include "LockFreeHashMap.h"
+#include "MappedHashMap.h"
+#include "RobinHoodHashMap.h"
+#include "ThreadPool.h"
 #include "TreeMap.h"
 
 namespace {
 
+template <typename Function>
+long long measure(Function function) {
+  std::chrono::high_resolution_clock::time_point t1 =
+      std::chrono::high_resolution_clock::now();
+  function();
+  std::chrono::high_resolution_clock::time_point t2 =
+      std::chrono::high_resolution_clock::now();
+  return std::chrono::duration_cast<std::chrono::microseconds>(t2 - t1)
+      .count();
+}
+
+// Runs the same insert/lookup/iterate/remove workload on any map type with
+// the HashMap interface, so that bucket layouts can be compared.
+template <typename Map>
+void benchmarkHashMap(const std::string& name, std::size_t size) {
+  Map map;
+  long long checksum = 0;
+
+  const auto insertTime = measure([&]() {
+    for (std::size_t i = 0; i < size; ++i)
+      map[i] = i;
+  });
+  const auto hitTime = measure([&]() {
+    for (std::size_t i = 0; i < size; ++i)
+      checksum += map.valueOf(i);
+  });
+  const auto missTime = measure([&]() {
+    for (std::size_t i = size; i < 2 * size; ++i)
+      checksum += map.find(i) == map.end();
+  });
+  const auto iterateTime = measure([&]() {
+    for (auto it = map.cbegin(); it != map.cend(); ++it)
+      checksum += it->second;
+  });
+  const auto removeTime = measure([&]() {
+    for (std::size_t i = 0; i < size; ++i)
+      map.remove(i);
+  });
+
+  std::cout << name << " insert: " << insertTime << std::endl;
+  std::cout << name << " find hit: " << hitTime << std::endl;
+  std::cout << name << " find miss: " << missTime << std::endl;
+  std::cout << name << " iterate: " << iterateTime << std::endl;
+  std::cout << name << " remove: " << removeTime << std::endl;
+  std::cout << name << " checksum: " << checksum << std::endl;
+}
+
+// Multiplicative hash for integer IDs. std::hash<int> is the identity, so IDs
+// allocated with a power-of-two stride all land in a handful of buckets.
+struct IdHash {
+  std::size_t operator()(int key) const {
+    const std::uint64_t h =
+        static_cast<std::uint64_t>(key) * 0x9e3779b97f4a7c15ULL;
+    return static_cast<std::size_t>(h ^ (h >> 32));
+  }
+};
+
+template <typename Map>
+void benchmarkStridedIds(const std::string& name,
+                         std::size_t size,
+                         std::size_t stride) {
+  Map map;
+  for (std::size_t i = 0; i < size; ++i)
+    map[i * stride] = i;
+
+  long long checksum = 0;
+  const auto lookupTime = measure([&]() {
+    for (std::size_t i = 0; i < size; ++i)
+      checksum += map.valueOf(i * stride);
+  });
+
+  std::cout << name << " strided lookup: " << lookupTime << std::endl;
+  std::cout << name << " checksum: " << checksum << std::endl;
+}
+
+// Returns `count` distinct strings whose std::hash values agree in the low
+// `bits` bits, so that they share one bucket of any table with up to 2^bits
+// buckets: the key set an attacker who knows the hash function can send.
+std::vector<std::string> collidingStrings(std::size_t count, unsigned bits) {
+  const std::size_t mask = (std::size_t(1) << bits) - 1;
+  const std::size_t target = std::hash<std::string>()("key") & mask;
+  std::vector<std::string> keys;
+  for (std::size_t i = 0; keys.size() < count; ++i) {
+    std::string key = "key" + std::to_string(i);
+    if ((std::hash<std::string>()(key) & mask) == target)
+      keys.push_back(std::move(key));
+  }
+  return keys;
+}
+
+template <typename Map>
+void benchmarkStringKeys(const std::string& name,
+                         const std::vector<std::string>& keys) {
+  Map map;
+  for (std::size_t i = 0; i < keys.size(); ++i)
+    map[keys[i]] = i;
+
+  long long checksum = 0;
+  const auto lookupTime = measure([&]() {
+    for (const std::string& key : keys)
+      checksum += map.valueOf(key);
+  });
+
+  std::cout << name << " string lookup: " << lookupTime << std::endl;
+  std::cout << name << " checksum: " << checksum << std::endl;
+}
+
+// Looks up `lookups` random keys of a map with `size` elements, once with
+// valueOf() and once with valueOfBatch(). The gain shows once the table is
+// larger than the last-level cache.
+void benchmarkBatchLookup(std::size_t size, std::size_t lookups) {
+  aisdi::HashMap<int, long long> map;
+  map.reserve(size);
+  for (std::size_t i = 0; i < size; ++i)
+    map[i] = i;
+
+  std::vector<int> keys(lookups);
+  std::uint64_t state = 1;
+  for (auto& key : keys) {
+    state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+    key = static_cast<int>((state >> 33) % size);
+  }
+
+  long long checksum = 0;
+  const auto singleTime = measure([&]() {
+    for (int key : keys)
+      checksum += map.valueOf(key);
+  });
+  std::vector<long long> values;
+  values.reserve(lookups);
+  const auto batchTime = measure([&]() {
+    map.valueOfBatch(keys.data(), keys.size(), std::back_inserter(values));
+  });
+  for (long long value : values)
+    checksum -= value;
+
+  std::cout << "Hashmap " << size << " items single lookup: " << singleTime
+            << std::endl;
+  std::cout << "Hashmap " << size << " items batch lookup: " << batchTime
+            << std::endl;
+  std::cout << "Hashmap batch checksum: " << checksum << std::endl;
+}
+
+// Loads `size` sorted pairs, the way a snapshot is loaded at startup, once
+// one by one and once through the range constructor.
+template <typename Map>
+void benchmarkBulkLoad(const std::string& name, std::size_t size) {
+  std::vector<std::pair<int, long long>> items;
+  items.reserve(size);
+  for (std::size_t i = 0; i < size; ++i)
+    items.emplace_back(i, i);
+
+  long long checksum = 0;
+  const auto singleTime = measure([&]() {
+    Map map;
+    for (const auto& item : items)
+      map[item.first] = item.second;
+    checksum += map.getSize();
+  });
+  const auto rangeTime = measure([&]() {
+    Map map(items.begin(), items.end());
+    checksum -= map.getSize();
+  });
+
+  std::cout << name << " load one by one: " << singleTime << std::endl;
+  std::cout << name << " load range: " << rangeTime << std::endl;
+  std::cout << name << " load checksum: " << checksum << std::endl;
+}
+
+// Inserts `size` keys one by one and reports the slowest single insertion,
+// which is dominated by the rehash of the whole table unless the map rehashes
+// incrementally.
+void benchmarkInsertLatency(std::size_t size, bool incremental) {
+  aisdi::HashMap<int, long long> map;
+  map.setIncrementalRehash(incremental);
+
+  long long worst = 0;
+  const auto totalTime = measure([&]() {
+    for (std::size_t i = 0; i < size; ++i)
+      worst = std::max(worst, measure([&]() { map[i] = i; }));
+  });
+
+  const std::string name =
+      incremental ? "Hashmap incremental rehash" : "Hashmap rehash";
+  std::cout << name << " worst insert: " << worst << std::endl;
+  std::cout << name << " all inserts: " << totalTime << std::endl;
+}
+
+// Takes a copy of a map with `size` elements and changes a few of them, once
+// with a deep HashMap copy and once with a CowHashMap snapshot.
+void benchmarkSnapshot(std::size_t size) {
+  aisdi::HashMap<int, long long> map;
+  aisdi::CowHashMap<int, long long> cowMap;
+  for (std::size_t i = 0; i < size; ++i) {
+    map[i] = i;
+    cowMap.insertOrAssign(i, i);
+  }
+
+  long long checksum = 0;
+  const auto copyTime = measure([&]() {
+    const aisdi::HashMap<int, long long> copy(map);
+    for (std::size_t i = 0; i < 100; ++i)
+      map[i * 7] = -1;
+    checksum += copy.valueOf(7);
+  });
+  const auto snapshotTime = measure([&]() {
+    const auto snapshot = cowMap.snapshot();
+    for (std::size_t i = 0; i < 100; ++i)
+      cowMap.insertOrAssign(i * 7, -1);
+    checksum -= snapshot.valueOf(7);
+  });
+
+  std::cout << "Hashmap copy and write: " << copyTime << std::endl;
+  std::cout << "CowHashmap snapshot and write: " << snapshotTime << std::endl;
+  std::cout << "Snapshot checksum: " << checksum << std::endl;
+}
+
+// Creates, fills with 0 to 5 elements and destroys `count` maps, once
+// starting without a table and once with a table allocated up front.
+void benchmarkTinyMaps(std::size_t count) {
+  long long checksum = 0;
+  auto fill = [&checksum, count](std::size_t bucketCount) {
+    return measure([&]() {
+      for (std::size_t i = 0; i < count; ++i) {
+        aisdi::HashMap<int, long long> map(bucketCount);
+        for (std::size_t j = 0; j < i % 6; ++j)
+          map[j] = j;
+        checksum += map.getSize();
+      }
+    });
+  };
+
+  std::cout << "Hashmap tiny maps: " << fill(0) << std::endl;
+  std::cout << "Hashmap tiny maps with table: "
+            << fill(HASHMAP_MIN_BUCKET_COUNT) << std::endl;
+  std::cout << "Tiny maps checksum: " << checksum << std::endl;
+}
+
+// Looks up `size` keys in a map of `size` elements, nine in ten of them
+// absent, with and without a Bloom filter in front of the map.
+template <typename Map>
+void benchmarkMostlyMisses(const std::string& name, std::size_t size) {
+  Map map;
+  aisdi::BloomFilteredMap<Map> filtered;
+  for (std::size_t i = 0; i < size; ++i) {
+    map[i * 10] = i;
+    filtered[i * 10] = i;
+  }
+
+  long long checksum = 0;
+  const auto plainTime = measure([&]() {
+    for (std::size_t i = 0; i < size; ++i)
+      checksum += map.find(i) != map.end();
+  });
+  const auto filteredTime = measure([&]() {
+    for (std::size_t i = 0; i < size; ++i)
+      checksum += filtered.contains(i);
+  });
+
+  const auto stats = filtered.getFilterStats();
+  std::cout << name << " mostly misses: " << plainTime << std::endl;
+  std::cout << name << " mostly misses filtered: " << filteredTime
+            << std::endl;
+  std::cout << name << " filter rejected " << stats.m_rejected << ", found "
+            << stats.m_found << ", false positives " << stats.m_missed
+            << std::endl;
+  std::cout << name << " misses checksum: " << checksum << std::endl;
+}
+
+// Compares getting a map of `size` elements ready by inserting them all
+// again with opening an image of it, and then looking every key up in both.
+void benchmarkMappedImage(std::size_t size) {
+  using Map = aisdi::HashMap<std::int64_t, std::int64_t>;
+  using Mapped = aisdi::MappedHashMap<std::int64_t, std::int64_t>;
+  char path[] = "/tmp/aisdiMapsImageXXXXXX";
+  const int fd = mkstemp(path);
+  if (fd < 0)
+    return;
+  close(fd);
+
+  Map map;
+  const auto rebuildTime = measure([&]() {
+    for (std::size_t i = 0; i < size; ++i)
+      map[i * 7] = i;
+  });
+  const auto writeTime = measure([&]() { Mapped::writeImage(map, path); });
+
+  long long checksum = 0;
+  const auto openTime = measure([&]() {
+    const Mapped mapped(path);
+    checksum += mapped.getSize();
+  });
+  const Mapped mapped(path);
+  const auto mapLookupTime = measure([&]() {
+    for (std::size_t i = 0; i < size; ++i)
+      checksum += map.valueOf(i * 7);
+  });
+  const auto mappedLookupTime = measure([&]() {
+    for (std::size_t i = 0; i < size; ++i)
+      checksum += mapped.valueOf(i * 7);
+  });
+  std::remove(path);
+
+  std::cout << "Hashmap rebuild: " << rebuildTime << std::endl;
+  std::cout << "Hashmap write image: " << writeTime << std::endl;
+  std::cout << "MappedHashmap open: " << openTime << std::endl;
+  std::cout << "Hashmap lookup: " << mapLookupTime << std::endl;
+  std::cout << "MappedHashmap lookup: " << mappedLookupTime << std::endl;
+  std::cout << "Image checksum: " << checksum << std::endl;
+}
+
+// Allocator that adds the bytes it hands out to a shared counter.
+template <typename T>
+struct CountingAllocator {
+  using value_type = T;
+
+  explicit CountingAllocator(std::size_t* bytes) : m_bytes(bytes) {}
+
+  template <typename U>
+  CountingAllocator(const CountingAllocator<U>& other)
+      : m_bytes(other.m_bytes) {}
+
+  T* allocate(std::size_t count) {
+    *m_bytes += count * sizeof(T);
+    return std::allocator<T>().allocate(count);
+  }
+
+  void deallocate(T* pointer, std::size_t count) {
+    *m_bytes -= count * sizeof(T);
+    std::allocator<T>().deallocate(pointer, count);
+  }
+
+  template <typename U>
+  bool operator==(const CountingAllocator<U>& other) const {
+    return m_bytes == other.m_bytes;
+  }
+
+  template <typename U>
+  bool operator!=(const CountingAllocator<U>& other) const {
+    return m_bytes != other.m_bytes;
+  }
+
+  std::size_t* m_bytes;
+};
+
+// Compares lookups of every key, in scattered order, in a map of `size`
+// elements and in its frozen copy, and the memory both of them take.
+void benchmarkFrozen(std::size_t size) {
+  using Allocator = CountingAllocator<std::pair<const int, long long>>;
+  using Map = aisdi::HashMap<int, long long, aisdi::KeyedHash<int>,
+                             std::equal_to<int>, Allocator>;
+  std::size_t mapBytes = 0;
+  Map map(0, aisdi::KeyedHash<int>(), std::equal_to<int>(),
+          Allocator(&mapBytes));
+  for (std::size_t i = 0; i < size; ++i)
+    map[i] = i;
+
+  long long checksum = 0;
+  aisdi::FrozenHashMap<int, long long> frozen;
+  const auto freezeTime = measure([&]() { frozen = map.freeze(); });
+  const auto mapLookupTime = measure([&]() {
+    for (std::size_t i = 0; i < size; ++i)
+      checksum += map.valueOf(i * 7919 % size);
+  });
+  const auto frozenLookupTime = measure([&]() {
+    for (std::size_t i = 0; i < size; ++i)
+      checksum += frozen.valueOf(i * 7919 % size);
+  });
+  const auto frozenMissTime = measure([&]() {
+    for (std::size_t i = size; i < 2 * size; ++i)
+      checksum += frozen.contains(i);
+  });
+
+  std::cout << "Hashmap freeze: " << freezeTime << std::endl;
+  std::cout << "Hashmap scattered lookup: " << mapLookupTime << std::endl;
+  std::cout << "FrozenHashmap scattered lookup: " << frozenLookupTime
+            << std::endl;
+  std::cout << "FrozenHashmap miss: " << frozenMissTime << std::endl;
+  std::cout << "Hashmap bytes per key: "
+            << static_cast<double>(mapBytes) / size << std::endl;
+  std::cout << "FrozenHashmap bytes per key: "
+            << static_cast<double>(frozen.getMemoryUsage()) / size
+            << std::endl;
+  std::cout << "Frozen checksum: " << checksum << std::endl;
+}
+
+// Compares two copies of a map with `size` elements, sequentially and in
+// parallel, and then a copy that differs by one key, which the fingerprint
+// rejects without looking at any element.
+void benchmarkEquality(std::size_t size) {
+  aisdi::HashMap<int, long long> map;
+  for (std::size_t i = 0; i < size; ++i)
+    map[i] = i;
+  aisdi::HashMap<int, long long> copy(map);
+  aisdi::HashMap<int, long long> changed(map);
+  changed.remove(0);
+  changed[size] = 0;
+
+  int equal = 0;
+  const auto sequentialTime = measure([&]() { equal += map == copy; });
+  const auto parallelTime =
+      measure([&]() { equal += map.parallelEquals(copy); });
+  const auto rejectTime = measure([&]() { equal += map == changed; });
+
+  std::cout << "Hashmap equal: " << sequentialTime << std::endl;
+  std::cout << "Hashmap parallel equal: " << parallelTime << std::endl;
+  std::cout << "Hashmap different keys: " << rejectTime << std::endl;
+  std::cout << "Equal maps: " << equal << std::endl;
+}
+
+// Sums the values of a map with `size` elements with a plain loop, then with
+// parallelReduce() on pools of 1, 2, 4... up to `maxThreads` threads.
+void benchmarkParallelReduce(std::size_t size, unsigned maxThreads) {
+  aisdi::HashMap<int, long long> map;
+  for (std::size_t i = 0; i < size; ++i)
+    map[i] = i;
+
+  long long checksum = 0;
+  const auto loopTime = measure([&]() {
+    for (const auto& item : map)
+      checksum += item.second;
+  });
+  std::cout << "Hashmap sum loop: " << loopTime << std::endl;
+
+  for (unsigned threads = 1; threads <= maxThreads; threads *= 2) {
+    aisdi::ThreadPool pool(threads);
+    const auto reduceTime = measure([&]() {
+      checksum -= map.parallelReduce(
+          0LL, [](const std::pair<const int, long long>& item) {
+            return item.second;
+          }, std::plus<long long>(), pool);
+    });
+    std::cout << "Hashmap parallel sum " << threads
+              << " threads: " << reduceTime << std::endl;
+  }
+  std::cout << "Sum checksum: " << checksum << std::endl;
+}
+
+// HashMap behind a single mutex, the baseline for the concurrent maps.
+template <typename Key, typename Value>
+class LockedHashMap {
+ public:
+  bool insertOrAssign(const Key& key, const Value& value) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_map.insertOrAssign(key, value).second;
+  }
+
+  bool tryGet(const Key& key, Value& value) const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_map.find(key);
+    if (it == m_map.end())
+      return false;
+    value = it->second;
+    return true;
+  }
+
+ private:
+  mutable std::mutex m_mutex;
+  aisdi::HashMap<Key, Value> m_map;
+};
+
+// Each thread performs `size` random lookups and updates of keys below
+// `size`, `writePercent` percent of them updates.
+template <typename Map>
+void benchmarkConcurrentMap(const std::string& name,
+                            std::size_t size,
+                            unsigned threadCount,
+                            unsigned writePercent) {
+  Map map;
+  for (std::size_t i = 0; i < size; ++i)
+    map.insertOrAssign(i, i);
+
+  std::atomic<long long> checksum(0);
+  const auto time = measure([&]() {
+    std::vector<std::thread> threads;
+    for (unsigned t = 0; t < threadCount; ++t) {
+      threads.emplace_back([&map, &checksum, size, writePercent, t]() {
+        long long sum = 0;
+        std::uint64_t state = t;
+        for (std::size_t i = 0; i < size; ++i) {
+          state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+          const int key = static_cast<int>((state >> 33) % size);
+          long long value;
+          if (i % 100 < writePercent)
+            map.insertOrAssign(key, i);
+          else if (map.tryGet(key, value))
+            sum += value;
+        }
+        checksum += sum;
+      });
+    }
+    for (auto& thread : threads)
+      thread.join();
+  });
+
+  std::cout << name << " " << threadCount << " threads, " << writePercent
+            << "% writes: " << time << std::endl;
+}
+
 void perfomTest(size_t size) {
   aisdi::TreeMap<int, std::string> tmap;
   aisdi::HashMap<int, std::string> hmap;
@@ -77,5 +600,67 @@ void perfomTest(size_t size) {
 int main(int argc, char** argv) {
   const std::size_t mapSize = argc > 1 ? std::atoll(argv[1]) : 10000;
   perfomTest(mapSize);
+  benchmarkHashMap<aisdi::HashMap<int, long long>>("Hashmap", mapSize);
+  benchmarkHashMap<aisdi::FlatHashMap<int, long long>>("FlatHashmap", mapSize);
+  benchmarkHashMap<aisdi::RobinHoodHashMap<int, long long>>("RobinHoodHashmap",
+                                                            mapSize);
+  benchmarkHashMap<aisdi::DenseHashMap<int, long long>>("DenseHashmap",
+                                                        mapSize);
+  benchmarkStridedIds<aisdi::HashMap<int, long long, std::hash<int>>>(
+      "Hashmap std::hash", mapSize / 100, 1024);
+  benchmarkStridedIds<aisdi::HashMap<int, long long, IdHash>>(
+      "Hashmap IdHash", mapSize / 100, 1024);
+  benchmarkStridedIds<aisdi::HashMap<int, long long>>("Hashmap KeyedHash",
+                                                      mapSize / 100, 1024);
+  benchmarkStridedIds<aisdi::HashMap<int, long long, std::hash<int>>>(
+      "Hashmap std::hash stride 8192", mapSize / 10, 8192);
+  benchmarkStridedIds<aisdi::HashMap<int, long long>>(
+      "Hashmap KeyedHash stride 1", mapSize / 10, 1);
+  benchmarkStridedIds<aisdi::HashMap<int, long long>>(
+      "Hashmap KeyedHash stride 8192", mapSize / 10, 8192);
+
+  unsigned tableBits = 0;
+  while ((std::size_t(1) << tableBits) < 2 * mapSize / 10)
+    ++tableBits;
+  const auto randomKeys = collidingStrings(mapSize / 10, 0);
+  const auto collidingKeys = collidingStrings(mapSize / 10, tableBits);
+  benchmarkStringKeys<
+      aisdi::HashMap<std::string, long long, std::hash<std::string>>>(
+      "Hashmap std::hash random", randomKeys);
+  benchmarkStringKeys<
+      aisdi::HashMap<std::string, long long, std::hash<std::string>>>(
+      "Hashmap std::hash colliding", collidingKeys);
+  benchmarkStringKeys<aisdi::HashMap<std::string, long long>>(
+      "Hashmap KeyedHash random", randomKeys);
+  benchmarkStringKeys<aisdi::HashMap<std::string, long long>>(
+      "Hashmap KeyedHash colliding", collidingKeys);
+
+  benchmarkBatchLookup(mapSize * 100, mapSize * 10);
+  benchmarkBulkLoad<aisdi::HashMap<int, long long>>("Hashmap", mapSize * 100);
+  benchmarkBulkLoad<aisdi::TreeMap<int, long long>>("Treemap", mapSize * 10);
+  benchmarkInsertLatency(mapSize * 100, false);
+  benchmarkInsertLatency(mapSize * 100, true);
+  benchmarkSnapshot(mapSize * 100);
+  benchmarkEquality(mapSize * 100);
+  benchmarkTinyMaps(mapSize * 100);
+  benchmarkMostlyMisses<aisdi::HashMap<int, long long>>("Hashmap",
+                                                        mapSize * 100);
+  benchmarkMappedImage(mapSize * 100);
+  benchmarkFrozen(mapSize * 100);
+  benchmarkMostlyMisses<aisdi::TreeMap<int, long long>>("Treemap",
+                                                        mapSize * 100);
+
+  const unsigned threads = std::max(4u, std::thread::hardware_concurrency());
+  benchmarkParallelReduce(mapSize * 100, threads);
+  benchmarkConcurrentMap<LockedHashMap<int, long long>>("Locked Hashmap",
+                                                        mapSize, threads, 10);
+  benchmarkConcurrentMap<aisdi::ConcurrentHashMap<int, long long>>(
+      "ConcurrentHashmap", mapSize, threads, 10);
+  benchmarkConcurrentMap<LockedHashMap<int, long long>>("Locked Hashmap",
+                                                        mapSize, threads, 1);
+  benchmarkConcurrentMap<aisdi::ConcurrentHashMap<int, long long>>(
+      "ConcurrentHashmap", mapSize, threads, 1);
+  benchmarkConcurrentMap<aisdi::LockFreeHashMap<int, long long>>(
+      "LockFreeHashmap", mapSize, threads, 1);
   return 0;
 }
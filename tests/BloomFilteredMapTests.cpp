@@ -0,0 +1,236 @@
+#include <BloomFilter.h>
+#include <BloomFilteredMap.h>
+#include <DenseHashMap.h>
+#include <HashMap.h>
+#include <TreeMap.h>
+
+#include <cctype>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <stdexcept>
+#include <string>
+
+#include <boost/test/unit_test.hpp>
+
+#include <boost/mpl/list.hpp>
+
+using TestedMapTypes =
+    boost::mpl::list<aisdi::BloomFilteredMap<aisdi::HashMap<int, std::string>>,
+                     aisdi::BloomFilteredMap<aisdi::TreeMap<int, std::string>>>;
+
+using std::begin;
+using std::end;
+
+namespace {
+
+std::string lowerCase(std::string text) {
+  for (char& c : text)
+    c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+  return text;
+}
+
+struct CaseInsensitiveHash {
+  std::size_t operator()(const std::string& key) const {
+    return std::hash<std::string>()(lowerCase(key));
+  }
+};
+
+struct CaseInsensitiveEqual {
+  bool operator()(const std::string& a, const std::string& b) const {
+    return lowerCase(a) == lowerCase(b);
+  }
+};
+
+}  // namespace
+
+BOOST_AUTO_TEST_SUITE(BloomFilteredMapTests)
+
+template <typename Map>
+void thenMapContainsItems(const Map& map,
+                          const std::map<int, std::string>& expected) {
+  BOOST_CHECK_EQUAL(map.getSize(), expected.size());
+
+  for (const auto& item : expected) {
+    const auto it = map.find(item.first);
+    BOOST_REQUIRE_MESSAGE(it != end(map),
+                          "Missing required item with key: " << item.first);
+    BOOST_CHECK_EQUAL(it->second, item.second);
+  }
+
+  // TreeMap iterators have no iterator_traits, so std::map cannot take them.
+  std::map<int, std::string> visited;
+  for (const auto& item : map)
+    visited.insert(item);
+  BOOST_CHECK(visited == expected);
+}
+
+BOOST_AUTO_TEST_CASE(GivenEmptyFilter_WhenAddingHashes_ThenAllOfThemAreFound) {
+  aisdi::BlockedBloomFilter filter(1000);
+  aisdi::KeyedHash<int> hash;
+
+  BOOST_CHECK(!filter.mayContain(hash(1)));
+  for (int i = 0; i < 1000; ++i)
+    filter.add(hash(i));
+
+  for (int i = 0; i < 1000; ++i)
+    BOOST_CHECK(filter.mayContain(hash(i)));
+  const aisdi::BlockedBloomFilter copy(filter);
+  for (int i = 0; i < 1000; ++i)
+    BOOST_CHECK(copy.mayContain(hash(i)));
+}
+
+BOOST_AUTO_TEST_CASE(
+    GivenFullFilter_WhenQueryingAbsentHashes_ThenFewFalsePositivesAreFound) {
+  aisdi::BlockedBloomFilter filter(10000);
+  aisdi::KeyedHash<int> hash;
+  for (int i = 0; i < 10000; ++i)
+    filter.add(hash(i));
+
+  int falsePositives = 0;
+  for (int i = 10000; i < 110000; ++i)
+    falsePositives += filter.mayContain(hash(i));
+
+  // About 1% is expected at 10 bits per key.
+  BOOST_CHECK_LT(falsePositives, 3000);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(
+    GivenFilteredMap_WhenInsertingAndLookingUp_ThenItBehavesLikeTheMap,
+    Map,
+    TestedMapTypes) {
+  Map map = {{753, "Rome"}, {1789, "Paris"}};
+  map[1410] = "Grunwald";
+  map.valueOf(753) = "Roma";
+
+  thenMapContainsItems(map,
+                       {{753, "Roma"}, {1789, "Paris"}, {1410, "Grunwald"}});
+  BOOST_CHECK(map.find(42) == map.end());
+  BOOST_CHECK(!map.contains(42));
+  BOOST_CHECK_THROW(map.valueOf(42), std::out_of_range);
+  BOOST_CHECK_THROW(map.remove(42), std::out_of_range);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(
+    GivenFilteredMap_WhenItOutgrowsTheFilter_ThenFilterGrowsAndKeysAreFound,
+    Map,
+    TestedMapTypes) {
+  Map map(16);
+  const auto blocks = map.getFilter().getBlockCount();
+  for (int i = 0; i < 5000; ++i)
+    map[i * 3] = std::to_string(i);
+
+  BOOST_CHECK_GT(map.getFilter().getBlockCount(), blocks);
+  BOOST_CHECK_GE(map.getFilter().getCapacity(), map.getSize());
+  for (int i = 0; i < 5000; ++i)
+    BOOST_CHECK_EQUAL(map.valueOf(i * 3), std::to_string(i));
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(
+    GivenFilteredMap_WhenLookingUpKeys_ThenOutcomesAreCounted,
+    Map,
+    TestedMapTypes) {
+  Map map;
+  for (int i = 0; i < 1000; ++i)
+    map[i] = std::to_string(i);
+
+  for (int i = 0; i < 2000; ++i)
+    map.contains(i);
+
+  const auto stats = map.getFilterStats();
+  BOOST_CHECK_EQUAL(stats.m_found, 1000);
+  BOOST_CHECK_EQUAL(stats.m_rejected + stats.m_missed, 1000);
+  BOOST_CHECK_GT(stats.m_rejected, 900);
+
+  const Map copy(map);
+  map.resetFilterStats();
+  BOOST_CHECK_EQUAL(map.getFilterStats().m_found, 0);
+  BOOST_CHECK_EQUAL(copy.getFilterStats().m_found, 0);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(
+    GivenFilteredMapAfterRemovals_WhenRebuildingFilter_ThenStaleKeysAreDropped,
+    Map,
+    TestedMapTypes) {
+  Map map;
+  for (int i = 0; i < 1000; ++i)
+    map[i] = std::to_string(i);
+  for (int i = 0; i < 900; ++i)
+    map.remove(i);
+  map.remove(map.find(999));
+
+  BOOST_CHECK_EQUAL(map.getStaleKeyCount(), 901);
+  map.rebuildFilter();
+
+  BOOST_CHECK_EQUAL(map.getStaleKeyCount(), 0);
+  BOOST_CHECK_LT(map.getFilter().getCapacity(), 1000);
+  map.resetFilterStats();
+  for (int i = 0; i < 900; ++i)
+    BOOST_CHECK(map.find(i) == map.end());
+  BOOST_CHECK_GT(map.getFilterStats().m_rejected, 800);
+  thenMapContainsItems(map, [] {
+    std::map<int, std::string> expected;
+    for (int i = 900; i < 999; ++i)
+      expected[i] = std::to_string(i);
+    return expected;
+  }());
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(
+    GivenFilteredMap_WhenMovingIt_ThenTargetKeepsKeysAndSourceCanBeRefilled,
+    Map,
+    TestedMapTypes) {
+  Map map = {{42, "Alice"}, {27, "Bob"}};
+
+  Map moved(std::move(map));
+  map = Map();
+  map[7] = "Carol";
+
+  thenMapContainsItems(moved, {{42, "Alice"}, {27, "Bob"}});
+  thenMapContainsItems(map, {{7, "Carol"}});
+  BOOST_CHECK(moved != map);
+}
+
+BOOST_AUTO_TEST_CASE(
+    GivenMapWithCustomKeyEquality_WhenFiltering_ThenEqualKeysAreFound) {
+  aisdi::BloomFilteredMap<aisdi::HashMap<std::string, int, CaseInsensitiveHash,
+                                         CaseInsensitiveEqual>>
+      map;
+  map["Alice"] = 1;
+  map["ALICE"] = 2;
+
+  BOOST_CHECK_EQUAL(map.getSize(), 1);
+  BOOST_CHECK_EQUAL(map.valueOf("alice"), 2);
+  BOOST_CHECK(map.contains("aLiCe"));
+  BOOST_CHECK(!map.contains("Bob"));
+  map.remove("ALICE");
+  BOOST_CHECK(map.isEmpty());
+}
+
+using IdentityHashedMapTypes = boost::mpl::list<
+    aisdi::BloomFilteredMap<aisdi::DenseHashMap<int, int>>,
+    aisdi::BloomFilteredMap<aisdi::HashMap<int, int, std::hash<int>>>>;
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(
+    GivenIdentityHashedMap_WhenLookingUpAbsentKeys_ThenMostAreRejected,
+    Map,
+    IdentityHashedMapTypes) {
+  Map map(10000);
+  for (int i = 0; i < 10000; ++i)
+    map[i] = i;
+
+  for (int i = 10000; i < 110000; ++i)
+    BOOST_REQUIRE(!map.contains(i));
+
+  // About 1% is expected at 10 bits per key.
+  BOOST_CHECK_LT(map.getFilterStats().m_missed, 3000);
+}
+
+BOOST_AUTO_TEST_CASE(GivenHashMap_WhenFiltering_ThenItsOwnHasherIsUsed) {
+  const aisdi::BloomFilteredMap<aisdi::HashMap<int, int>> map;
+
+  BOOST_CHECK(map.getHashFunction() == map.getMap().getHashFunction());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,210 @@
+#include <ConcurrentHashMap.h>
+
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+#include <boost/mpl/list.hpp>
+
+template <typename K>
+using Map = aisdi::ConcurrentHashMap<K, std::string>;
+
+using TestedKeyTypes = boost::mpl::list<std::int32_t, std::uint64_t>;
+
+namespace {
+
+const int threadCount = 4;
+
+template <typename Function>
+void runInThreads(Function function) {
+  std::vector<std::thread> threads;
+  for (int i = 0; i < threadCount; ++i)
+    threads.emplace_back(function, i);
+  for (auto& thread : threads)
+    thread.join();
+}
+
+}  // namespace
+
+BOOST_AUTO_TEST_SUITE(ConcurrentHashMapTests)
+
+template <typename K>
+void thenMapContainsItems(const Map<K>& map,
+                          const std::map<K, std::string>& expected) {
+  BOOST_CHECK_EQUAL(map.getSize(), expected.size());
+
+  for (const auto& item : expected) {
+    std::string value;
+    BOOST_REQUIRE_MESSAGE(map.tryGet(item.first, value),
+                          "Missing required item with key: " << item.first);
+    BOOST_CHECK_MESSAGE(value == item.second,
+                        "Wrong value in map for key: "
+                            << item.first << " (expected: \"" << item.second
+                            << "\" got: \"" << value << "\")");
+  }
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(
+    GivenMap_WhenCreatedWithDefaultConstructor_ThenItIsEmpty,
+    K,
+    TestedKeyTypes) {
+  const Map<K> map;
+
+  BOOST_CHECK(map.isEmpty());
+  BOOST_CHECK(!map.contains(1));
+  BOOST_CHECK_GT(map.getShardCount(), 0);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(
+    GivenMap_WhenInsertingOrAssigning_ThenNewKeysAreReported,
+    K,
+    TestedKeyTypes) {
+  Map<K> map;
+
+  BOOST_CHECK(map.insertOrAssign(42, "Chuck"));
+  BOOST_CHECK(!map.insertOrAssign(42, "Alice"));
+  BOOST_CHECK(map.insertOrAssign(27, "Bob"));
+
+  thenMapContainsItems(map, {{42, "Alice"}, {27, "Bob"}});
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(
+    GivenNotEmptyMap_WhenReadingAndRemovingMissingKey_ThenExceptionIsThrown,
+    K,
+    TestedKeyTypes) {
+  Map<K> map = {{42, "Alice"}, {27, "Bob"}};
+
+  BOOST_CHECK_THROW(map.valueOf(1), std::out_of_range);
+  BOOST_CHECK_THROW(map.remove(1), std::out_of_range);
+  map.remove(27);
+
+  thenMapContainsItems(map, {{42, "Alice"}});
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(
+    GivenMap_WhenComputingIfAbsent_ThenExistingValueIsKept,
+    K,
+    TestedKeyTypes) {
+  Map<K> map = {{42, "Alice"}};
+  int calls = 0;
+  auto make = [&calls](const K&) {
+    ++calls;
+    return std::string("Bob");
+  };
+
+  BOOST_CHECK_EQUAL(map.computeIfAbsent(42, make), "Alice");
+  BOOST_CHECK_EQUAL(map.computeIfAbsent(27, make), "Bob");
+  BOOST_CHECK_EQUAL(map.computeIfAbsent(27, make), "Bob");
+
+  BOOST_CHECK_EQUAL(calls, 1);
+  thenMapContainsItems(map, {{42, "Alice"}, {27, "Bob"}});
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(
+    GivenMap_WhenErasingIf_ThenOnlyMatchingValuesAreRemoved,
+    K,
+    TestedKeyTypes) {
+  Map<K> map = {{42, "Alice"}, {27, "Bob"}};
+  auto isBob = [](const std::string& value) { return value == "Bob"; };
+
+  BOOST_CHECK(!map.eraseIf(42, isBob));
+  BOOST_CHECK(map.eraseIf(27, isBob));
+  BOOST_CHECK(!map.eraseIf(27, isBob));
+
+  thenMapContainsItems(map, {{42, "Alice"}});
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(
+    GivenManyThreads_WhenInsertingDisjointKeys_ThenAllItemsAreInMap,
+    K,
+    TestedKeyTypes) {
+  Map<K> map;
+
+  runInThreads([&map](int thread) {
+    for (int i = thread; i < 4000; i += threadCount)
+      map.insertOrAssign(i, std::to_string(i));
+  });
+
+  std::map<K, std::string> expected;
+  for (int i = 0; i < 4000; ++i)
+    expected[i] = std::to_string(i);
+  thenMapContainsItems(map, expected);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(
+    GivenManyThreads_WhenComputingSameKeys_ThenEachValueIsMadeOnce,
+    K,
+    TestedKeyTypes) {
+  Map<K> map;
+  std::atomic<int> calls(0);
+  std::atomic<int> mismatches(0);
+
+  runInThreads([&map, &calls, &mismatches](int thread) {
+    for (int i = 0; i < 1000; ++i) {
+      const std::string value =
+          map.computeIfAbsent(i, [&calls, thread](const K& key) {
+            ++calls;
+            return std::to_string(key) + "/" + std::to_string(thread);
+          });
+      if (value.substr(0, value.find('/')) != std::to_string(i))
+        ++mismatches;
+    }
+  });
+
+  BOOST_CHECK_EQUAL(calls.load(), 1000);
+  BOOST_CHECK_EQUAL(mismatches.load(), 0);
+  BOOST_CHECK_EQUAL(map.getSize(), 1000);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(
+    GivenManyThreads_WhenReadingAndErasingConcurrently_ThenEachKeyIsErasedOnce,
+    K,
+    TestedKeyTypes) {
+  Map<K> map;
+  for (int i = 0; i < 2000; ++i)
+    map.insertOrAssign(i, std::to_string(i));
+  std::atomic<int> erased(0);
+  std::atomic<int> mismatches(0);
+
+  runInThreads([&map, &erased, &mismatches](int thread) {
+    for (int i = 0; i < 2000; ++i) {
+      std::string value;
+      if (map.tryGet(i, value) && value != std::to_string(i))
+        ++mismatches;
+      if (thread % 2 &&
+          map.eraseIf(i, [](const std::string&) { return true; }))
+        ++erased;
+    }
+  });
+
+  BOOST_CHECK_EQUAL(erased.load(), 2000);
+  BOOST_CHECK_EQUAL(mismatches.load(), 0);
+  BOOST_CHECK(map.isEmpty());
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(
+    GivenNotEmptyMap_WhenVisitingEachItem_ThenAllItemsAreVisited,
+    K,
+    TestedKeyTypes) {
+  Map<K> map(2);
+  std::map<K, std::string> expected;
+  for (int i = 0; i < 100; ++i) {
+    map.insertOrAssign(i, std::to_string(i));
+    expected[i] = std::to_string(i);
+  }
+
+  std::map<K, std::string> visited;
+  map.forEach([&visited](const std::pair<const K, std::string>& item) {
+    visited.insert(item);
+  });
+
+  BOOST_CHECK_EQUAL(map.getShardCount(), 2);
+  BOOST_CHECK(visited == expected);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
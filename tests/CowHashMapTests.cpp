@@ -0,0 +1,252 @@
+#include <CowHashMap.h>
+#include <HashMap.h>
+
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+#include <boost/mpl/list.hpp>
+
+template <typename K>
+using Map = aisdi::CowHashMap<K, std::string>;
+
+using TestedKeyTypes = boost::mpl::list<std::int32_t, std::uint64_t>;
+
+using std::begin;
+using std::end;
+
+BOOST_AUTO_TEST_SUITE(CowHashMapTests)
+
+template <typename K>
+void thenMapContainsItems(const Map<K>& map,
+                          const std::map<K, std::string>& expected) {
+  BOOST_CHECK_EQUAL(map.getSize(), expected.size());
+
+  for (const auto& item : expected) {
+    const auto it = map.find(item.first);
+    BOOST_REQUIRE_MESSAGE(it != end(map),
+                          "Missing required item with key: " << item.first);
+    BOOST_CHECK_MESSAGE(it->second == item.second,
+                        "Wrong value in map for key: "
+                            << item.first << " (expected: \"" << item.second
+                            << "\" got: \"" << it->second << "\")");
+  }
+
+  std::map<K, std::string> visited(map.begin(), map.end());
+  BOOST_CHECK(visited == expected);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(
+    GivenMap_WhenCreatedWithDefaultConstructor_ThenItIsEmpty,
+    K,
+    TestedKeyTypes) {
+  const Map<K> map;
+
+  BOOST_CHECK(map.isEmpty());
+  BOOST_CHECK(map.begin() == map.end());
+  BOOST_CHECK(map.find(1) == map.end());
+  BOOST_CHECK_THROW(map.valueOf(1), std::out_of_range);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(
+    GivenNonEmptyMap_WhenChangingAndRemovingItems_ThenMapIsUpdated,
+    K,
+    TestedKeyTypes) {
+  Map<K> map = {{42, "Chuck"}, {27, "Bob"}, {753, "Rome"}};
+
+  map[42] = "Alice";
+  map.valueOf(27) = "Eve";
+  map.remove(753);
+
+  thenMapContainsItems(map, {{42, "Alice"}, {27, "Eve"}});
+  BOOST_CHECK_THROW(map.remove(753), std::out_of_range);
+  BOOST_CHECK_THROW(map.valueOf(753), std::out_of_range);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(
+    GivenMap_WhenAddingManyItems_ThenTableGrowsAndKeepsThem,
+    K,
+    TestedKeyTypes) {
+  Map<K> map;
+  std::map<K, std::string> expected;
+
+  for (int i = 0; i < 5000; ++i) {
+    map[i] = std::to_string(i);
+    expected[i] = std::to_string(i);
+  }
+
+  BOOST_CHECK_GE(map.getBucketCount(), 5000);
+  thenMapContainsItems(map, expected);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(
+    GivenSnapshot_WhenChangingLiveMap_ThenSnapshotKeepsOldContents,
+    K,
+    TestedKeyTypes) {
+  Map<K> map;
+  std::map<K, std::string> expected;
+  for (int i = 0; i < 1000; ++i) {
+    map[i] = std::to_string(i);
+    expected[i] = std::to_string(i);
+  }
+
+  const Map<K> snapshot = map.snapshot();
+  BOOST_CHECK(snapshot == map);
+  map[0] = "changed";
+  map.valueOf(1) = "changed";
+  map.remove(2);
+  for (int i = 1000; i < 3000; ++i)
+    map[i] = std::to_string(i);
+
+  thenMapContainsItems(snapshot, expected);
+  BOOST_CHECK(snapshot != map);
+  BOOST_CHECK_EQUAL(map.getSize(), 2999);
+  BOOST_CHECK_EQUAL(map.valueOf(0), "changed");
+  BOOST_CHECK_EQUAL(map.valueOf(1), "changed");
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(
+    GivenSnapshot_WhenChangingIt_ThenLiveMapIsUnaffected,
+    K,
+    TestedKeyTypes) {
+  const Map<K> map = {{42, "Alice"}, {27, "Bob"}};
+  Map<K> snapshot = map.snapshot();
+
+  snapshot[42] = "Eve";
+  snapshot.remove(27);
+
+  thenMapContainsItems(map, {{42, "Alice"}, {27, "Bob"}});
+  thenMapContainsItems(snapshot, {{42, "Eve"}});
+}
+
+BOOST_AUTO_TEST_CASE(
+    GivenSnapshotOfLargeMap_WhenChangingFewItems_ThenOnlyTheirSegmentsAreCopied) {
+  aisdi::CowHashMap<int, int> map;
+  for (int i = 0; i < 100000; ++i)
+    map.insertOrAssign(i, i);
+  const auto segmentCount = map.getOwnedSegmentCount();
+
+  const auto snapshot = map.snapshot();
+  BOOST_CHECK_EQUAL(map.getOwnedSegmentCount(), 0);
+  map.insertOrAssign(10, -10);
+  map[20000] = -20000;
+
+  BOOST_CHECK_GT(segmentCount, 1000);
+  BOOST_CHECK_LE(map.getOwnedSegmentCount(), 2);
+  BOOST_CHECK_EQUAL(snapshot.valueOf(10), 10);
+  BOOST_CHECK_EQUAL(map.valueOf(10), -10);
+}
+
+BOOST_AUTO_TEST_CASE(
+    GivenSnapshotOfLargeMap_WhenGrowingIt_ThenUntouchedSegmentsStayShared) {
+  aisdi::CowHashMap<int, int> map;
+  for (int i = 0; i < 100000; ++i)
+    map.insertOrAssign(i, i);
+  const auto snapshot = map.snapshot();
+
+  for (int i = 100000; i < 101000; ++i)
+    map.insertOrAssign(i, i);
+  map.insertOrAssign(5, -5);
+
+  BOOST_CHECK_LE(map.getOwnedSegmentCount(), 64);
+  BOOST_CHECK_EQUAL(map.getSize(), 101000);
+  BOOST_CHECK_EQUAL(snapshot.getSize(), 100000);
+  BOOST_CHECK(!snapshot.contains(100500));
+  BOOST_CHECK_EQUAL(snapshot.valueOf(5), 5);
+  for (int i = 0; i < 101000; ++i)
+    BOOST_CHECK_EQUAL(map.valueOf(i), i == 5 ? -5 : i);
+  int visited = 0;
+  for (const auto& item : map)
+    visited += item.first == item.second || item.first == 5;
+  BOOST_CHECK_EQUAL(visited, 101000);
+}
+
+BOOST_AUTO_TEST_CASE(
+    GivenKeysSharingLowHashBits_WhenInserting_ThenAllItemsAreFound) {
+  struct ShiftedHash {
+    std::size_t operator()(int key) const {
+      return static_cast<std::size_t>(key) << 20;
+    }
+  };
+  aisdi::CowHashMap<int, int, ShiftedHash> map;
+  for (int i = 0; i < 2000; ++i)
+    map[i] = -i;
+  const auto snapshot = map.snapshot();
+  map.remove(7);
+
+  BOOST_CHECK_EQUAL(map.getSize(), 1999);
+  for (int i = 0; i < 2000; ++i) {
+    BOOST_CHECK_EQUAL(snapshot.valueOf(i), -i);
+    BOOST_CHECK_EQUAL(map.contains(i), i != 7);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(
+    GivenHeldValueReference_WhenWritingAfterSnapshot_ThenSnapshotIsUnaffected) {
+  aisdi::CowHashMap<int, int> map;
+  for (int i = 0; i < 1000; ++i)
+    map.insertOrAssign(i, i);
+  int& value = map[10];
+  int& other = map.valueOf(500);
+
+  const auto snapshot = map.snapshot();
+  value = -10;
+  other = -500;
+  for (int i = 1000; i < 3000; ++i)
+    map.insertOrAssign(i, i);
+  const auto later = map.snapshot();
+  value = -11;
+
+  BOOST_CHECK_EQUAL(snapshot.valueOf(10), 10);
+  BOOST_CHECK_EQUAL(snapshot.valueOf(500), 500);
+  BOOST_CHECK_EQUAL(later.valueOf(10), -10);
+  BOOST_CHECK_EQUAL(map.valueOf(10), -11);
+  BOOST_CHECK_EQUAL(map.valueOf(500), -500);
+  BOOST_CHECK_GE(map.getOwnedSegmentCount(), 1);
+}
+
+BOOST_AUTO_TEST_CASE(GivenHashMap_WhenCopyingIntoCowMap_ThenAllItemsAreCopied) {
+  const aisdi::HashMap<int, std::string> source = {{42, "Alice"},
+                                                   {27, "Bob"}};
+
+  const Map<int> map(source.begin(), source.end());
+
+  thenMapContainsItems(map, {{42, "Alice"}, {27, "Bob"}});
+}
+
+// Each reader checks the snapshot it was given while the writer keeps
+// replacing values of the live map, which may only change copies of the
+// segments the readers see.
+BOOST_AUTO_TEST_CASE(
+    GivenSnapshotsReadOnOtherThreads_WhenWriterUpdatesLiveMap_ThenSnapshotsDoNotChange) {
+  aisdi::CowHashMap<int, int> map;
+  for (int i = 0; i < 2000; ++i)
+    map.insertOrAssign(i, 0);
+
+  std::atomic<int> mismatches(0);
+  std::vector<std::thread> readers;
+  for (int round = 0; round < 4; ++round) {
+    readers.emplace_back(
+        [&mismatches, round](aisdi::CowHashMap<int, int> snapshot) {
+          for (int pass = 0; pass < 20; ++pass)
+            for (const auto& item : snapshot)
+              if (item.second != round)
+                ++mismatches;
+        },
+        map.snapshot());
+    for (int i = 0; i < 2000; ++i)
+      map.insertOrAssign(i, round + 1);
+  }
+  for (auto& thread : readers)
+    thread.join();
+
+  BOOST_CHECK_EQUAL(mismatches.load(), 0);
+  BOOST_CHECK_EQUAL(map.valueOf(0), 4);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
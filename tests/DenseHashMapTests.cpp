@@ -0,0 +1,399 @@
+#include <DenseHashMap.h>
+#include <KeyedHash.h>
+
+#include <cstdint>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+#include <boost/mpl/list.hpp>
+
+template <typename K>
+using Map = aisdi::DenseHashMap<K, std::string>;
+
+using TestedKeyTypes = boost::mpl::list<std::int32_t, std::uint64_t>;
+
+using std::begin;
+using std::end;
+
+BOOST_AUTO_TEST_SUITE(DenseHashMapTests)
+
+template <typename K>
+void thenMapContainsItems(const Map<K>& map,
+                          const std::map<K, std::string>& expected) {
+  BOOST_CHECK_EQUAL(map.getSize(), expected.size());
+
+  for (const auto& item : expected) {
+    const auto it = map.find(item.first);
+    BOOST_REQUIRE_MESSAGE(it != end(map),
+                          "Missing required item with key: " << item.first);
+    BOOST_CHECK_MESSAGE(it->second == item.second,
+                        "Wrong value in map for key: "
+                            << item.first << " (expected: \"" << item.second
+                            << "\" got: \"" << it->second << "\")");
+  }
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(
+    GivenMap_WhenCreatedWithDefaultConstructor_ThenItIsEmpty,
+    K,
+    TestedKeyTypes) {
+  const Map<K> map;
+
+  BOOST_CHECK(map.isEmpty());
+  BOOST_CHECK(map.begin() == map.end());
+  BOOST_CHECK(map.find(1) == map.end());
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenEmptyMap_WhenAddingItem_ThenItemIsInMap,
+                              K,
+                              TestedKeyTypes) {
+  Map<K> map;
+
+  map[42] = "Alice";
+
+  thenMapContainsItems(map, {{42, "Alice"}});
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(
+    GivenMap_WhenInitializingFromListOfPairs_ThenAllItemsAreInMap,
+    K,
+    TestedKeyTypes) {
+  const Map<K> map = {{42, "Alice"}, {27, "Bob"}};
+
+  thenMapContainsItems(map, {{42, "Alice"}, {27, "Bob"}});
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(
+    GivenNonEmptyMap_WhenChangingItem_ThenNewValueIsInMap,
+    K,
+    TestedKeyTypes) {
+  Map<K> map = {{42, "Chuck"}, {27, "Bob"}};
+
+  map[42] = "Alice";
+  map.valueOf(27) = "Eve";
+
+  thenMapContainsItems(map, {{42, "Alice"}, {27, "Eve"}});
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(
+    GivenNotEmptyMap_WhenReadingValueOfMissingKey_ThenExceptionIsThrown,
+    K,
+    TestedKeyTypes) {
+  const Map<K> map = {{42, "Alice"}, {27, "Bob"}};
+
+  BOOST_CHECK_THROW(map.valueOf(1), std::out_of_range);
+  BOOST_CHECK_EQUAL(map.valueOf(42), "Alice");
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(
+    GivenNotEmptyMap_WhenRemovingValueByKey_ThenItemIsRemoved,
+    K,
+    TestedKeyTypes) {
+  Map<K> map = {{42, "Alice"}, {27, "Bob"}};
+
+  map.remove(27);
+
+  thenMapContainsItems(map, {{42, "Alice"}});
+  BOOST_CHECK_THROW(map.remove(27), std::out_of_range);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(
+    GivenNotEmptyMap_WhenRemovingItemByIterator_ThenItemIsRemoved,
+    K,
+    TestedKeyTypes) {
+  Map<K> map = {{42, "Alice"}, {27, "Bob"}};
+
+  map.remove(map.find(42));
+
+  thenMapContainsItems(map, {{27, "Bob"}});
+  BOOST_CHECK_THROW(map.remove(end(map)), std::out_of_range);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(
+    GivenMapWithOnePair_WhenIterating_ThenPairIsReturned,
+    K,
+    TestedKeyTypes) {
+  Map<K> map;
+  map[753] = "Rome";
+
+  auto it = map.begin();
+
+  BOOST_CHECK_EQUAL(it->first, 753);
+  BOOST_CHECK_EQUAL(it->second, "Rome");
+  BOOST_CHECK(++it == map.end());
+  BOOST_CHECK(--it == map.begin());
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(
+    GivenBoundaryIterators_WhenMovingPastThem_ThenOperationThrows,
+    K,
+    TestedKeyTypes) {
+  Map<K> map;
+
+  BOOST_CHECK_THROW(++(map.end()), std::out_of_range);
+  BOOST_CHECK_THROW(--(map.begin()), std::out_of_range);
+  BOOST_CHECK_THROW(*map.cend(), std::out_of_range);
+
+  map[1] = "1";
+
+  BOOST_CHECK_THROW(map.end()++, std::out_of_range);
+  BOOST_CHECK_THROW(map.cbegin()--, std::out_of_range);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(
+    GivenLargeMap_WhenIteratingBothWays_ThenEveryItemIsVisitedOnce,
+    K,
+    TestedKeyTypes) {
+  Map<K> map;
+  for (int i = 0; i < 1000; ++i)
+    map[i] = std::to_string(i);
+
+  std::map<K, std::string> forward;
+  for (auto it = map.begin(); it != map.end(); ++it)
+    BOOST_CHECK(forward.emplace(it->first, it->second).second);
+
+  std::map<K, std::string> backward;
+  for (auto it = map.end(); it != map.begin();) {
+    --it;
+    BOOST_CHECK(backward.emplace(it->first, it->second).second);
+  }
+
+  BOOST_CHECK_EQUAL(forward.size(), 1000);
+  BOOST_CHECK(forward == backward);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(
+    GivenNonEmptyMap_WhenCreatingCopy_ThenAllItemsAreCopied,
+    K,
+    TestedKeyTypes) {
+  Map<K> map = {{753, "Rome"}, {1789, "Paris"}};
+  const Map<K> other{map};
+
+  map[1410] = "Grunwald";
+
+  thenMapContainsItems(map,
+                       {{1410, "Grunwald"}, {753, "Rome"}, {1789, "Paris"}});
+  thenMapContainsItems(other, {{753, "Rome"}, {1789, "Paris"}});
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(
+    GivenNonEmptyMap_WhenMovingToOther_ThenAllItemsAreMoved,
+    K,
+    TestedKeyTypes) {
+  Map<K> map = {{753, "Rome"}, {1789, "Paris"}};
+  Map<K> other = {{42, "Alice"}};
+
+  other = std::move(map);
+  Map<K> third{std::move(other)};
+
+  thenMapContainsItems(third, {{753, "Rome"}, {1789, "Paris"}});
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(
+    GivenNotEmptyMap_WhenSelfAssigning_ThenNothingHappens,
+    K,
+    TestedKeyTypes) {
+  Map<K> map = {{42, "Alice"}, {27, "Bob"}};
+  Map<K>& self = map;
+
+  map = self;
+
+  thenMapContainsItems(map, {{42, "Alice"}, {27, "Bob"}});
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(
+    GivenTwoEquivalentMaps_WhenComparingThem_ThenTheyAreReportedAsEqual,
+    K,
+    TestedKeyTypes) {
+  const Map<K> map = {{42, "Alice"}, {27, "Bob"}};
+  const Map<K> other = {{27, "Bob"}, {42, "Alice"}};
+  const Map<K> different = {{27, "Alice"}, {42, "Bob"}};
+
+  BOOST_CHECK(map == other);
+  BOOST_CHECK(map != different);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(
+    GivenReservedMap_WhenAddingReservedItems_ThenIndexDoesNotGrow,
+    K,
+    TestedKeyTypes) {
+  Map<K> map;
+
+  map.reserve(1000);
+  const auto indexSize = map.getIndexSize();
+  for (int i = 0; i < 1000; ++i)
+    map[i] = std::string{};
+
+  BOOST_CHECK_EQUAL(map.getIndexSize(), indexSize);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(
+    GivenMap_WhenInsertingAndRemovingRandomly_ThenItBehavesLikeStdMap,
+    K,
+    TestedKeyTypes) {
+  Map<K> map;
+  std::map<K, std::string> expected;
+  std::mt19937 generator(2018);
+  std::uniform_int_distribution<int> keys(0, 500);
+
+  for (int i = 0; i < 20000; ++i) {
+    const K key = keys(generator);
+    if (generator() % 3) {
+      map[key] = std::to_string(i);
+      expected[key] = std::to_string(i);
+    } else if (expected.erase(key)) {
+      map.remove(key);
+    } else {
+      BOOST_REQUIRE(map.find(key) == map.end());
+    }
+  }
+
+  thenMapContainsItems(map, expected);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(
+    GivenChurnedMap_WhenSearchingForRemovedKeys_ThenEndIsReturned,
+    K,
+    TestedKeyTypes) {
+  Map<K> map;
+  for (int round = 0; round < 10; ++round) {
+    for (int i = 0; i < 1000; ++i)
+      map[round * 1000 + i] = std::to_string(i);
+    for (int i = 0; i < 1000; ++i)
+      map.remove(round * 1000 + i);
+  }
+
+  BOOST_CHECK(map.isEmpty());
+  BOOST_CHECK(map.begin() == map.end());
+  for (int i = 0; i < 10000; ++i)
+    BOOST_REQUIRE(map.find(i) == map.end());
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(
+    GivenMap_WhenRemovingItemsWhileIterating_ThenOnlyThoseItemsAreRemoved,
+    K,
+    TestedKeyTypes) {
+  Map<K> map;
+  std::map<K, std::string> expected;
+  for (int i = 0; i < 1000; ++i) {
+    map[i] = std::to_string(i);
+    if (i % 3)
+      expected[i] = std::to_string(i);
+  }
+
+  for (auto it = map.begin(); it != map.end();) {
+    if (static_cast<int>(it->first) % 3 == 0)
+      it = map.remove(it);
+    else
+      ++it;
+  }
+
+  thenMapContainsItems(map, expected);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(
+    GivenSingleItemMap_WhenRemovingItemByIterator_ThenEndIsReturned,
+    K,
+    TestedKeyTypes) {
+  Map<K> map = {{42, "Alice"}};
+
+  BOOST_CHECK(map.remove(map.begin()) == map.end());
+}
+
+template <typename K>
+std::vector<K> keysInOrder(const Map<K>& map) {
+  std::vector<K> keys;
+  for (const auto& item : map)
+    keys.push_back(item.first);
+  return keys;
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(
+    GivenMap_WhenIterating_ThenItemsComeInInsertionOrder,
+    K,
+    TestedKeyTypes) {
+  Map<K> map;
+  std::vector<K> expected;
+  for (int i = 0; i < 1000; ++i) {
+    const K key = (i * 7919) % 1000;
+    map[key] = std::to_string(i);
+    expected.push_back(key);
+  }
+  map[expected[10]] = "changed";
+
+  BOOST_CHECK(keysInOrder(map) == expected);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(
+    GivenMapWithRemovedItems_WhenIterating_ThenRemainingOrderIsKept,
+    K,
+    TestedKeyTypes) {
+  Map<K> map;
+  std::vector<K> expected;
+  for (int i = 0; i < 1000; ++i)
+    map[i] = std::to_string(i);
+  for (int i = 0; i < 1000; ++i) {
+    if (i % 4)
+      map.remove(i);
+    else
+      expected.push_back(i);
+  }
+  map[2000] = "2000";
+  expected.push_back(2000);
+
+  BOOST_CHECK(keysInOrder(map) == expected);
+  std::vector<K> backward;
+  for (auto it = map.end(); it != map.begin();)
+    backward.insert(backward.begin(), (--it)->first);
+  BOOST_CHECK(backward == expected);
+}
+
+BOOST_AUTO_TEST_CASE(
+    GivenMapsWithDifferentSeeds_WhenAssigning_ThenTargetFindsAllKeys) {
+  using SeededMap = aisdi::DenseHashMap<int, int, aisdi::KeyedHash<int>>;
+  SeededMap map(0, aisdi::KeyedHash<int>(1));
+  for (int i = 0; i < 100; ++i)
+    map[i] = i;
+
+  SeededMap copy(0, aisdi::KeyedHash<int>(2));
+  copy = map;
+  SeededMap moved(0, aisdi::KeyedHash<int>(3));
+  moved = std::move(map);
+
+  for (int i = 0; i < 100; ++i) {
+    BOOST_CHECK_EQUAL(copy.valueOf(i), i);
+    BOOST_CHECK_EQUAL(moved.valueOf(i), i);
+  }
+  map[7] = 7;
+  BOOST_CHECK_EQUAL(map.valueOf(7), 7);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(
+    GivenIteratorAfterHole_WhenAssigningOrInserting_ThenItStaysValid,
+    K,
+    TestedKeyTypes) {
+  Map<K> map;
+  for (int i = 0; i < 4; ++i)
+    map[i] = std::to_string(i);
+  auto it = map.remove(map.begin());
+  const std::size_t indexSize = map.getIndexSize();
+
+  map[3] = "30";
+
+  BOOST_CHECK_EQUAL(it->first, 1);
+  BOOST_CHECK_EQUAL(map.getIndexSize(), indexSize);
+
+  for (int i = 4; i < 100; ++i)
+    map[i] = std::to_string(i);
+
+  BOOST_CHECK_EQUAL(it->first, 1);
+  BOOST_CHECK_EQUAL((++it)->first, 2);
+  BOOST_CHECK_EQUAL(map.getSize(), 99);
+  BOOST_CHECK_EQUAL(map.valueOf(3), "30");
+}
+
+BOOST_AUTO_TEST_SUITE_END()
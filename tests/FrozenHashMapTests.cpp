@@ -0,0 +1,171 @@
+#include <FrozenHashMap.h>
+#include <HashMap.h>
+
+#include <cctype>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+#include <boost/test/unit_test.hpp>
+
+namespace {
+
+struct ConstantHash {
+  std::size_t operator()(int) const { return 42; }
+};
+
+struct LowBitsHash {
+  std::size_t operator()(int key) const { return key & 15; }
+};
+
+struct CaseInsensitiveHash {
+  std::size_t operator()(const std::string& key) const {
+    std::string lower(key);
+    for (char& c : lower)
+      c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+    return std::hash<std::string>()(lower);
+  }
+};
+
+struct CaseInsensitiveEqual {
+  bool operator()(const std::string& a, const std::string& b) const {
+    if (a.size() != b.size())
+      return false;
+    for (std::size_t i = 0; i < a.size(); ++i)
+      if (std::tolower(static_cast<unsigned char>(a[i])) !=
+          std::tolower(static_cast<unsigned char>(b[i])))
+        return false;
+    return true;
+  }
+};
+
+// Value that can only be compared with ==.
+struct EqualityOnly {
+  int m_value = 0;
+
+  bool operator==(const EqualityOnly& other) const {
+    return m_value == other.m_value;
+  }
+};
+
+}  // namespace
+
+BOOST_AUTO_TEST_SUITE(FrozenHashMapTests)
+
+BOOST_AUTO_TEST_CASE(GivenMap_WhenFreezingIt_ThenFrozenMapHoldsTheSameItems) {
+  aisdi::HashMap<std::int64_t, std::string> map;
+  for (std::int64_t i = 0; i < 20000; ++i)
+    map[i * 7919] = std::to_string(i);
+
+  const auto frozen = map.freeze();
+
+  BOOST_CHECK_EQUAL(frozen.getSize(), 20000);
+  BOOST_CHECK(frozen.getHashFunction() == map.getHashFunction());
+  for (std::int64_t i = 0; i < 20000; ++i)
+    BOOST_CHECK_EQUAL(frozen.valueOf(i * 7919), std::to_string(i));
+  for (std::int64_t i = 1; i < 7919; ++i)
+    BOOST_CHECK(frozen.find(i) == frozen.end());
+  BOOST_CHECK(!frozen.contains(-1));
+  BOOST_CHECK_THROW(frozen.valueOf(-1), std::out_of_range);
+
+  std::map<std::int64_t, std::string> visited(frozen.begin(), frozen.end());
+  BOOST_CHECK_EQUAL(visited.size(), 20000);
+  BOOST_CHECK_EQUAL(visited[7919 * 19999], "19999");
+}
+
+BOOST_AUTO_TEST_CASE(GivenFrozenMap_WhenMeasuringIt_ThenFewBitsPerKeyAreSpent) {
+  aisdi::HashMap<int, int> map;
+  for (int i = 0; i < 100000; ++i)
+    map[i] = i;
+
+  const auto frozen = map.freeze();
+
+  using Item = std::pair<const int, int>;
+  const std::size_t metadata =
+      frozen.getMemoryUsage() - frozen.getSize() * sizeof(Item);
+  BOOST_CHECK_LT(metadata * 8, frozen.getSize() * 6);
+}
+
+BOOST_AUTO_TEST_CASE(GivenTinyOrEmptyMap_WhenFreezingIt_ThenLookupsWork) {
+  const auto empty = aisdi::HashMap<int, int>().freeze();
+  BOOST_CHECK(empty.isEmpty());
+  BOOST_CHECK(empty.begin() == empty.end());
+  BOOST_CHECK(!empty.contains(0));
+
+  const auto single = aisdi::HashMap<int, int>{{5, 25}}.freeze();
+  BOOST_CHECK_EQUAL(single.valueOf(5), 25);
+  BOOST_CHECK(!single.contains(6));
+
+  const auto pair = aisdi::HashMap<int, int>{{1, 1}, {2, 4}}.freeze();
+  BOOST_CHECK_EQUAL(pair.valueOf(2), 4);
+  const aisdi::HashMap<int, int> reordered = {{2, 4}, {1, 1}};
+  BOOST_CHECK(pair == reordered.freeze());
+  BOOST_CHECK(pair != single);
+
+  for (int size = 3; size < 200; size += 7) {
+    aisdi::HashMap<int, int> map;
+    for (int i = 0; i < size; ++i)
+      map[i] = -i;
+    const auto frozen = map.freeze();
+    for (int i = 0; i < size; ++i)
+      BOOST_CHECK_EQUAL(frozen.valueOf(i), -i);
+    BOOST_CHECK(!frozen.contains(size));
+  }
+}
+
+BOOST_AUTO_TEST_CASE(GivenCustomKeyEqual_WhenFreezing_ThenItIsUsedForLookups) {
+  aisdi::HashMap<std::string, int, CaseInsensitiveHash, CaseInsensitiveEqual>
+      map;
+  map["Alice"] = 1;
+  map["Bob"] = 2;
+
+  const auto frozen = map.freeze();
+
+  BOOST_CHECK_EQUAL(frozen.valueOf("ALICE"), 1);
+  BOOST_CHECK_EQUAL(frozen.valueOf("bob"), 2);
+  BOOST_CHECK(!frozen.contains("Carol"));
+}
+
+BOOST_AUTO_TEST_CASE(GivenKeysWithEqualHashes_WhenFreezing_ThenAllAreFound) {
+  aisdi::HashMap<int, int, ConstantHash> constant = {{1, 1}, {2, 2}, {3, 3}};
+  aisdi::HashMap<int, int, LowBitsHash> colliding;
+  for (int i = 0; i < 100; ++i)
+    colliding[i] = -i;
+
+  const auto frozenConstant = constant.freeze();
+  const auto frozenColliding = colliding.freeze();
+
+  BOOST_CHECK_EQUAL(frozenConstant.getSize(), 3);
+  BOOST_CHECK_EQUAL(frozenConstant.getStashSize(), 2);
+  for (int i = 1; i <= 3; ++i)
+    BOOST_CHECK_EQUAL(frozenConstant.valueOf(i), i);
+  BOOST_CHECK(!frozenConstant.contains(4));
+
+  BOOST_CHECK_EQUAL(frozenColliding.getSize(), 100);
+  BOOST_CHECK_EQUAL(frozenColliding.getStashSize(), 84);
+  for (int i = 0; i < 100; ++i)
+    BOOST_CHECK_EQUAL(frozenColliding.valueOf(i), -i);
+  for (int i = 100; i < 200; ++i)
+    BOOST_CHECK(!frozenColliding.contains(i));
+  std::map<int, int> visited(frozenColliding.begin(), frozenColliding.end());
+  BOOST_CHECK_EQUAL(visited.size(), 100);
+}
+
+BOOST_AUTO_TEST_CASE(
+    GivenValuesWithOnlyEqualityOperator_WhenComparingMaps_ThenItIsUsed) {
+  using EqualityMap = aisdi::HashMap<int, EqualityOnly>;
+  EqualityMap first;
+  EqualityMap second;
+  first[1].m_value = 10;
+  second[1].m_value = 10;
+
+  BOOST_CHECK(first.freeze() == second.freeze());
+  second[1].m_value = 20;
+  BOOST_CHECK(first.freeze() != second.freeze());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
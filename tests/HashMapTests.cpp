@@ -1,9 +1,18 @@
 #include <HashMap.h>
+#include <ThreadPool.h>
 
+#include <cctype>
 #include <cstdint>
 #include <functional>
+#include <iterator>
 #include <map>
+#include <memory>
+#include <random>
+#include <set>
+#include <stdexcept>
 #include <string>
+#include <type_traits>
+#include <vector>
 
 #include <boost/test/unit_test.hpp>
 
@@ -89,8 +98,127 @@ struct Fixture {
   Fixture() { OperationCountingObject::resetCounters(); }
 };
 
+class HashCountingKey {
+ public:
+  HashCountingKey(int value_ = 0) : value(value_) {}
+
+  bool operator==(const HashCountingKey& other) const {
+    return value == other.value;
+  }
+
+  operator int() const { return value; }
+
+  static void resetCounter() { hashCalls = 0; }
+
+  static std::size_t hashCallsCount() { return hashCalls; }
+
+  static std::size_t hashCalls;
+
+ private:
+  int value;
+};
+
+std::size_t HashCountingKey::hashCalls = 0;
+
+class SeededHash {
+ public:
+  explicit SeededHash(std::size_t seed_ = 0) : seed(seed_) {}
+
+  std::size_t operator()(int key) const {
+    return std::hash<int>()(key) ^ seed;
+  }
+
+  std::size_t getSeed() const { return seed; }
+
+ private:
+  std::size_t seed;
+};
+
+struct CaseInsensitiveHash {
+  std::size_t operator()(const std::string& key) const {
+    std::size_t result = 0;
+    for (char c : key)
+      result = result * 31 + std::tolower(static_cast<unsigned char>(c));
+    return result;
+  }
+};
+
+// Sends every key to the same bucket, with the same hash.
+struct ConstantHash {
+  template <typename K>
+  std::size_t operator()(const K&) const {
+    return 42;
+  }
+};
+
+struct CaseInsensitiveEqual {
+  bool operator()(const std::string& lhs, const std::string& rhs) const {
+    if (lhs.size() != rhs.size())
+      return false;
+    for (std::size_t i = 0; i < lhs.size(); ++i)
+      if (std::tolower(static_cast<unsigned char>(lhs[i])) !=
+          std::tolower(static_cast<unsigned char>(rhs[i])))
+        return false;
+    return true;
+  }
+};
+
+// Allocator counting live allocations in a counter shared by all its copies.
+template <typename T>
+class CountingAllocator {
+ public:
+  using value_type = T;
+
+  explicit CountingAllocator(std::shared_ptr<std::ptrdiff_t> live_)
+      : live(std::move(live_)) {}
+
+  template <typename U>
+  CountingAllocator(const CountingAllocator<U>& other) : live(other.live) {}
+
+  T* allocate(std::size_t n) {
+    ++*live;
+    return std::allocator<T>().allocate(n);
+  }
+
+  void deallocate(T* p, std::size_t n) {
+    --*live;
+    std::allocator<T>().deallocate(p, n);
+  }
+
+  template <typename U>
+  bool operator==(const CountingAllocator<U>& other) const {
+    return live == other.live;
+  }
+
+  template <typename U>
+  bool operator!=(const CountingAllocator<U>& other) const {
+    return live != other.live;
+  }
+
+  std::shared_ptr<std::ptrdiff_t> live;
+};
+
+// Value that can only be compared with ==.
+struct EqualityOnly {
+  int m_value = 0;
+
+  bool operator==(const EqualityOnly& other) const {
+    return m_value == other.m_value;
+  }
+};
+
 }  // namespace
 
+namespace std {
+template <>
+struct hash<HashCountingKey> {
+  size_t operator()(const HashCountingKey& key) const {
+    ++HashCountingKey::hashCalls;
+    return std::hash<int>()(static_cast<int>(key));
+  }
+};
+}  // namespace std
+
 template <typename K>
 using Map = aisdi::HashMap<K, std::string>;
 
@@ -751,10 +879,917 @@ BOOST_AUTO_TEST_CASE_TEMPLATE(GivenTwoMapsWithDifferentKeys_WhenComparingThem_Th
  BOOST_CHECK(map != other);
 }
 
+BOOST_AUTO_TEST_CASE_TEMPLATE(
+    GivenEmptyMap_WhenAddingManyItems_ThenLoadFactorStaysBelowMaximum,
+    K,
+    TestedKeyTypes) {
+  Map<K> map;
+
+  for (int i = 0; i < 10000; ++i)
+    map[i] = std::to_string(i);
+
+  BOOST_CHECK_EQUAL(map.getSize(), 10000);
+  BOOST_CHECK_LE(map.getLoadFactor(), map.getMaxLoadFactor());
+  for (int i = 0; i < 10000; ++i)
+    BOOST_REQUIRE_EQUAL(map.valueOf(i), std::to_string(i));
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(
+    GivenLargeMap_WhenRemovingMostItems_ThenBucketTableShrinks,
+    K,
+    TestedKeyTypes) {
+  Map<K> map;
+  for (int i = 0; i < 10000; ++i)
+    map[i] = std::to_string(i);
+  const auto bucketCount = map.getBucketCount();
+
+  for (int i = 10; i < 10000; ++i)
+    map.remove(i);
+
+  BOOST_CHECK_LT(map.getBucketCount(), bucketCount);
+  thenMapContainsItems(map, {{0, "0"}, {1, "1"}, {2, "2"}, {3, "3"},
+                             {4, "4"}, {5, "5"}, {6, "6"}, {7, "7"},
+                             {8, "8"}, {9, "9"}});
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(
+    GivenReservedMap_WhenAddingReservedItems_ThenBucketCountDoesNotChange,
+    K,
+    TestedKeyTypes) {
+  Map<K> map;
+
+  map.reserve(1000);
+  const auto bucketCount = map.getBucketCount();
+  for (int i = 0; i < 1000; ++i)
+    map[i] = std::string{};
+
+  BOOST_CHECK_GE(bucketCount * map.getMaxLoadFactor(), 1000);
+  BOOST_CHECK_EQUAL(map.getBucketCount(), bucketCount);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(
+    GivenNonEmptyMap_WhenRehashing_ThenAllItemsAreStillInMap,
+    K,
+    TestedKeyTypes) {
+  Map<K> map = {{753, "Rome"}, {1789, "Paris"}, {1410, "Grunwald"}};
+
+  map.rehash(4096);
+  BOOST_CHECK_GE(map.getBucketCount(), 4096);
+  thenMapContainsItems(
+      map, {{753, "Rome"}, {1789, "Paris"}, {1410, "Grunwald"}});
+
+  map.rehash(0);
+  thenMapContainsItems(
+      map, {{753, "Rome"}, {1789, "Paris"}, {1410, "Grunwald"}});
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(
+    GivenNonEmptyMap_WhenLoweringMaxLoadFactor_ThenBucketCountGrows,
+    K,
+    TestedKeyTypes) {
+  Map<K> map;
+  for (int i = 0; i < 100; ++i)
+    map[i] = std::string{};
+  const auto bucketCount = map.getBucketCount();
+
+  map.setMaxLoadFactor(map.getMaxLoadFactor() / 4);
+
+  BOOST_CHECK_GT(map.getBucketCount(), bucketCount);
+  BOOST_CHECK_LE(map.getLoadFactor(), map.getMaxLoadFactor());
+  BOOST_CHECK_EQUAL(map.getSize(), 100);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(
+    GivenMap_WhenSettingNonPositiveMaxLoadFactor_ThenExceptionIsThrown,
+    K,
+    TestedKeyTypes) {
+  Map<K> map;
+
+  BOOST_CHECK_THROW(map.setMaxLoadFactor(0.0f), std::invalid_argument);
+  BOOST_CHECK_THROW(map.setMaxLoadFactor(-1.0f), std::invalid_argument);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(
+    GivenMapWithCollidingKeys_WhenIterating_ThenEveryItemIsVisitedOnce,
+    K,
+    TestedKeyTypes) {
+  Map<K> map;
+  for (int i = 0; i < 64; ++i)
+    map[i * 1024] = std::to_string(i);
+
+  std::map<K, std::string> visited;
+  for (auto it = map.begin(); it != map.end(); ++it)
+    BOOST_CHECK(visited.emplace(it->first, it->second).second);
+
+  BOOST_CHECK_EQUAL(visited.size(), 64);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(
+    GivenSparseMap_WhenIteratingBothWays_ThenEveryItemIsVisitedOnce,
+    K,
+    TestedKeyTypes) {
+  Map<K> map;
+  map.reserve(100000);
+  map[0] = "first";
+  map[70] = "middle";
+  map[99999] = "last";
+
+  std::map<K, std::string> forward;
+  for (auto it = map.begin(); it != map.end(); ++it)
+    BOOST_CHECK(forward.emplace(it->first, it->second).second);
+
+  std::map<K, std::string> backward;
+  for (auto it = map.end(); it != map.begin();) {
+    --it;
+    BOOST_CHECK(backward.emplace(it->first, it->second).second);
+  }
+
+  BOOST_CHECK_EQUAL(forward.size(), 3);
+  BOOST_CHECK(forward == backward);
+  BOOST_CHECK_THROW(--map.begin(), std::out_of_range);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(
+    GivenMap_WhenRemovingItemsWhileIterating_ThenOnlyThoseItemsAreRemoved,
+    K,
+    TestedKeyTypes) {
+  Map<K> map;
+  std::map<K, std::string> expected;
+  for (int i = 0; i < 1000; ++i) {
+    map[i] = std::to_string(i);
+    if (i % 3)
+      expected[i] = std::to_string(i);
+  }
+
+  for (auto it = map.begin(); it != map.end();) {
+    if (static_cast<int>(it->first) % 3 == 0)
+      it = map.remove(it);
+    else
+      ++it;
+  }
+
+  thenMapContainsItems(map, expected);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(
+    GivenSingleItemMap_WhenRemovingItemByIterator_ThenEndIsReturned,
+    K,
+    TestedKeyTypes) {
+  Map<K> map = {{42, "Alice"}};
+
+  BOOST_CHECK(map.remove(map.begin()) == map.end());
+}
+
+BOOST_AUTO_TEST_CASE(
+    GivenMap_WhenRehashingComparingOrErasing_ThenKeysAreNotHashed) {
+  aisdi::HashMap<HashCountingKey, int> map;
+  for (int i = 0; i < 1000; ++i)
+    map[i] = i;
+  const aisdi::HashMap<HashCountingKey, int> other{map};
+
+  HashCountingKey::resetCounter();
+  map.rehash(8192);
+  BOOST_CHECK(map == other);
+  for (auto it = map.begin(); it != map.end();)
+    it = map.remove(it);
+
+  BOOST_CHECK(map.isEmpty());
+  BOOST_CHECK_EQUAL(HashCountingKey::hashCallsCount(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(GivenStatefulHash_WhenCopyingMap_ThenHashIsCopied) {
+  aisdi::HashMap<int, std::string, SeededHash> map(0, SeededHash(12345));
+  map[42] = "Alice";
+
+  const auto other = map;
+
+  BOOST_CHECK_EQUAL(other.getHashFunction().getSeed(), 12345);
+  BOOST_CHECK_EQUAL(other.valueOf(42), "Alice");
+}
+
+BOOST_AUTO_TEST_CASE(GivenCustomKeyEqual_WhenSearchingForKey_ThenItIsUsed) {
+  aisdi::HashMap<std::string, int, CaseInsensitiveHash, CaseInsensitiveEqual>
+      map;
+  map["Alice"] = 1;
+  map["ALICE"] = 2;
+
+  BOOST_CHECK_EQUAL(map.getSize(), 1);
+  BOOST_CHECK_EQUAL(map.valueOf("alice"), 2);
+  BOOST_CHECK(map.find("bob") == map.end());
+}
+
+BOOST_AUTO_TEST_CASE(
+    GivenCustomAllocator_WhenMapIsDestroyed_ThenAllMemoryIsReturned) {
+  using Allocator = CountingAllocator<std::pair<const int, std::string>>;
+  auto live = std::make_shared<std::ptrdiff_t>(0);
+  {
+    aisdi::HashMap<int, std::string, std::hash<int>, std::equal_to<int>,
+                   Allocator>
+        map(0, std::hash<int>(), std::equal_to<int>(), Allocator(live));
+    for (int i = 0; i < 1000; ++i)
+      map[i] = std::to_string(i);
+    map.remove(0);
+
+    BOOST_CHECK_GT(*live, 0);
+  }
+
+  BOOST_CHECK_EQUAL(*live, 0);
+}
+
+BOOST_AUTO_TEST_CASE(
+    GivenMapUnderChurn_WhenInsertingAndRemoving_ThenNodesComeFromSlabs) {
+  using Allocator = CountingAllocator<std::pair<const int, std::string>>;
+  auto live = std::make_shared<std::ptrdiff_t>(0);
+  aisdi::HashMap<int, std::string, std::hash<int>, std::equal_to<int>,
+                 Allocator>
+      map(2048, std::hash<int>(), std::equal_to<int>(), Allocator(live));
+
+  for (int i = 0; i < 1000; ++i)
+    map[i] = std::to_string(i);
+  const std::ptrdiff_t afterInserts = *live;
+  for (int i = 0; i < 1000; ++i) {
+    map.remove(i);
+    map[i + 1000] = std::to_string(i);
+  }
+
+  BOOST_CHECK_LT(afterInserts, 16);
+  BOOST_CHECK_EQUAL(*live, afterInserts);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(
+    GivenManyKeys_WhenFindingThemInBatch_ThenResultsMatchSingleFind,
+    K,
+    TestedKeyTypes) {
+  Map<K> map;
+  for (int i = 0; i < 100; i += 2)
+    map[i] = std::to_string(i);
+  std::vector<K> keys;
+  for (int i = 99; i >= 0; --i)
+    keys.push_back(i);
+
+  std::vector<typename Map<K>::iterator> results;
+  map.findBatch(keys.data(), keys.size(), std::back_inserter(results));
+
+  BOOST_REQUIRE_EQUAL(results.size(), keys.size());
+  for (std::size_t i = 0; i < keys.size(); ++i)
+    BOOST_CHECK(results[i] == map.find(keys[i]));
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(
+    GivenManyKeys_WhenReadingValuesInBatch_ThenValuesAreInKeyOrder,
+    K,
+    TestedKeyTypes) {
+  const Map<K> map = {{42, "Alice"}, {27, "Bob"}, {753, "Rome"}};
+  const std::vector<K> keys = {753, 42, 27, 42};
+  const std::vector<K> withMissingKey = {42, 1, 27};
+
+  std::vector<std::string> values;
+  map.valueOfBatch(keys.data(), keys.size(), std::back_inserter(values));
+  std::vector<std::string> partial;
+
+  BOOST_CHECK(values ==
+              std::vector<std::string>({"Rome", "Alice", "Bob", "Alice"}));
+  BOOST_CHECK_THROW(map.valueOfBatch(withMissingKey.data(),
+                                     withMissingKey.size(),
+                                     std::back_inserter(partial)),
+                    std::out_of_range);
+  BOOST_CHECK(partial == std::vector<std::string>({"Alice"}));
+}
+
+BOOST_AUTO_TEST_CASE(
+    GivenEmptyMap_WhenTryEmplacingValue_ThenItIsConstructedInPlace) {
+  aisdi::HashMap<int, OperationCountingObject> map;
+
+  const auto result = map.tryEmplace(42, 7);
+
+  BOOST_CHECK(result.second);
+  BOOST_CHECK_EQUAL(result.first->second, 7);
+  BOOST_CHECK_EQUAL(OperationCountingObject::constructedObjectsCount(), 1);
+  BOOST_CHECK_EQUAL(OperationCountingObject::copiedObjectsCount(), 0);
+  BOOST_CHECK_EQUAL(OperationCountingObject::movedObjectsCount(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(
+    GivenExistingKey_WhenTryEmplacing_ThenNothingIsConstructedOrMoved) {
+  aisdi::HashMap<int, OperationCountingObject> map;
+  map.tryEmplace(42, 7);
+  OperationCountingObject value(8);
+  OperationCountingObject::resetCounters();
+
+  const auto result = map.tryEmplace(42, std::move(value));
+
+  BOOST_CHECK(!result.second);
+  BOOST_CHECK_EQUAL(result.first->second, 7);
+  BOOST_CHECK_EQUAL(OperationCountingObject::constructedObjectsCount(), 0);
+  BOOST_CHECK_EQUAL(OperationCountingObject::movedObjectsCount(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(
+    GivenRvalueValue_WhenInsertingOrAssigning_ThenItIsMovedNotCopied) {
+  aisdi::HashMap<int, OperationCountingObject> map;
+
+  BOOST_CHECK(map.insertOrAssign(42, OperationCountingObject(7)).second);
+  BOOST_CHECK(!map.insertOrAssign(42, OperationCountingObject(8)).second);
+
+  BOOST_CHECK_EQUAL(map.valueOf(42), 8);
+  BOOST_CHECK_EQUAL(OperationCountingObject::copiedObjectsCount(), 0);
+  BOOST_CHECK_EQUAL(OperationCountingObject::movedObjectsCount(), 2);
+  BOOST_CHECK_EQUAL(OperationCountingObject::assignedObjectsCount(), 1);
+}
+
+BOOST_AUTO_TEST_CASE(
+    GivenDuplicateKey_WhenEmplacing_ThenExistingItemIsKept) {
+  aisdi::HashMap<int, OperationCountingObject> map;
+
+  const auto inserted = map.emplace(42, 7);
+  const auto duplicate = map.emplace(42, 8);
+
+  BOOST_CHECK(inserted.second);
+  BOOST_CHECK(!duplicate.second);
+  BOOST_CHECK(inserted.first == duplicate.first);
+  BOOST_CHECK_EQUAL(map.valueOf(42), 7);
+  BOOST_CHECK_EQUAL(map.getSize(), 1);
+  BOOST_CHECK_EQUAL(OperationCountingObject::copiedObjectsCount(), 0);
+  BOOST_CHECK_EQUAL(OperationCountingObject::movedObjectsCount(), 0);
+  BOOST_CHECK_EQUAL(OperationCountingObject::destroyedObjectsCount(), 1);
+}
+
+BOOST_AUTO_TEST_CASE(
+    GivenMissingKey_WhenIndexing_ThenValueIsConstructedOnce) {
+  aisdi::HashMap<int, OperationCountingObject> map;
+
+  map[42] = 7;
+
+  BOOST_CHECK_EQUAL(map.valueOf(42), 7);
+  // The default value and the temporary assigned to it.
+  BOOST_CHECK_EQUAL(OperationCountingObject::constructedObjectsCount(), 2);
+  BOOST_CHECK_EQUAL(OperationCountingObject::copiedObjectsCount(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(
+    GivenHeavyRvalueKeyAndValue_WhenInserting_ThenBuffersAreTakenOver) {
+  aisdi::HashMap<std::string, std::vector<int>> map;
+  std::string key(100, 'k');
+  std::vector<int> value(1000, 1);
+  const char* keyData = key.data();
+  const int* valueData = value.data();
+
+  map.insertOrAssign(std::move(key), std::move(value));
+
+  const auto it = map.begin();
+  BOOST_CHECK(it->first.data() == keyData);
+  BOOST_CHECK(it->second.data() == valueData);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(
+    GivenRangeWithDuplicateKeys_WhenConstructingMap_ThenLastValuesWin,
+    K,
+    TestedKeyTypes) {
+  const std::vector<std::pair<K, std::string>> items = {
+      {42, "Chuck"}, {27, "Bob"}, {42, "Alice"}};
+
+  const Map<K> map(items.begin(), items.end());
+
+  thenMapContainsItems(map, {{42, "Alice"}, {27, "Bob"}});
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(
+    GivenNonEmptyMap_WhenInsertingLargeRange_ThenTableIsSizedOnce,
+    K,
+    TestedKeyTypes) {
+  Map<K> map = {{0, "zero"}, {5000, "five thousand"}};
+  std::map<K, std::string> items;
+  for (int i = 1; i <= 1000; ++i)
+    items[i] = std::to_string(i);
+  Map<K> expectedLayout;
+  expectedLayout.reserve(1002);
+
+  map.insert(items.begin(), items.end());
+
+  items[0] = "zero";
+  items[5000] = "five thousand";
+  thenMapContainsItems(map, items);
+  BOOST_CHECK_EQUAL(map.getBucketCount(), expectedLayout.getBucketCount());
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(
+    GivenIncrementalMap_WhenGrowing_ThenItemsAreFoundInBothTables,
+    K,
+    TestedKeyTypes) {
+  Map<K> map;
+  map.setIncrementalRehash(true);
+  std::map<K, std::string> expected;
+
+  for (int i = 0; !map.isRehashing() || map.getSize() < 1030; ++i) {
+    map[i] = std::to_string(i);
+    expected[i] = std::to_string(i);
+    BOOST_REQUIRE_LT(i, 10000);
+  }
+
+  BOOST_CHECK(map.isRehashing());
+  thenMapContainsItems(map, expected);
+  std::map<K, std::string> visited;
+  for (auto it = map.begin(); it != map.end(); ++it)
+    BOOST_CHECK(visited.emplace(it->first, it->second).second);
+  BOOST_CHECK(visited == expected);
+  std::map<K, std::string> backward;
+  for (auto it = map.end(); it != map.begin();) {
+    --it;
+    backward.emplace(it->first, it->second);
+  }
+  BOOST_CHECK(backward == expected);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(
+    GivenIncrementalMap_WhenInsertingAndRemovingRandomly_ThenItBehavesLikeStdMap,
+    K,
+    TestedKeyTypes) {
+  Map<K> map;
+  map.setIncrementalRehash(true);
+  std::map<K, std::string> expected;
+  std::mt19937 generator(2018);
+  std::uniform_int_distribution<int> keys(0, 3000);
+
+  for (int i = 0; i < 30000; ++i) {
+    const K key = keys(generator);
+    // Mostly inserts first and mostly removals later, so that the table
+    // both grows and shrinks.
+    if (generator() % 30000 > static_cast<unsigned>(i)) {
+      map[key] = std::to_string(i);
+      expected[key] = std::to_string(i);
+    } else if (expected.erase(key)) {
+      map.remove(key);
+    } else {
+      BOOST_REQUIRE(map.find(key) == map.end());
+    }
+  }
+
+  thenMapContainsItems(map, expected);
+  const Map<K> copy(map);
+  BOOST_CHECK(copy == map);
+  map.setIncrementalRehash(false);
+  BOOST_CHECK(!map.isRehashing());
+  thenMapContainsItems(map, expected);
+}
+
+BOOST_AUTO_TEST_CASE(
+    GivenIncrementalMap_WhenInsertingTriggersGrowth_ThenFewNodesAreMoved) {
+  aisdi::HashMap<int, int> map;
+  map.setIncrementalRehash(true);
+  for (int i = 0; !map.isRehashing() || map.getBucketCount() < 4096; ++i)
+    map[i] = i;
+  const auto bucketCount = map.getBucketCount();
+
+  int insertions = 0;
+  for (int i = -1; map.isRehashing(); --i, ++insertions)
+    map[i] = i;
+
+  // Each insertion drains only a few of the 2048 old buckets, and the table
+  // does not grow again before they are all drained.
+  BOOST_CHECK_GT(insertions, 100);
+  BOOST_CHECK_EQUAL(map.getBucketCount(), bucketCount);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(
+    GivenNonEmptyMap_WhenMoving_ThenElementsStayInPlace,
+    K,
+    TestedKeyTypes) {
+  Map<K> map = {{753, "Rome"}, {1789, "Paris"}};
+  const std::string* address = &map.valueOf(753);
+
+  Map<K> other(std::move(map));
+  Map<K> third;
+  third = std::move(other);
+
+  BOOST_CHECK(&third.valueOf(753) == address);
+  BOOST_CHECK(map.isEmpty());
+  BOOST_CHECK(other.isEmpty());
+  BOOST_CHECK(other.begin() == other.end());
+  BOOST_CHECK(other.find(753) == other.end());
+  BOOST_CHECK_THROW(other.remove(753), std::out_of_range);
+  map[1410] = "Grunwald";
+  thenMapContainsItems(map, {{1410, "Grunwald"}});
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(
+    GivenTwoMaps_WhenSwappingThem_ThenContentsAndSettingsAreExchanged,
+    K,
+    TestedKeyTypes) {
+  Map<K> map = {{753, "Rome"}, {1789, "Paris"}};
+  Map<K> other = {{42, "Alice"}};
+  other.setMaxLoadFactor(0.5f);
+  const std::string* address = &map.valueOf(753);
+
+  swap(map, other);
+
+  thenMapContainsItems(map, {{42, "Alice"}});
+  thenMapContainsItems(other, {{753, "Rome"}, {1789, "Paris"}});
+  BOOST_CHECK(&other.valueOf(753) == address);
+  BOOST_CHECK_EQUAL(map.getMaxLoadFactor(), 0.5f);
+  BOOST_CHECK_EQUAL(other.getMaxLoadFactor(), 1.0f);
+}
+
+BOOST_AUTO_TEST_CASE(
+    GivenVectorOfMaps_WhenItGrows_ThenMapsAreMovedIntact) {
+  using StringMap = aisdi::HashMap<int, std::string>;
+  BOOST_CHECK(std::is_nothrow_move_constructible<StringMap>::value);
+  std::vector<StringMap> maps;
+
+  for (int i = 0; i < 100; ++i) {
+    maps.emplace_back();
+    maps.back()[i] = std::to_string(i);
+  }
+
+  for (int i = 0; i < 100; ++i) {
+    BOOST_REQUIRE_EQUAL(maps[i].getSize(), 1);
+    BOOST_REQUIRE_EQUAL(maps[i].valueOf(i), std::to_string(i));
+  }
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(
+    GivenSameKeysInDifferentOrder_WhenComparingFingerprints_ThenTheyAreEqual,
+    K,
+    TestedKeyTypes) {
+  Map<K> map = {{753, "Rome"}, {1789, "Paris"}, {1410, "Grunwald"}};
+  Map<K> other({{1410, "Grunwald"}, {753, "Rome"}}, HASHMAP_MIN_BUCKET_COUNT,
+                map.getHashFunction());
+  const auto partial = other.getFingerprint();
+
+  other[1789] = "Paris";
+
+  BOOST_CHECK_EQUAL(map.getFingerprint(), other.getFingerprint());
+  BOOST_CHECK(map == other);
+  other.remove(1789);
+  BOOST_CHECK_EQUAL(other.getFingerprint(), partial);
+  other[1791] = "Warsaw";
+  BOOST_CHECK_NE(map.getFingerprint(), other.getFingerprint());
+  BOOST_CHECK(map != other);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(
+    GivenLargeMaps_WhenComparingInParallel_ThenResultMatchesOperatorEquals,
+    K,
+    TestedKeyTypes) {
+  Map<K> map;
+  for (int i = 0; i < 4 * HASHMAP_PARALLEL_GRAIN; ++i)
+    map[i] = std::to_string(i);
+  Map<K> other(map.begin(), map.end());
+  aisdi::ThreadPool pool(4);
+
+  BOOST_CHECK(map.parallelEquals(other, pool));
+  BOOST_CHECK(other.parallelEquals(map, pool));
+
+  other[3 * HASHMAP_PARALLEL_GRAIN] = "changed";
+  BOOST_CHECK(!map.parallelEquals(other, pool));
+  BOOST_CHECK(!(map == other));
+
+  other[3 * HASHMAP_PARALLEL_GRAIN] =
+      std::to_string(3 * HASHMAP_PARALLEL_GRAIN);
+  other.setIncrementalRehash(true);
+  for (int i = 4 * HASHMAP_PARALLEL_GRAIN; !other.isRehashing(); ++i)
+    other[i] = std::to_string(i);
+  for (std::size_t i = 4 * HASHMAP_PARALLEL_GRAIN; i < other.getSize(); ++i)
+    map[i] = std::to_string(i);
+  BOOST_CHECK(map.parallelEquals(other, pool));
+  BOOST_CHECK(other.parallelEquals(map, pool));
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(
+    GivenLargeMap_WhenVisitingInParallel_ThenEveryItemIsVisitedOnce,
+    K,
+    TestedKeyTypes) {
+  aisdi::HashMap<K, int> map;
+  for (int i = 0; i < 4 * HASHMAP_PARALLEL_GRAIN; ++i)
+    map[i] = i;
+  aisdi::ThreadPool pool(4);
+
+  map.parallelForEach(
+      [](std::pair<const K, int>& item) { item.second = -item.second; },
+      pool);
+
+  for (int i = 0; i < 4 * HASHMAP_PARALLEL_GRAIN; ++i)
+    BOOST_REQUIRE_EQUAL(map.valueOf(i), -i);
+}
+
+BOOST_AUTO_TEST_CASE(
+    GivenLargeMap_WhenReducingInParallel_ThenResultMatchesSequentialSum) {
+  aisdi::HashMap<int, long long> map;
+  long long expected = 0;
+  for (int i = 0; i < 4 * HASHMAP_PARALLEL_GRAIN; ++i) {
+    map[i] = 3 * i;
+    expected += 3 * i;
+  }
+  aisdi::ThreadPool pool(4);
+
+  const long long sum = map.parallelReduce(
+      0LL, [](const std::pair<const int, long long>& item) {
+        return item.second;
+      }, std::plus<long long>(), pool);
+  const std::size_t count = aisdi::HashMap<int, long long>().parallelReduce(
+      std::size_t(0), [](const std::pair<const int, long long>&) {
+        return std::size_t(1);
+      }, std::plus<std::size_t>(), pool);
+
+  BOOST_CHECK_EQUAL(sum, expected);
+  BOOST_CHECK_EQUAL(count, 0);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(
+    GivenLargeMap_WhenRemovingInParallel_ThenOnlyMatchingItemsAreRemoved,
+    K,
+    TestedKeyTypes) {
+  Map<K> map;
+  Map<K> expected(0, map.getHashFunction());
+  for (int i = 0; i < 4 * HASHMAP_PARALLEL_GRAIN; ++i) {
+    map[i] = std::to_string(i);
+    if (i % 3)
+      expected[i] = std::to_string(i);
+  }
+  aisdi::ThreadPool pool(4);
+
+  const std::size_t removed = map.parallelRemoveIf(
+      [](const std::pair<const K, std::string>& item) {
+        return std::stoi(item.second) % 3 == 0;
+      },
+      pool);
+
+  BOOST_CHECK_EQUAL(removed, 4 * HASHMAP_PARALLEL_GRAIN - expected.getSize());
+  BOOST_CHECK_EQUAL(map.getSize(), expected.getSize());
+  BOOST_CHECK_EQUAL(map.getFingerprint(), expected.getFingerprint());
+  BOOST_CHECK(map == expected);
+  BOOST_CHECK_EQUAL(std::distance(map.begin(), map.end()), map.getSize());
+}
+
+BOOST_AUTO_TEST_CASE(
+    GivenThrowingPredicate_WhenRemovingInParallel_ThenMapStaysConsistent) {
+  aisdi::HashMap<int, int> map;
+  for (int i = 0; i < 4 * HASHMAP_PARALLEL_GRAIN; ++i)
+    map[i] = i;
+  aisdi::ThreadPool pool(4);
+
+  BOOST_CHECK_THROW(map.parallelRemoveIf(
+                        [](const std::pair<const int, int>& item) {
+                          if (item.first == HASHMAP_PARALLEL_GRAIN)
+                            throw std::runtime_error("Unexpected key");
+                          return item.first % 2 == 0;
+                        },
+                        pool),
+                    std::runtime_error);
+
+  std::size_t count = 0;
+  for (const auto& item : map) {
+    BOOST_REQUIRE_EQUAL(map.valueOf(item.first), item.second);
+    ++count;
+  }
+  BOOST_CHECK_EQUAL(count, map.getSize());
+  BOOST_CHECK(map.find(HASHMAP_PARALLEL_GRAIN) != map.end());
+}
+
+BOOST_AUTO_TEST_CASE(
+    GivenDifferentlySeededHashes_WhenComparingEqualMaps_ThenTheyAreEqual) {
+  using SeededMap = aisdi::HashMap<int, std::string, SeededHash>;
+  SeededMap map(0, SeededHash(1));
+  SeededMap other(0, SeededHash(2));
+  map[42] = "Alice";
+  other[42] = "Alice";
+
+  BOOST_CHECK_NE(map.getFingerprint(), other.getFingerprint());
+  BOOST_CHECK(map == other);
+  BOOST_CHECK(map.parallelEquals(other));
+}
+
+BOOST_AUTO_TEST_CASE(
+    GivenStridedIntegerKeys_WhenHashing_ThenLowBitsAreSpread) {
+  const aisdi::KeyedHash<int> hash;
+  std::set<std::size_t> buckets;
+
+  for (int i = 0; i < 1024; ++i)
+    buckets.insert(hash(i * 8192) & 1023);
+
+  BOOST_CHECK_GT(buckets.size(), 512);
+}
+
+BOOST_AUTO_TEST_CASE(
+    GivenDifferentSeeds_WhenHashingStrings_ThenOnlyEqualSeedsAgree) {
+  const aisdi::KeyedHash<std::string> hash;
+  const aisdi::KeyedHash<std::string> other;
+  const aisdi::KeyedHash<std::string> seeded(42);
+  std::set<std::size_t> hashes;
+
+  std::string key;
+  for (int i = 0; i < 40; ++i, key += 'a')
+    hashes.insert(hash(key));
+
+  BOOST_CHECK_EQUAL(hashes.size(), 40);
+  BOOST_CHECK(hash != other);
+  BOOST_CHECK_NE(hash("Alice"), other("Alice"));
+  BOOST_CHECK_EQUAL(seeded("Alice"),
+                    aisdi::KeyedHash<std::string>(42)("Alice"));
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(
+    GivenMapCopy_WhenComparing_ThenItSharesHashFunctionAndFingerprint,
+    K,
+    TestedKeyTypes) {
+  Map<K> map = {{753, "Rome"}, {1789, "Paris"}};
+  Map<K> copy(map);
+  Map<K> other = {{753, "Rome"}, {1789, "Paris"}};
+
+  BOOST_CHECK(copy.getHashFunction() == map.getHashFunction());
+  BOOST_CHECK_EQUAL(copy.getFingerprint(), map.getFingerprint());
+  BOOST_CHECK(other.getHashFunction() != map.getHashFunction());
+  BOOST_CHECK(other == map);
+}
+
+BOOST_AUTO_TEST_CASE(
+    GivenIndependentlyBuiltMaps_WhenComparing_ThenFingerprintsAgree) {
+  aisdi::HashMap<std::string, int> map;
+  aisdi::HashMap<std::string, int> other;
+  for (int i = 0; i < 1000; ++i) {
+    map[std::to_string(i)] = i;
+    other[std::to_string(999 - i)] = 999 - i;
+  }
+
+  BOOST_CHECK(other.getHashFunction() != map.getHashFunction());
+  BOOST_CHECK_EQUAL(map.getFingerprint(), other.getFingerprint());
+  BOOST_CHECK(map == other);
+  other.remove("0");
+  other["1000"] = 0;
+  BOOST_CHECK_NE(map.getFingerprint(), other.getFingerprint());
+  BOOST_CHECK(map != other);
+  BOOST_CHECK(!map.parallelEquals(other));
+
+  aisdi::HashMap<HashCountingKey, int> hashed;
+  aisdi::HashMap<HashCountingKey, int> otherHashed;
+  for (int i = 0; i < 1000; ++i) {
+    hashed[i] = i;
+    otherHashed[999 - i] = 999 - i;
+  }
+  BOOST_CHECK_EQUAL(hashed.getFingerprint(), otherHashed.getFingerprint());
+}
+
+BOOST_AUTO_TEST_CASE(
+    GivenSmallMap_WhenFillingItUp_ThenTableIsAllocatedOnlyOnOverflow) {
+  using Allocator = CountingAllocator<std::pair<const int, std::string>>;
+  auto live = std::make_shared<std::ptrdiff_t>(0);
+  aisdi::HashMap<int, std::string, std::hash<int>, std::equal_to<int>,
+                 Allocator>
+      map(0, std::hash<int>(), std::equal_to<int>(), Allocator(live));
+
+  BOOST_CHECK_EQUAL(*live, 0);
+  map[0] = "0";
+  // A single node slab and the list of slabs.
+  BOOST_CHECK_EQUAL(*live, 2);
+  for (int i = 1; i < HASHMAP_SMALL_SIZE; ++i)
+    map[i * 8192] = std::to_string(i);
+  BOOST_CHECK_EQUAL(map.getBucketCount(), 0);
+
+  map[-1] = "overflow";
+
+  BOOST_CHECK_GT(map.getBucketCount(), HASHMAP_SMALL_SIZE);
+  BOOST_CHECK_EQUAL(map.valueOf(-1), "overflow");
+  for (int i = 0; i < HASHMAP_SMALL_SIZE; ++i)
+    BOOST_CHECK_EQUAL(map.valueOf(i * 8192), std::to_string(i));
+}
+
+BOOST_AUTO_TEST_CASE(
+    GivenManySmallRanges_WhenInsertingThem_ThenNodeSlabsGrowGeometrically) {
+  using Allocator = CountingAllocator<std::pair<const int, std::string>>;
+  auto live = std::make_shared<std::ptrdiff_t>(0);
+  aisdi::HashMap<int, std::string, std::hash<int>, std::equal_to<int>,
+                 Allocator>
+      map(0, std::hash<int>(), std::equal_to<int>(), Allocator(live));
+
+  for (int i = 0; i < 3000; i += 3) {
+    const std::vector<std::pair<int, std::string>> items = {
+        {i, "a"}, {i + 1, "b"}, {i + 2, "c"}};
+    map.insert(items.begin(), items.end());
+  }
+
+  BOOST_CHECK_EQUAL(map.getSize(), 3000);
+  BOOST_CHECK_EQUAL(map.valueOf(2999), "c");
+  // About a dozen node slabs, the list of slabs and the tables.
+  BOOST_CHECK_LT(*live, 40);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(
+    GivenSmallMap_WhenIteratingAndRemoving_ThenItBehavesLikeLargeOne,
+    K,
+    TestedKeyTypes) {
+  Map<K> map = {{753, "Rome"}, {1789, "Paris"}, {1410, "Grunwald"}};
+  BOOST_REQUIRE_EQUAL(map.getBucketCount(), 0);
+
+  std::map<K, std::string> visited(map.begin(), map.end());
+  auto last = map.end();
+  --last;
+  BOOST_CHECK_EQUAL(visited.size(), 3);
+  BOOST_CHECK_EQUAL(visited.count(last->first), 1);
+  const auto next = map.remove(map.find(1789));
+  BOOST_CHECK(next == map.end() || next->first != 1789);
+
+  Map<K> moved(std::move(map));
+  Map<K> copy(moved);
+  copy.remove(753);
+
+  BOOST_CHECK_EQUAL(std::distance(moved.begin(), moved.end()), 2);
+  thenMapContainsItems(moved, {{753, "Rome"}, {1410, "Grunwald"}});
+  thenMapContainsItems(copy, {{1410, "Grunwald"}});
+  BOOST_CHECK_EQUAL(copy.getBucketCount(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(
+    GivenKeysWithEqualHashes_WhenFindingAndRemovingThem_ThenMapStaysCorrect) {
+  aisdi::HashMap<int, std::string, ConstantHash> map;
+  for (int i = 0; i < 1000; ++i)
+    map[i * 7 % 1000] = std::to_string(i * 7 % 1000);
+
+  for (int i = 0; i < 1000; ++i)
+    BOOST_CHECK_EQUAL(map.valueOf(i), std::to_string(i));
+  BOOST_CHECK(map.find(1000) == map.end());
+  BOOST_CHECK_EQUAL(std::distance(map.begin(), map.end()), 1000);
+
+  for (int i = 0; i < 1000; ++i)
+    if (i % 100)
+      map.remove(i);
+
+  BOOST_CHECK_EQUAL(map.getSize(), 10);
+  for (int i = 0; i < 1000; ++i)
+    BOOST_CHECK_EQUAL(map.find(i) != map.end(), i % 100 == 0);
+  map[5] = "5";
+  BOOST_CHECK_EQUAL(map.valueOf(5), "5");
+}
+
+BOOST_AUTO_TEST_CASE(
+    GivenCollidingKeysWithoutOrder_WhenFindingThem_ThenEqualityDecides) {
+  aisdi::HashMap<std::string, int, ConstantHash, CaseInsensitiveEqual> map;
+  for (int i = 0; i < 100; ++i)
+    map["Key" + std::to_string(i)] = i;
+
+  for (int i = 0; i < 100; ++i)
+    BOOST_CHECK_EQUAL(map.valueOf("KEY" + std::to_string(i)), i);
+  BOOST_CHECK(map.find("key100") == map.end());
+
+  for (int i = 0; i < 100; i += 2)
+    map.remove("key" + std::to_string(i));
+
+  BOOST_CHECK_EQUAL(map.getSize(), 50);
+  for (int i = 0; i < 100; ++i)
+    BOOST_CHECK_EQUAL(map.find("key" + std::to_string(i)) != map.end(),
+                      i % 2 == 1);
+}
+
+BOOST_AUTO_TEST_CASE(
+    GivenKeysSharingLowHashBits_WhenTableIsResized_ThenAllKeysAreFound) {
+  aisdi::HashMap<int, int, std::hash<int>> map;
+  map.setIncrementalRehash(true);
+  for (int i = 0; i < 2000; ++i) {
+    map[i << 16] = i;
+    if (i % 500 == 0)
+      BOOST_CHECK_EQUAL(map.valueOf(0), 0);
+  }
+  for (int i = 0; i < 2000; ++i)
+    BOOST_CHECK_EQUAL(map.valueOf(i << 16), i);
+
+  const aisdi::HashMap<int, int, std::hash<int>> copy(map);
+  map.parallelRemoveIf(
+      [](const std::pair<const int, int>& item) { return item.second % 3; });
+  while (map.getSize() > 10)
+    map.remove(map.begin());
+
+  BOOST_CHECK(copy.find(1999 << 16) != copy.end());
+  BOOST_CHECK_EQUAL(copy.getSize(), 2000);
+  for (const auto& item : map)
+    BOOST_CHECK_EQUAL(map.valueOf(item.first), item.second);
+  BOOST_CHECK_EQUAL(std::distance(map.begin(), map.end()), 10);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(
+    GivenIteratorsToDifferentItems_WhenComparingThem_ThenTheyAreNotEqual,
+    K,
+    TestedKeyTypes) {
+  Map<K> map = {{42, "Alice"}, {27, "Bob"}};
+
+  BOOST_CHECK(map.find(42) != map.find(27));
+  BOOST_CHECK(map.find(42) == map.find(42));
+}
+
 // ConstIterator is tested via Iterator methods.
 // If Iterator methods are to be changed, then new ConstIterator tests are
 // required.
 
+BOOST_AUTO_TEST_CASE(
+    GivenValuesWithOnlyEqualityOperator_WhenComparingMaps_ThenItIsUsed) {
+  using EqualityMap = aisdi::HashMap<int, EqualityOnly>;
+  EqualityMap first;
+  EqualityMap second;
+  first[1].m_value = 10;
+  second[1].m_value = 10;
+
+  BOOST_CHECK(first == second);
+  second[1].m_value = 20;
+  BOOST_CHECK(first != second);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 
 namespace std {
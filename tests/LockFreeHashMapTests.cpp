@@ -0,0 +1,150 @@
+#include <LockFreeHashMap.h>
+
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+#include <boost/mpl/list.hpp>
+
+template <typename K>
+using Map = aisdi::LockFreeHashMap<K, std::string>;
+
+using TestedKeyTypes = boost::mpl::list<std::int32_t, std::uint64_t>;
+
+BOOST_AUTO_TEST_SUITE(LockFreeHashMapTests)
+
+template <typename K>
+void thenMapContainsItems(const Map<K>& map,
+                          const std::map<K, std::string>& expected) {
+  BOOST_CHECK_EQUAL(map.getSize(), expected.size());
+
+  for (const auto& item : expected) {
+    std::string value;
+    BOOST_REQUIRE_MESSAGE(map.tryGet(item.first, value),
+                          "Missing required item with key: " << item.first);
+    BOOST_CHECK_MESSAGE(value == item.second,
+                        "Wrong value in map for key: "
+                            << item.first << " (expected: \"" << item.second
+                            << "\" got: \"" << value << "\")");
+  }
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(
+    GivenMap_WhenCreatedWithDefaultConstructor_ThenItIsEmpty,
+    K,
+    TestedKeyTypes) {
+  const Map<K> map;
+
+  BOOST_CHECK(map.isEmpty());
+  BOOST_CHECK(!map.contains(1));
+  BOOST_CHECK_THROW(map.valueOf(1), std::out_of_range);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(
+    GivenMap_WhenInsertingOrAssigning_ThenNewKeysAreReported,
+    K,
+    TestedKeyTypes) {
+  Map<K> map;
+
+  BOOST_CHECK(map.insertOrAssign(42, "Chuck"));
+  BOOST_CHECK(!map.insertOrAssign(42, "Alice"));
+  BOOST_CHECK(map.insertOrAssign(27, "Bob"));
+
+  thenMapContainsItems(map, {{42, "Alice"}, {27, "Bob"}});
+  BOOST_CHECK_EQUAL(map.valueOf(42), "Alice");
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(
+    GivenNotEmptyMap_WhenRemovingValueByKey_ThenItemIsRemoved,
+    K,
+    TestedKeyTypes) {
+  Map<K> map = {{42, "Alice"}, {27, "Bob"}};
+
+  map.remove(27);
+
+  thenMapContainsItems(map, {{42, "Alice"}});
+  BOOST_CHECK_THROW(map.remove(27), std::out_of_range);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(
+    GivenMap_WhenAddingManyItems_ThenTableGrowsAndKeepsThem,
+    K,
+    TestedKeyTypes) {
+  Map<K> map;
+  std::map<K, std::string> expected;
+  for (int i = 0; i < 1000; ++i) {
+    map.insertOrAssign(i, std::to_string(i));
+    expected[i] = std::to_string(i);
+  }
+
+  std::map<K, std::string> visited;
+  map.forEach([&visited](const std::pair<const K, std::string>& item) {
+    visited.insert(item);
+  });
+
+  BOOST_CHECK_GE(map.getBucketCount(), 1000);
+  thenMapContainsItems(map, expected);
+  BOOST_CHECK(visited == expected);
+}
+
+// Readers check that every value they see belongs to its key while a writer
+// keeps replacing, removing and re-inserting the same keys, so that freed
+// nodes would show up as garbage values or as sanitizer reports.
+BOOST_AUTO_TEST_CASE_TEMPLATE(
+    GivenReadersAndWriter_WhenRunningConcurrently_ThenReadersSeeOnlyValidValues,
+    K,
+    TestedKeyTypes) {
+  const int keyCount = 256;
+  Map<K> map;
+  for (int i = 0; i < keyCount; ++i)
+    map.insertOrAssign(i, std::to_string(i) + ":0");
+
+  std::atomic<bool> done(false);
+  std::atomic<int> mismatches(0);
+  std::atomic<long> reads(0);
+  auto reader = [&]() {
+    long found = 0;
+    while (!done.load()) {
+      for (int i = 0; i < keyCount; ++i) {
+        std::string value;
+        if (!map.tryGet(i, value))
+          continue;
+        ++found;
+        if (value.substr(0, value.find(':')) != std::to_string(i))
+          ++mismatches;
+      }
+    }
+    reads += found;
+  };
+
+  std::vector<std::thread> readers;
+  for (int i = 0; i < 3; ++i)
+    readers.emplace_back(reader);
+
+  for (int round = 1; round <= 200; ++round) {
+    for (int i = 0; i < keyCount; ++i) {
+      if ((i + round) % 5 == 0)
+        map.remove(i);
+      else
+        map.insertOrAssign(i, std::to_string(i) + ":" + std::to_string(round));
+    }
+    for (int i = 0; i < keyCount; ++i) {
+      if ((i + round) % 5 == 0)
+        map.insertOrAssign(i, std::to_string(i) + ":" + std::to_string(round));
+    }
+  }
+  done = true;
+  for (auto& thread : readers)
+    thread.join();
+
+  BOOST_CHECK_EQUAL(mismatches.load(), 0);
+  BOOST_CHECK_GT(reads.load(), 0);
+  BOOST_CHECK_EQUAL(map.getSize(), keyCount);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
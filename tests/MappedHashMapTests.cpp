@@ -0,0 +1,183 @@
+#include <HashMap.h>
+#include <MappedHashMap.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <stdexcept>
+#include <string>
+
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <boost/test/unit_test.hpp>
+
+namespace {
+
+struct Point {
+  double x;
+  double y;
+};
+
+// Unique file name, removed again at the end of the test.
+class TemporaryFile {
+ public:
+  TemporaryFile() {
+    char name[] = "/tmp/aisdiMapsXXXXXX";
+    const int fd = mkstemp(name);
+    BOOST_REQUIRE(fd >= 0);
+    close(fd);
+    path = name;
+  }
+
+  ~TemporaryFile() { std::remove(path.c_str()); }
+
+  std::string path;
+};
+
+// Overwrites the 64-bit word at `offset` of the file at `path`, returning
+// its previous value.
+std::uint64_t patchWord(const std::string& path,
+                        std::uint64_t offset,
+                        std::uint64_t value) {
+  std::fstream file(path, std::ios::in | std::ios::out | std::ios::binary);
+  std::uint64_t previous = 0;
+  file.seekg(offset);
+  file.read(reinterpret_cast<char*>(&previous), sizeof(previous));
+  file.seekp(offset);
+  file.write(reinterpret_cast<const char*>(&value), sizeof(value));
+  BOOST_REQUIRE(file);
+  return previous;
+}
+
+}  // namespace
+
+BOOST_AUTO_TEST_SUITE(MappedHashMapTests)
+
+BOOST_AUTO_TEST_CASE(GivenImageOfMap_WhenMappingIt_ThenItHoldsTheSameItems) {
+  aisdi::HashMap<std::int64_t, std::int32_t> map;
+  for (std::int64_t i = 0; i < 10000; ++i)
+    map[i * 37] = static_cast<std::int32_t>(i);
+  TemporaryFile file;
+
+  using Mapped = aisdi::MappedHashMap<std::int64_t, std::int32_t>;
+  Mapped::writeImage(map, file.path);
+  const Mapped mapped(file.path);
+
+  BOOST_CHECK_EQUAL(mapped.getSize(), 10000);
+  BOOST_CHECK(mapped.getHashFunction() == map.getHashFunction());
+  for (std::int64_t i = 0; i < 10000; ++i)
+    BOOST_CHECK_EQUAL(mapped.valueOf(i * 37), i);
+  BOOST_CHECK(mapped.find(1) == mapped.end());
+  BOOST_CHECK(!mapped.contains(1));
+  BOOST_CHECK_THROW(mapped.valueOf(1), std::out_of_range);
+
+  std::map<std::int64_t, std::int32_t> visited;
+  for (const auto& item : mapped)
+    visited[item.first] = item.second;
+  BOOST_CHECK_EQUAL(visited.size(), 10000);
+  BOOST_CHECK_EQUAL(visited[37 * 9999], 9999);
+}
+
+BOOST_AUTO_TEST_CASE(GivenImage_WhenMappingItTwice_ThenBothViewsOutliveTheMap) {
+  TemporaryFile file;
+  using Mapped = aisdi::MappedHashMap<int, Point, std::hash<int>>;
+  {
+    aisdi::HashMap<int, Point, std::hash<int>> map;
+    map[1] = Point{1.5, -2.0};
+    map[8] = Point{3.0, 4.0};
+    Mapped::writeImage(map, file.path);
+  }
+
+  const Mapped first(file.path);
+  Mapped second(file.path);
+  const Mapped moved(std::move(second));
+
+  BOOST_CHECK_EQUAL(first.valueOf(1).x, 1.5);
+  BOOST_CHECK_EQUAL(moved.valueOf(8).y, 4.0);
+  BOOST_CHECK(&first.valueOf(1) != &moved.valueOf(1));
+  BOOST_CHECK(second.isEmpty());
+}
+
+BOOST_AUTO_TEST_CASE(
+    GivenMappedImage_WhenRewritingIt_ThenOpenViewKeepsTheOldImage) {
+  TemporaryFile file;
+  using Mapped = aisdi::MappedHashMap<int, int>;
+  aisdi::HashMap<int, int> map;
+  for (int i = 0; i < 10000; ++i)
+    map[i] = i;
+  Mapped::writeImage(map, file.path);
+  const Mapped old(file.path);
+
+  Mapped::writeImage(aisdi::HashMap<int, int>{{1, -1}}, file.path);
+  const Mapped current(file.path);
+
+  BOOST_CHECK_EQUAL(old.getSize(), 10000);
+  for (int i = 0; i < 10000; ++i)
+    BOOST_CHECK_EQUAL(old.valueOf(i), i);
+  BOOST_CHECK_EQUAL(current.getSize(), 1);
+  BOOST_CHECK_EQUAL(current.valueOf(1), -1);
+  BOOST_CHECK_THROW(Mapped::writeImage(map, file.path + ".missing/image"),
+                    std::runtime_error);
+}
+
+BOOST_AUTO_TEST_CASE(GivenEmptyMap_WhenMappingItsImage_ThenViewIsEmpty) {
+  TemporaryFile file;
+  using Mapped = aisdi::MappedHashMap<int, int>;
+  Mapped::writeImage(aisdi::HashMap<int, int>(), file.path);
+
+  const Mapped mapped(file.path);
+
+  BOOST_CHECK(mapped.isEmpty());
+  BOOST_CHECK(mapped.begin() == mapped.end());
+  BOOST_CHECK(mapped.find(0) == mapped.end());
+}
+
+BOOST_AUTO_TEST_CASE(GivenBadFile_WhenMappingIt_ThenOperationThrows) {
+  using Mapped = aisdi::MappedHashMap<int, int>;
+  using OtherMapped = aisdi::MappedHashMap<int, std::int64_t>;
+  TemporaryFile file;
+  aisdi::HashMap<int, int> map = {{1, 2}, {3, 4}};
+  Mapped::writeImage(map, file.path);
+
+  BOOST_CHECK_THROW(OtherMapped(file.path), std::runtime_error);
+  BOOST_CHECK_THROW(Mapped(file.path + ".missing"), std::runtime_error);
+  BOOST_REQUIRE_EQUAL(truncate(file.path.c_str(), 100), 0);
+  BOOST_CHECK_THROW(Mapped(file.path), std::runtime_error);
+  std::ofstream(file.path, std::ios::trunc) << "not an image";
+  BOOST_CHECK_THROW(Mapped(file.path), std::runtime_error);
+}
+
+BOOST_AUTO_TEST_CASE(GivenCorruptOffsets_WhenMappingImage_ThenItIsRejected) {
+  using Mapped = aisdi::MappedHashMap<int, int>;
+  // Where the header keeps the offsets of the bucket and entry sections.
+  const std::uint64_t bucketsOffsetField = 48;
+  const std::uint64_t entriesOffsetField = 64;
+  TemporaryFile file;
+  aisdi::HashMap<int, int> map;
+  for (int i = 0; i < 100; ++i)
+    map[i] = i;
+  Mapped::writeImage(map, file.path);
+
+  const std::uint64_t bucketsOffset =
+      patchWord(file.path, bucketsOffsetField, 0);
+  patchWord(file.path, bucketsOffsetField, bucketsOffset);
+  // The bound between the first two buckets, past the size, then above the
+  // bounds after it.
+  const std::uint64_t bound = patchWord(file.path, bucketsOffset + 8, 1000);
+  BOOST_CHECK_THROW(Mapped(file.path), std::runtime_error);
+  patchWord(file.path, bucketsOffset + 8, 100);
+  BOOST_CHECK_THROW(Mapped(file.path), std::runtime_error);
+  patchWord(file.path, bucketsOffset + 8, bound);
+  BOOST_CHECK_EQUAL(Mapped(file.path).valueOf(42), 42);
+
+  const std::uint64_t entriesOffset =
+      patchWord(file.path, entriesOffsetField, ~std::uint64_t(63));
+  BOOST_CHECK_THROW(Mapped(file.path), std::runtime_error);
+  patchWord(file.path, entriesOffsetField, entriesOffset + 1);
+  BOOST_CHECK_THROW(Mapped(file.path), std::runtime_error);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,417 @@
+#include <RobinHoodHashMap.h>
+
+#include <cstdint>
+#include <map>
+#include <random>
+#include <stdexcept>
+#include <string>
+
+#include <boost/test/unit_test.hpp>
+
+#include <boost/mpl/list.hpp>
+
+template <typename K>
+using Map = aisdi::RobinHoodHashMap<K, std::string>;
+
+using TestedKeyTypes = boost::mpl::list<std::int32_t, std::uint64_t>;
+
+using std::begin;
+using std::end;
+
+namespace {
+
+// Value whose constructors throw once a shared budget runs out, or just
+// once, after a set number of constructions.
+struct Fragile {
+  static int s_budget;
+  static int s_failAfter;
+
+  Fragile() { spend(); }
+
+  Fragile(const Fragile& other) : m_text(other.m_text) { spend(); }
+
+  Fragile& operator=(const Fragile&) = default;
+
+  static void spend() {
+    if (!s_budget)
+      throw std::runtime_error("Out of constructions");
+    if (s_budget > 0)
+      --s_budget;
+    if (s_failAfter >= 0 && !s_failAfter--)
+      throw std::runtime_error("Failed construction");
+  }
+
+  std::string m_text = "fragile value kept on the heap";
+};
+
+int Fragile::s_budget = -1;
+int Fragile::s_failAfter = -1;
+
+// Value that can only be compared with ==.
+struct EqualityOnly {
+  int m_value = 0;
+
+  bool operator==(const EqualityOnly& other) const {
+    return m_value == other.m_value;
+  }
+};
+
+}  // namespace
+
+BOOST_AUTO_TEST_SUITE(RobinHoodHashMapTests)
+
+template <typename K>
+void thenMapContainsItems(const Map<K>& map,
+                          const std::map<K, std::string>& expected) {
+  BOOST_CHECK_EQUAL(map.getSize(), expected.size());
+
+  for (const auto& item : expected) {
+    const auto it = map.find(item.first);
+    BOOST_REQUIRE_MESSAGE(it != end(map),
+                          "Missing required item with key: " << item.first);
+    BOOST_CHECK_MESSAGE(it->second == item.second,
+                        "Wrong value in map for key: "
+                            << item.first << " (expected: \"" << item.second
+                            << "\" got: \"" << it->second << "\")");
+  }
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(
+    GivenMap_WhenCreatedWithDefaultConstructor_ThenItIsEmpty,
+    K,
+    TestedKeyTypes) {
+  const Map<K> map;
+
+  BOOST_CHECK(map.isEmpty());
+  BOOST_CHECK(map.begin() == map.end());
+  BOOST_CHECK(map.find(1) == map.end());
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenEmptyMap_WhenAddingItem_ThenItemIsInMap,
+                              K,
+                              TestedKeyTypes) {
+  Map<K> map;
+
+  map[42] = "Alice";
+
+  thenMapContainsItems(map, {{42, "Alice"}});
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(
+    GivenMap_WhenInitializingFromListOfPairs_ThenAllItemsAreInMap,
+    K,
+    TestedKeyTypes) {
+  const Map<K> map = {{42, "Alice"}, {27, "Bob"}};
+
+  thenMapContainsItems(map, {{42, "Alice"}, {27, "Bob"}});
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(
+    GivenNonEmptyMap_WhenChangingItem_ThenNewValueIsInMap,
+    K,
+    TestedKeyTypes) {
+  Map<K> map = {{42, "Chuck"}, {27, "Bob"}};
+
+  map[42] = "Alice";
+  map.valueOf(27) = "Eve";
+
+  thenMapContainsItems(map, {{42, "Alice"}, {27, "Eve"}});
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(
+    GivenNotEmptyMap_WhenReadingValueOfMissingKey_ThenExceptionIsThrown,
+    K,
+    TestedKeyTypes) {
+  const Map<K> map = {{42, "Alice"}, {27, "Bob"}};
+
+  BOOST_CHECK_THROW(map.valueOf(1), std::out_of_range);
+  BOOST_CHECK_EQUAL(map.valueOf(42), "Alice");
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(
+    GivenNotEmptyMap_WhenRemovingValueByKey_ThenItemIsRemoved,
+    K,
+    TestedKeyTypes) {
+  Map<K> map = {{42, "Alice"}, {27, "Bob"}};
+
+  map.remove(27);
+
+  thenMapContainsItems(map, {{42, "Alice"}});
+  BOOST_CHECK_THROW(map.remove(27), std::out_of_range);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(
+    GivenNotEmptyMap_WhenRemovingItemByIterator_ThenItemIsRemoved,
+    K,
+    TestedKeyTypes) {
+  Map<K> map = {{42, "Alice"}, {27, "Bob"}};
+
+  map.remove(map.find(42));
+
+  thenMapContainsItems(map, {{27, "Bob"}});
+  BOOST_CHECK_THROW(map.remove(end(map)), std::out_of_range);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(
+    GivenMapWithOnePair_WhenIterating_ThenPairIsReturned,
+    K,
+    TestedKeyTypes) {
+  Map<K> map;
+  map[753] = "Rome";
+
+  auto it = map.begin();
+
+  BOOST_CHECK_EQUAL(it->first, 753);
+  BOOST_CHECK_EQUAL(it->second, "Rome");
+  BOOST_CHECK(++it == map.end());
+  BOOST_CHECK(--it == map.begin());
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(
+    GivenBoundaryIterators_WhenMovingPastThem_ThenOperationThrows,
+    K,
+    TestedKeyTypes) {
+  Map<K> map;
+
+  BOOST_CHECK_THROW(++(map.end()), std::out_of_range);
+  BOOST_CHECK_THROW(--(map.begin()), std::out_of_range);
+  BOOST_CHECK_THROW(*map.cend(), std::out_of_range);
+
+  map[1] = "1";
+
+  BOOST_CHECK_THROW(map.end()++, std::out_of_range);
+  BOOST_CHECK_THROW(map.cbegin()--, std::out_of_range);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(
+    GivenLargeMap_WhenIteratingBothWays_ThenEveryItemIsVisitedOnce,
+    K,
+    TestedKeyTypes) {
+  Map<K> map;
+  for (int i = 0; i < 1000; ++i)
+    map[i] = std::to_string(i);
+
+  std::map<K, std::string> forward;
+  for (auto it = map.begin(); it != map.end(); ++it)
+    BOOST_CHECK(forward.emplace(it->first, it->second).second);
+
+  std::map<K, std::string> backward;
+  for (auto it = map.end(); it != map.begin();) {
+    --it;
+    BOOST_CHECK(backward.emplace(it->first, it->second).second);
+  }
+
+  BOOST_CHECK_EQUAL(forward.size(), 1000);
+  BOOST_CHECK(forward == backward);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(
+    GivenNonEmptyMap_WhenCreatingCopy_ThenAllItemsAreCopied,
+    K,
+    TestedKeyTypes) {
+  Map<K> map = {{753, "Rome"}, {1789, "Paris"}};
+  const Map<K> other{map};
+
+  map[1410] = "Grunwald";
+
+  thenMapContainsItems(map,
+                       {{1410, "Grunwald"}, {753, "Rome"}, {1789, "Paris"}});
+  thenMapContainsItems(other, {{753, "Rome"}, {1789, "Paris"}});
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(
+    GivenNonEmptyMap_WhenMovingToOther_ThenAllItemsAreMoved,
+    K,
+    TestedKeyTypes) {
+  Map<K> map = {{753, "Rome"}, {1789, "Paris"}};
+  Map<K> other = {{42, "Alice"}};
+
+  other = std::move(map);
+  Map<K> third{std::move(other)};
+
+  thenMapContainsItems(third, {{753, "Rome"}, {1789, "Paris"}});
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(
+    GivenNotEmptyMap_WhenSelfAssigning_ThenNothingHappens,
+    K,
+    TestedKeyTypes) {
+  Map<K> map = {{42, "Alice"}, {27, "Bob"}};
+  Map<K>& self = map;
+
+  map = self;
+
+  thenMapContainsItems(map, {{42, "Alice"}, {27, "Bob"}});
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(
+    GivenTwoEquivalentMaps_WhenComparingThem_ThenTheyAreReportedAsEqual,
+    K,
+    TestedKeyTypes) {
+  const Map<K> map = {{42, "Alice"}, {27, "Bob"}};
+  const Map<K> other = {{27, "Bob"}, {42, "Alice"}};
+  const Map<K> different = {{27, "Alice"}, {42, "Bob"}};
+
+  BOOST_CHECK(map == other);
+  BOOST_CHECK(map != different);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(
+    GivenReservedMap_WhenAddingReservedItems_ThenCapacityDoesNotChange,
+    K,
+    TestedKeyTypes) {
+  Map<K> map;
+
+  map.reserve(1000);
+  const auto capacity = map.getCapacity();
+  for (int i = 0; i < 1000; ++i)
+    map[i] = std::string{};
+
+  BOOST_CHECK_EQUAL(map.getCapacity(), capacity);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(
+    GivenMap_WhenInsertingAndRemovingRandomly_ThenItBehavesLikeStdMap,
+    K,
+    TestedKeyTypes) {
+  Map<K> map;
+  std::map<K, std::string> expected;
+  std::mt19937 generator(2018);
+  std::uniform_int_distribution<int> keys(0, 500);
+
+  for (int i = 0; i < 20000; ++i) {
+    const K key = keys(generator);
+    if (generator() % 3) {
+      map[key] = std::to_string(i);
+      expected[key] = std::to_string(i);
+    } else if (expected.erase(key)) {
+      map.remove(key);
+    } else {
+      BOOST_REQUIRE(map.find(key) == map.end());
+    }
+  }
+
+  thenMapContainsItems(map, expected);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(
+    GivenChurnedMap_WhenSearchingForRemovedKeys_ThenEndIsReturned,
+    K,
+    TestedKeyTypes) {
+  Map<K> map;
+  for (int round = 0; round < 10; ++round) {
+    for (int i = 0; i < 1000; ++i)
+      map[round * 1000 + i] = std::to_string(i);
+    for (int i = 0; i < 1000; ++i)
+      map.remove(round * 1000 + i);
+  }
+
+  BOOST_CHECK(map.isEmpty());
+  BOOST_CHECK(map.begin() == map.end());
+  for (int i = 0; i < 10000; ++i)
+    BOOST_REQUIRE(map.find(i) == map.end());
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(
+    GivenMap_WhenRemovingItemsWhileIterating_ThenOnlyThoseItemsAreRemoved,
+    K,
+    TestedKeyTypes) {
+  Map<K> map;
+  std::map<K, std::string> expected;
+  for (int i = 0; i < 1000; ++i) {
+    map[i] = std::to_string(i);
+    if (i % 3)
+      expected[i] = std::to_string(i);
+  }
+
+  for (auto it = map.begin(); it != map.end();) {
+    if (static_cast<int>(it->first) % 3 == 0)
+      it = map.remove(it);
+    else
+      ++it;
+  }
+
+  thenMapContainsItems(map, expected);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(
+    GivenSingleItemMap_WhenRemovingItemByIterator_ThenEndIsReturned,
+    K,
+    TestedKeyTypes) {
+  Map<K> map = {{42, "Alice"}};
+
+  BOOST_CHECK(map.remove(map.begin()) == map.end());
+}
+
+BOOST_AUTO_TEST_CASE(
+    GivenThrowingValue_WhenInsertingOrCopying_ThenMapIsLeftUnchanged) {
+  using FragileMap = aisdi::RobinHoodHashMap<int, Fragile>;
+  FragileMap map;
+  for (int i = 0; i < 100; ++i)
+    map[i].m_text = std::to_string(i);
+
+  // Most of these land inside a run of displaced entries, which has to be
+  // shifted back.
+  Fragile::s_budget = 0;
+  for (int i = 100; i < 200; ++i)
+    BOOST_CHECK_THROW(map[i], std::runtime_error);
+  Fragile::s_budget = 50;
+  BOOST_CHECK_THROW(FragileMap{map}, std::runtime_error);
+  Fragile::s_budget = 50;
+  BOOST_CHECK_THROW(map.reserve(1000), std::runtime_error);
+  Fragile::s_budget = -1;
+
+  BOOST_CHECK_EQUAL(map.getSize(), 100);
+  for (int i = 100; i < 200; ++i)
+    BOOST_CHECK(map.find(i) == map.end());
+  for (int i = 0; i < 100; ++i)
+    BOOST_CHECK_EQUAL(map.valueOf(i).m_text, std::to_string(i));
+}
+
+BOOST_AUTO_TEST_CASE(
+    GivenValueFailingToMove_WhenShiftingEntries_ThenShiftIsUndone) {
+  using FragileMap = aisdi::RobinHoodHashMap<int, Fragile>;
+  FragileMap map;
+  map.reserve(200);
+  for (int i = 0; i < 150; ++i)
+    map[i].m_text = std::to_string(i);
+
+  // Moving an entry copies it, so inserting into a run fails after shifting
+  // some of its entries.
+  int failures = 0;
+  for (int i = 150; i < 400; ++i) {
+    Fragile::s_failAfter = i % 3;
+    try {
+      map[i].m_text = std::to_string(i);
+    } catch (const std::runtime_error&) {
+      ++failures;
+    }
+    Fragile::s_failAfter = -1;
+  }
+
+  BOOST_CHECK_GT(failures, 0);
+  for (int i = 0; i < 150; ++i)
+    BOOST_CHECK_EQUAL(map.valueOf(i).m_text, std::to_string(i));
+  std::size_t count = 0;
+  for (const auto& item : map) {
+    BOOST_CHECK_EQUAL(map.valueOf(item.first).m_text,
+                      std::to_string(item.first));
+    ++count;
+  }
+  BOOST_CHECK_EQUAL(count, map.getSize());
+}
+
+BOOST_AUTO_TEST_CASE(
+    GivenValuesWithOnlyEqualityOperator_WhenComparingMaps_ThenItIsUsed) {
+  using EqualityMap = aisdi::RobinHoodHashMap<int, EqualityOnly>;
+  EqualityMap first;
+  EqualityMap second;
+  first[1].m_value = 10;
+  second[1].m_value = 10;
+
+  BOOST_CHECK(first == second);
+  second[1].m_value = 20;
+  BOOST_CHECK(first != second);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
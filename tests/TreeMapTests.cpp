@@ -3,6 +3,7 @@
 #include <cstdint>
 #include <string>
 #include <map>
+#include <vector>
 
 #include <boost/test/unit_test.hpp>
 
@@ -786,6 +787,43 @@ BOOST_AUTO_TEST_CASE_TEMPLATE(GivenTwoMapsWithDifferentKeys_WhenComparingThem_Th
  BOOST_CHECK(map != other);
 }
 
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenSortedRange_WhenConstructingMap_ThenItemsAreInOrderAndMapStaysUsable,
+                             K,
+                             TestedKeyTypes)
+{
+ std::vector<std::pair<K, std::string>> items;
+ for (int i = 0; i < 1000; ++i)
+   items.emplace_back(2 * i, std::to_string(i));
+
+ Map<K> map(items.begin(), items.end());
+ int expected = 0;
+ for (auto it = map.cbegin(); it != map.cend(); ++it, expected += 2)
+   BOOST_REQUIRE_EQUAL(it->first, expected);
+ for (int i = 0; i < 1000; ++i)
+ {
+   map[2 * i + 1] = "odd";
+   map.remove(2 * i);
+ }
+
+ BOOST_CHECK_EQUAL(expected, 2000);
+ BOOST_CHECK_EQUAL(map.getSize(), 1000);
+ BOOST_CHECK_EQUAL(map.valueOf(1999), "odd");
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenUnsortedRangeWithDuplicateKeys_WhenInsertingIt_ThenLastValuesWin,
+                             K,
+                             TestedKeyTypes)
+{
+ const std::vector<std::pair<K, std::string>> items = {
+   { 13, "Chuck" }, { 27, "Bob" }, { 27, "Eve" }, { 1, "Zed" }, { 13, "Alice" }
+ };
+ Map<K> map;
+
+ map.insert(items.begin(), items.end());
+
+ thenMapContainsItems(map, { { 13, "Alice" }, { 27, "Eve" }, { 1, "Zed" } });
+}
+
 // ConstIterator is tested via Iterator methods.
 // If Iterator methods are to be changed, then new ConstIterator tests are required.
 